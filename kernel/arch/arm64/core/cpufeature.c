@@ -36,9 +36,12 @@
 #include <asm/hwcap.h>
 #include <asm/insn.h>
 #include <asm/cpucaps.h>
+#include <asm/cache.h>
 
 unsigned long elf_hwcap __read_mostly;
 
+u32 dcache_zva_size __ro_after_init;
+
 DECLARE_BITMAP(cpu_hwcaps, ARM64_NCAPS);
 static struct arm64_cpu_capabilities const __ro_after_init *cpu_hwcaps_ptrs[ARM64_NCAPS];
 
@@ -95,6 +98,7 @@ static void cpu_enable_cnp(struct arm64_cpu_capabilities const *cap);
  * sync with the documentation of the CPU feature register ABI.
  */
 static const struct arm64_ftr_bits ftr_id_aa64isar0[] = {
+	ARM64_FTR_BITS(FTR_HIDDEN, FTR_STRICT, FTR_LOWER_SAFE, ID_AA64ISAR0_TLB_SHIFT, 4, 0),
 	ARM64_FTR_BITS(FTR_VISIBLE, FTR_STRICT, FTR_LOWER_SAFE, ID_AA64ISAR0_TS_SHIFT, 4, 0),
 	ARM64_FTR_BITS(FTR_VISIBLE, FTR_STRICT, FTR_LOWER_SAFE, ID_AA64ISAR0_FHM_SHIFT, 4, 0),
 	ARM64_FTR_BITS(FTR_VISIBLE, FTR_STRICT, FTR_LOWER_SAFE, ID_AA64ISAR0_DP_SHIFT, 4, 0),
@@ -914,6 +918,18 @@ static const struct arm64_cpu_capabilities arm64_features[] = {
 		.sign = FTR_UNSIGNED,
 		.min_field_value = 1,
 	},
+#ifdef CONFIG_ARM64_TLB_RANGE
+	{
+		.desc = "TLB range maintenance instructions",
+		.capability = ARM64_HAS_TLB_RANGE,
+		.type = ARM64_CPUCAP_SYSTEM_FEATURE,
+		.matches = has_cpuid_feature,
+		.sys_reg = SYS_ID_AA64ISAR0_EL1,
+		.field_pos = ID_AA64ISAR0_TLB_SHIFT,
+		.sign = FTR_UNSIGNED,
+		.min_field_value = ID_AA64ISAR0_TLB_RANGE,
+	},
+#endif
 	{},
 };
 
@@ -1297,6 +1313,26 @@ static void __init setup_system_capabilities(void)
 	enable_cpu_capabilities(SCOPE_ALL & ~SCOPE_BOOT_CPU);
 }
 
+/*
+ * DCZID_EL0 is sanitised to the smallest block size of the boot CPUs,
+ * and to DZP if any of them prohibits DC ZVA. A block is naturally
+ * aligned, so a larger one on some CPU still stays inside the page.
+ */
+static void __init setup_dcache_zva(void)
+{
+	u64 dczid = read_sanitised_ftr_reg(SYS_DCZID_EL0);
+	u32 size = 4 << (dczid & DCZID_BS_MASK);
+
+	if (dczid & BIT(DCZID_DZP_SHIFT) ||
+	    size < L1_CACHE_BYTES || size > PAGE_SIZE) {
+		pr_info("DC ZVA unusable, clearing pages with non-temporal stores\n");
+		return;
+	}
+
+	dcache_zva_size = size;
+	pr_info("DC ZVA block size %u bytes\n", size);
+}
+
 void __init setup_cpu_features(void)
 {
 	u32 cwg;
@@ -1312,6 +1348,7 @@ void __init setup_cpu_features(void)
 		pr_info("emulated: Privileged Access Never (PAN) using TTBR0_EL1 switching\n");
 
 	minsigstksz_setup();
+	setup_dcache_zva();
 
 	/* Advertise that we have computed the system capabilities */
 	set_sys_caps_initialised();
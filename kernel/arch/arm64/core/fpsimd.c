@@ -15,17 +15,76 @@
  *
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * FP/SIMD state is switched lazily. The kernel itself never touches the
+ * FP registers, so they only ever hold user state and CPACR_EL1 is left
+ * trapping EL0 accesses after every context switch. The first FP
+ * instruction of a task then loads its state, and only a task which took
+ * that trap since it was switched in (TIF_FPSIMD_LIVE) has its registers
+ * saved when it is switched out. Tasks which never use FP never pay for
+ * it.
+ *
+ * The registers of a saved task are not clobbered until another task
+ * loads its own, so fpsimd_last_state remembers whose state each CPU
+ * holds and thread.fpsimd_cpu where a task's state was last loaded. When
+ * both still match at the trap, the reload is skipped.
  */
+#define pr_fmt(fmt) "fpsimd: " fmt
+
 #include <base/common.h>
+#include <base/string.h>
 
 #include <rtochius/threads.h>
 #include <rtochius/sched.h>
+#include <rtochius/percpu.h>
+#include <rtochius/preempt.h>
+#include <rtochius/thread_info.h>
+#include <rtochius/printf.h>
 
 #include <asm/fpsimd.h>
 #include <asm/sysreg.h>
 #include <asm/cpufeature.h>
 #include <asm/exception.h>
 
+/* The user state the FP registers of this CPU hold, if any: */
+static DEFINE_PER_CPU(struct user_fpsimd_state *, fpsimd_last_state);
+
+struct fpsimd_stats {
+	unsigned long		traps;
+	/* Traps which found the registers still holding the task's state: */
+	unsigned long		reuses;
+	unsigned long		saves;
+};
+
+static DEFINE_PER_CPU(struct fpsimd_stats, fpsimd_stats);
+
+static inline void fpsimd_el0_access(bool enable)
+{
+	u64 old = read_sysreg(cpacr_el1), cpacr;
+
+	if (enable)
+		cpacr = old | CPACR_EL1_FPEN_EL0EN;
+	else
+		cpacr = old & ~CPACR_EL1_FPEN_EL0EN;
+
+	/* The eret back to EL0 synchronises the change. */
+	if (cpacr != old)
+		write_sysreg(cpacr, cpacr_el1);
+}
+
+/*
+ * Save current's registers if EL0 may have written them since they were
+ * loaded. Must be called with preemption disabled.
+ */
+static void fpsimd_save_current(void)
+{
+	if (!test_thread_flag(TIF_FPSIMD_LIVE))
+		return;
+
+	fpsimd_save_state(&current->thread.uw.fpsimd_state);
+	__this_cpu_inc(fpsimd_stats.saves);
+}
+
 /*
  * Enable SVE for EL1.
  * Intended for use by the cpufeatures code during CPU boot.
@@ -63,8 +122,36 @@ u64 read_zcr_features(void)
 	return zcr;
 }
 
+/*
+ * Reset current's FP state for a new program. The zeroed state is
+ * loaded on its first FP access.
+ */
 void fpsimd_flush_thread(void)
 {
+	if (!system_supports_fpsimd())
+		return;
+
+	preempt_disable();
+	clear_thread_flag(TIF_FPSIMD_LIVE);
+	fpsimd_el0_access(false);
+	memset(&current->thread.uw.fpsimd_state, 0,
+	       sizeof(current->thread.uw.fpsimd_state));
+	fpsimd_flush_task_state(current);
+	preempt_enable();
+}
+
+/*
+ * Make thread.uw.fpsimd_state of current up to date, e.g. before it is
+ * copied to a child.
+ */
+void fpsimd_preserve_current_state(void)
+{
+	if (!system_supports_fpsimd())
+		return;
+
+	preempt_disable();
+	fpsimd_save_current();
+	preempt_enable();
 }
 
 /*
@@ -75,9 +162,18 @@ void fpsimd_flush_task_state(struct task_struct *t)
 	t->thread.fpsimd_cpu = NR_CPUS;
 }
 
+/*
+ * Called from __switch_to() with current still the outgoing task. The
+ * registers stay loaded, next traps on its first FP access.
+ */
 void fpsimd_thread_switch(struct task_struct *next)
 {
+	if (!system_supports_fpsimd())
+		return;
 
+	fpsimd_save_current();
+	clear_thread_flag(TIF_FPSIMD_LIVE);
+	fpsimd_el0_access(false);
 }
 
 /*
@@ -85,8 +181,29 @@ void fpsimd_thread_switch(struct task_struct *next)
  */
 asmlinkage void do_fpsimd_acc(unsigned int esr, struct pt_regs *regs)
 {
-	/* TODO: implement lazy context saving/restoring */
-	WARN_ON(1);
+	struct user_fpsimd_state *st = &current->thread.uw.fpsimd_state;
+	unsigned int cpu;
+
+	if (unlikely(!system_supports_fpsimd()))
+		panic("el0 fpsimd_acc without FP/ASIMD\n");
+
+	preempt_disable();
+	cpu = smp_processor_id();
+	__this_cpu_inc(fpsimd_stats.traps);
+
+	if (__this_cpu_read(fpsimd_last_state) == st &&
+	    current->thread.fpsimd_cpu == cpu) {
+		/* Nobody loaded anything here since we were saved. */
+		__this_cpu_inc(fpsimd_stats.reuses);
+	} else {
+		fpsimd_load_state(st);
+		__this_cpu_write(fpsimd_last_state, st);
+		current->thread.fpsimd_cpu = cpu;
+	}
+
+	set_thread_flag(TIF_FPSIMD_LIVE);
+	fpsimd_el0_access(true);
+	preempt_enable();
 }
 
 asmlinkage void do_sve_acc(unsigned int esr, struct pt_regs *regs)
@@ -101,3 +218,15 @@ asmlinkage void do_fpsimd_exc(unsigned int esr, struct pt_regs *regs)
 {
 	panic("el0 fpsimd_exc sync\n");
 }
+
+void show_fpsimd_stats(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct fpsimd_stats *st = per_cpu_ptr(&fpsimd_stats, cpu);
+
+		pr_info("CPU%d: traps %lu reuses %lu saves %lu\n",
+			cpu, st->traps, st->reuses, st->saves);
+	}
+}
@@ -176,6 +176,9 @@ void arch_release_task_struct(struct task_struct *tsk)
  */
 int arch_dup_task_struct(struct task_struct *dst, struct task_struct *src)
 {
+	if (current->mm)
+		fpsimd_preserve_current_state();
+
 	*dst = *src;
 
 	return 0;
@@ -205,6 +208,7 @@ int copy_thread(unsigned long clone_flags, unsigned long stack_start,
 	 * registers for p.
 	 */
 	fpsimd_flush_task_state(p);
+	clear_tsk_thread_flag(p, TIF_FPSIMD_LIVE);
 
 	if (likely(!(p->flags & PF_KTHREAD))) {
 		*childregs = *current_pt_regs();
@@ -27,11 +27,12 @@
 #include <rtochius/of.h>
 #include <rtochius/smp.h>
 #include <rtochius/percpu.h>
-#include <rtochius/completion.h>
+#include <rtochius/cpu.h>
 #include <rtochius/memory.h>
 #include <rtochius/cpumask.h>
 #include <rtochius/delay.h>
 #include <rtochius/softirq.h>
+#include <rtochius/tick.h>
 
 #include <asm/irqflags.h>
 #include <asm/daifflags.h>
@@ -43,6 +44,8 @@
 #include <asm/smp_plat.h>
 #include <asm/mmu.h>
 #include <asm/cacheflush.h>
+#include <asm/mmu_context.h>
+#include <asm/arch_timer.h>
 
 DEFINE_PER_CPU_READ_MOSTLY(int, cpu_number);
 
@@ -77,7 +80,18 @@ static int boot_secondary(unsigned int cpu, struct task_struct *idle)
 	return -EOPNOTSUPP;
 }
 
-static DECLARE_COMPLETION(cpu_running);
+/*
+ * Wait up to a second for @cpu to mark itself online. The counter rather
+ * than jiffies: the boot CPU may not take ticks this early.
+ */
+static void wait_for_cpu_running(unsigned int cpu)
+{
+	u64 end = arch_counter_get_cntvct() + arch_timer_get_cntfrq();
+
+	while (!cpu_online(cpu) &&
+	       (s64)(arch_counter_get_cntvct() - end) < 0)
+		cpu_relax();
+}
 
 int __cpu_up(unsigned int cpu, struct task_struct *idle)
 {
@@ -102,8 +116,7 @@ int __cpu_up(unsigned int cpu, struct task_struct *idle)
 		 * CPU was successfully started, wait for it to come online or
 		 * time out.
 		 */
-		wait_for_completion_timeout(&cpu_running,
-					    msecs_to_jiffies(1000));
+		wait_for_cpu_running(cpu);
 
 		if (!cpu_online(cpu)) {
 			pr_crit("CPU%u: failed to come online\n", cpu);
@@ -153,9 +166,32 @@ int __cpu_up(unsigned int cpu, struct task_struct *idle)
 /*
  * This is the secondary CPU boot entry.  We're using this CPUs
  * idle thread stack, but a set of temporary page tables.
+ *
+ * head.S branches here with a zero link register, so this never returns:
+ * it ends in the idle loop of the CPU's idle task.
  */
 asmlinkage void secondary_start_kernel(void)
 {
+	unsigned int cpu = task_cpu(current);
+
+	set_my_cpu_offset(per_cpu_offset(cpu));
+
+	/* The idle task runs on init_mm, drop the boot ID map. */
+	current->active_mm = &init_mm;
+	cpu_uninstall_idmap();
+
+	preempt_disable();
+	notify_cpu_starting(cpu);
+
+	/* Each CPU runs the tick off its own timer. */
+	tick_setup_cpu(cpu);
+
+	/* Lets __cpu_up() on the boot CPU go on. */
+	set_cpu_online(cpu, true);
+
+	local_daif_restore(DAIF_PROCCTX);
+
+	cpu_startup_entry(CPUHP_ONLINE);
 }
 
 /*
@@ -446,6 +482,7 @@ void handle_IPI(int ipinr, struct pt_regs *regs)
 
 	switch (ipinr) {
 	case IPI_RESCHEDULE:
+		scheduler_ipi();
 		break;
 
 	case IPI_CALL_FUNC:
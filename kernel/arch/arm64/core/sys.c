@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * AArch64-specific system calls implementation
+ *
+ * Copyright (C) 2012 ARM Ltd.
+ * Author: Catalin Marinas <catalin.marinas@arm.com>
+ */
+#include <base/compiler.h>
+#include <base/linkage.h>
+#include <base/errno.h>
+
+#include <rtochius/syscalls.h>
+
+#include <asm/syscall.h>
+
+asmlinkage long sys_ni_syscall(struct pt_regs *regs)
+{
+	return -ENOSYS;
+}
+
+/*
+ * Wrappers to pass the pt_regs argument.
+ */
+#undef __SYSCALL
+#define __SYSCALL(nr, sym)	[nr] = sym,
+
+/*
+ * The sys_call_table array must be 4K aligned to be accessible from
+ * kernel/entry.S.
+ */
+const syscall_fn_t sys_call_table[__NR_syscalls] __aligned(4096) = {
+	[0 ... __NR_syscalls - 1] = sys_ni_syscall,
+#include <uapi/rtochius/unistd.h>
+};
@@ -2,9 +2,47 @@
 #include <base/compiler.h>
 #include <base/linkage.h>
 
+#include <rtochius/nospec.h>
+#include <rtochius/syscalls.h>
+
+#include <asm/daifflags.h>
 #include <asm/exception.h>
+#include <asm/syscall.h>
 #include <asm/sysreg.h>
 
+static long __invoke_syscall(struct pt_regs *regs, syscall_fn_t syscall_fn)
+{
+	return syscall_fn(regs);
+}
+
+static void invoke_syscall(struct pt_regs *regs, unsigned int scno,
+			   unsigned int sc_nr,
+			   const syscall_fn_t syscall_table[])
+{
+	long ret;
+
+	if (scno < sc_nr) {
+		syscall_fn_t syscall_fn;
+		syscall_fn = syscall_table[array_index_nospec(scno, sc_nr)];
+		ret = __invoke_syscall(regs, syscall_fn);
+	} else {
+		ret = sys_ni_syscall(regs);
+	}
+
+	regs->regs[0] = ret;
+}
+
+/*
+ * The slow path, the hot syscalls are dispatched straight from
+ * el0_svc_fast in entry.S.
+ */
 asmlinkage void el0_svc_handler(struct pt_regs *regs)
 {
+	unsigned int scno = regs->regs[8];
+
+	regs->orig_x0 = regs->regs[0];
+	regs->syscallno = scno;
+
+	local_daif_restore(DAIF_PROCCTX);
+	invoke_syscall(regs, scno, __NR_syscalls, sys_call_table);
 }
@@ -35,4 +35,33 @@ static inline u32 arch_timer_get_cntfrq(void)
 	return read_sysreg(cntfrq_el0);
 }
 
+static inline u64 arch_counter_get_cntvct(void)
+{
+	u64 cval;
+
+	isb();
+	cval = read_sysreg(cntvct_el0);
+
+	return cval;
+}
+
+/*
+ * The tick code drives the EL1 virtual timer in compare-value mode:
+ * an absolute deadline in CNTVCT units, so a late reprogram never
+ * shifts the following ticks.
+ */
+static inline void arch_timer_set_next_event(u64 cval)
+{
+	write_sysreg(cval, cntv_cval_el0);
+	write_sysreg(ARCH_TIMER_CTRL_ENABLE, cntv_ctl_el0);
+	isb();
+}
+
+static inline void arch_timer_mask_event(void)
+{
+	write_sysreg(ARCH_TIMER_CTRL_ENABLE | ARCH_TIMER_CTRL_IT_MASK,
+		     cntv_ctl_el0);
+	isb();
+}
+
 #endif /* !__ASM_ARCH_TIMER_H_ */
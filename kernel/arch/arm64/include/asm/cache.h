@@ -47,6 +47,9 @@
 #define CLIDR_LOC(clidr)	(((clidr) >> CLIDR_LOC_SHIFT) & 0x7)
 #define CLIDR_LOUIS(clidr)	(((clidr) >> CLIDR_LOUIS_SHIFT) & 0x7)
 
+#define DCZID_DZP_SHIFT		4
+#define DCZID_BS_MASK		0xf
+
 #ifndef __ASSEMBLY__
 
 #include <base/bitops.h>
@@ -55,6 +58,12 @@
 #define ICACHEF_VPIPT		1
 extern unsigned long __icache_flags;
 
+/*
+ * Bytes zeroed by one DC ZVA, or 0 if clear_page() has to use plain
+ * stores: before the boot CPUs agreed on it, or if it is prohibited.
+ */
+extern u32 dcache_zva_size;
+
 /*
  * Whilst the D-side always behaves as PIPT on AArch64, aliasing is
  * permitted in the I-cache.
@@ -19,7 +19,10 @@
 #ifndef __ASSEMBLY__
 #include <base/types.h>
 
+#include <asm/ptrace.h>
+
 struct arm64_cpu_capabilities;
+struct task_struct;
 extern void sve_kernel_enable(const struct arm64_cpu_capabilities *__unused);
 
 extern u64 read_zcr_features(void);
@@ -28,6 +31,12 @@ extern void fpsimd_thread_switch(struct task_struct *next);
 extern void fpsimd_flush_thread(void);
 
 extern void fpsimd_flush_task_state(struct task_struct *target);
+extern void fpsimd_preserve_current_state(void);
+
+extern void fpsimd_save_state(struct user_fpsimd_state *state);
+extern void fpsimd_load_state(struct user_fpsimd_state *state);
+
+extern void show_fpsimd_stats(void);
 
 #endif /* !__ASSEMBLY__ */
 #endif /* !__ASM_FP_H_ */
@@ -45,6 +45,13 @@
 #define RESERVED_IO_SPACE	SZ_2M
 #define	FIXADDR_TOP		(VIOMAP_START - RESERVED_IO_SPACE)
 
+/*
+ * vmalloc space sits between the kernel image and the fixmap, with a 1G
+ * hole on either side to catch overruns.
+ */
+#define VMALLOC_START		(KIMAGE_VADDR + SZ_1G)
+#define VMALLOC_END		(FIXADDR_TOP - SZ_1G)
+
 #define KERNEL_START      _text
 #define KERNEL_END        _end
 
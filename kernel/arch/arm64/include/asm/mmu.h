@@ -43,6 +43,9 @@ extern void *__fixmap_remap_fdt(phys_addr_t dt_phys, int *size, pgprot_t prot);
 extern void *fixmap_remap_fdt(phys_addr_t dt_phys);
 
 extern void vmemmap_populate(phys_addr_t phys, unsigned long virt, size_t size);
+extern int create_user_mapping(struct mm_struct *mm, phys_addr_t phys,
+			       unsigned long virt, phys_addr_t size,
+			       pgprot_t prot);
 
 #define INIT_MM_CONTEXT(name)	\
 	.pgd = init_pg_dir,
@@ -90,6 +90,8 @@ extern unsigned long empty_zero_page[PAGE_SIZE / sizeof(unsigned long)];
 #define pte_dirty(pte)		(pte_sw_dirty(pte) || pte_hw_dirty(pte))
 
 #define pte_valid(pte)		(!!(pte_val(pte) & PTE_VALID))
+#define pte_migration(pte) \
+	((pte_val(pte) & (PTE_VALID | PTE_MIGRATION)) == PTE_MIGRATION)
 /*
  * Execute-only user mappings do not have the PTE_USER bit set. All valid
  * kernel mappings have the PTE_UXN bit set.
@@ -180,6 +182,16 @@ static inline pte_t pte_mkspecial(pte_t pte)
 	return set_pte_bit(pte, __pgprot(PTE_SPECIAL));
 }
 
+/*
+ * A migration entry keeps the old attributes of the PTE, minus the valid
+ * bit, while compaction copies the page it maps.
+ */
+static inline pte_t pte_mkmigration(pte_t pte)
+{
+	pte = clear_pte_bit(pte, __pgprot(PTE_VALID));
+	return set_pte_bit(pte, __pgprot(PTE_MIGRATION));
+}
+
 static inline pte_t pte_mkcont(pte_t pte)
 {
 	pte = set_pte_bit(pte, __pgprot(PTE_CONT));
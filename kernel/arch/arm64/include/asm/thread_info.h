@@ -26,6 +26,7 @@
 #define TIF_SIGPENDING		0
 #define TIF_NEED_RESCHED	1
 #define TIF_FSCHECK			2	/* Check FS is USER_DS on return */
+#define TIF_FPSIMD_LIVE		3	/* FPSIMD regs hold our state, EL0 may write them */
 #define TIF_POLLING_NRFLAG	4
 #define TIF_SINGLESTEP		21
 #define TIF_SVE			23	/* Scalable Vector Extension in use */
@@ -33,6 +34,7 @@
 #define _TIF_SIGPENDING		(1 << TIF_SIGPENDING)
 #define _TIF_NEED_RESCHED	(1 << TIF_NEED_RESCHED)
 #define _TIF_FSCHECK			(1 << TIF_FSCHECK)
+#define _TIF_FPSIMD_LIVE	(1 << TIF_FPSIMD_LIVE)
 #define _TIF_SINGLESTEP			(1 << TIF_SINGLESTEP)
 #define _TIF_SVE		(1 << TIF_SVE)
 
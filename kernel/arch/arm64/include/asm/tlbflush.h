@@ -25,6 +25,7 @@
 
 #include <rtochius/mm_types.h>
 
+#include <asm/cpufeature.h>
 #include <asm/pgtable-hwdef.h>
 
 #include <asm/base/barrier.h>
@@ -62,6 +63,111 @@
 		__ta;						\
 	})
 
+/*
+ * The range operations of ARMv8.4-TLBI, by their SYS encoding so that
+ * the assembler does not have to know about them.
+ */
+#define __TLBI_SYS_rvae1is	"sys #0, c8, c2, #1"
+#define __TLBI_SYS_rvaae1is	"sys #0, c8, c2, #3"
+#define __TLBI_SYS_rvale1is	"sys #0, c8, c2, #5"
+#define __TLBI_SYS_rvaale1is	"sys #0, c8, c2, #7"
+
+#define __tlbi_range(op, arg) asm (__TLBI_SYS_##op ", %0\n"		       \
+				   "nop\n		nop" : : "r" (arg))
+
+/* Translation granule of the range operand, 1 for 4K up to 3 for 64K. */
+#define __TLBI_RANGE_TG		(((PAGE_SHIFT - 12) >> 1) + 1)
+
+/*
+ * The operand of a range TLBI covers (NUM + 1) * 2^(5 * SCALE + 1) pages
+ * from BaseADDR:
+ *
+ * | ASID | TG | SCALE | NUM | TTL | BaseADDR |
+ * +------+----+-------+-----+-----+----------+
+ * |63  48|47 46|45  44|43 39|38 37|36       0|
+ *
+ * TTL is left 0, any level.
+ */
+#define __TLBI_VADDR_RANGE(addr, asid, scale, num)			\
+	({								\
+		unsigned long __ta = (addr) >> PAGE_SHIFT;		\
+		__ta &= GENMASK_ULL(36, 0);				\
+		__ta |= (unsigned long)(num) << 39;			\
+		__ta |= (unsigned long)(scale) << 44;			\
+		__ta |= (unsigned long)__TLBI_RANGE_TG << 46;		\
+		__ta |= (unsigned long)(asid) << 48;			\
+		__ta;							\
+	})
+
+#define TLBI_RANGE_MASK			GENMASK_ULL(4, 0)
+#define __TLBI_RANGE_PAGES(num, scale)	\
+	((unsigned long)((num) + 1) << (5 * (scale) + 1))
+#define MAX_TLBI_RANGE_PAGES		__TLBI_RANGE_PAGES(31, 3)
+
+/* The NUM a range of @pages needs at @scale, -1 if none at all. */
+#define __TLBI_RANGE_NUM(pages, scale)	\
+	((int)(((pages) >> (5 * (scale) + 1)) & TLBI_RANGE_MASK) - 1)
+
+/*
+ * Above this many TLBI operations, a range flush without range TLBI
+ * invalidates the whole ASID, or all of the TLB for kernel ranges.
+ * Set with tlbi_max_ops=, defaults to PTRS_PER_PTE.
+ */
+extern unsigned long tlbi_max_ops;
+
+/*
+ * Invalidate @pages pages from @start, one TLBI @op per @stride or, with
+ * range TLBI, a few r@op covering all of them:
+ *
+ * 1. An odd page count first loses a page to a single @op, ranges come
+ *    in multiples of two pages.
+ * 2. The remaining pages are covered from the lowest SCALE up, each
+ *    SCALE taking the bits of the page count it can express in NUM.
+ *
+ * Both @start and @pages are updated. The caller issues the DSBs.
+ */
+#define __flush_tlb_range_op(op, start, pages, stride, asid)		\
+do {									\
+	int __scale = 0;						\
+	int __num;							\
+	unsigned long __addr;						\
+									\
+	while (pages > 0) {						\
+		if (!system_supports_tlb_range() || pages % 2 == 1) {	\
+			__addr = __TLBI_VADDR(start, asid);		\
+			__tlbi(op, __addr);				\
+			__tlbi_user(op, __addr);			\
+			start += stride;				\
+			pages -= stride >> PAGE_SHIFT;			\
+			continue;					\
+		}							\
+									\
+		__num = __TLBI_RANGE_NUM(pages, __scale);		\
+		if (__num >= 0) {					\
+			__addr = __TLBI_VADDR_RANGE(start, asid,	\
+						    __scale, __num);	\
+			__tlbi_range(r##op, __addr);			\
+			__tlbi_user(r##op, __addr);			\
+			start += __TLBI_RANGE_PAGES(__num, __scale) << PAGE_SHIFT; \
+			pages -= __TLBI_RANGE_PAGES(__num, __scale);	\
+		}							\
+		__scale++;						\
+	}								\
+} while (0)
+
+/*
+ * Whether a flush of @pages pages at @stride is cheaper done on the
+ * whole ASID or TLB.
+ */
+static inline bool __flush_tlb_range_too_big(unsigned long pages,
+					     unsigned long stride)
+{
+	if (system_supports_tlb_range())
+		return pages >= MAX_TLBI_RANGE_PAGES;
+
+	return pages >= tlbi_max_ops * (stride >> PAGE_SHIFT);
+}
+
 /*
  *	local_flush_tlb_all()
  *		Same as flush_tlb_all(), but only applies to the calling CPU.
@@ -125,48 +231,32 @@ static inline void flush_tlb_page(struct vm_area_struct *vma,
 	dsb(ish);
 }
 
-/*
- * This is meant to avoid soft lock-ups on large TLB flushing ranges and not
- * necessarily a performance improvement.
- */
-#define MAX_TLBI_OPS	PTRS_PER_PTE
-
 /*
  *	__flush_tlb_range(vma, start, end, stride, last_level)
  *		Invalidate the virtual-address range '[start, end)' on all
  *		CPUs for the user address space corresponding to 'vma->mm'.
  *		The invalidation operations are issued at a granularity
  *		determined by 'stride' and only affect any walk-cache entries
- *		if 'last_level' is equal to false.
+ *		if 'last_level' is equal to false. All of them are ordered by
+ *		a single DSB.
  */
 static inline void __flush_tlb_range(struct vm_area_struct *vma,
 				     unsigned long start, unsigned long end,
 				     unsigned long stride, bool last_level)
 {
 	unsigned long asid = ASID(vma->vm_mm);
-	unsigned long addr;
+	unsigned long pages = (end - start) >> PAGE_SHIFT;
 
-	if ((end - start) >= (MAX_TLBI_OPS * stride)) {
+	if (__flush_tlb_range_too_big(pages, stride)) {
 		flush_tlb_mm(vma->vm_mm);
 		return;
 	}
 
-	/* Convert the stride into units of 4k */
-	stride >>= 12;
-
-	start = __TLBI_VADDR(start, asid);
-	end = __TLBI_VADDR(end, asid);
-
 	dsb(ishst);
-	for (addr = start; addr < end; addr += stride) {
-		if (last_level) {
-			__tlbi(vale1is, addr);
-			__tlbi_user(vale1is, addr);
-		} else {
-			__tlbi(vae1is, addr);
-			__tlbi_user(vae1is, addr);
-		}
-	}
+	if (last_level)
+		__flush_tlb_range_op(vale1is, start, pages, stride, asid);
+	else
+		__flush_tlb_range_op(vae1is, start, pages, stride, asid);
 	dsb(ish);
 }
 
@@ -198,19 +288,15 @@ static inline void flush_tlb_range(struct vm_area_struct *vma,
  */
 static inline void flush_tlb_kernel_range(unsigned long start, unsigned long end)
 {
-	unsigned long addr;
+	unsigned long pages = (end - start) >> PAGE_SHIFT;
 
-	if ((end - start) > (MAX_TLBI_OPS * PAGE_SIZE)) {
+	if (__flush_tlb_range_too_big(pages, PAGE_SIZE)) {
 		flush_tlb_all();
 		return;
 	}
 
-	start = __TLBI_VADDR(start, 0);
-	end = __TLBI_VADDR(end, 0);
-
 	dsb(ishst);
-	for (addr = start; addr < end; addr += 1 << (PAGE_SHIFT - 12))
-		__tlbi(vaale1is, addr);
+	__flush_tlb_range_op(vaale1is, start, pages, PAGE_SIZE, 0);
 	dsb(ish);
 	isb();
 }
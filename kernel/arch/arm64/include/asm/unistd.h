@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __ASM_UNISTD_H
+#define __ASM_UNISTD_H
+
+#include <uapi/rtochius/unistd.h>
+
+/*
+ * Syscalls numbered below this are dispatched by el0_svc_fast in
+ * entry.S without a full pt_regs spill. They may clobber x9-x17.
+ */
+#define __NR_fast_syscalls		3
+
+#endif /* !__ASM_UNISTD_H */
@@ -19,6 +19,8 @@
 #include <base/types.h>
 #include <base/linkage.h>
 #include <base/overflow.h>
+#include <base/common.h>
+#include <base/cache.h>
 
 #include <rtochius/cpumask.h>
 #include <rtochius/spinlock.h>
@@ -27,6 +29,7 @@
 #include <rtochius/slab.h>
 
 #include <asm/mmu_context.h>
+#include <asm/tlbflush.h>
 
 static u32 asid_bits;
 static DEFINE_RAW_SPINLOCK(cpu_asid_lock);
@@ -38,6 +41,20 @@ static DEFINE_PER_CPU(atomic64_t, active_asids);
 static DEFINE_PER_CPU(u64, reserved_asids);
 static cpumask_t tlb_flush_pending;
 
+unsigned long tlbi_max_ops __read_mostly = PTRS_PER_PTE;
+
+static int __init setup_tlbi_max_ops(char *p)
+{
+	unsigned long ops;
+
+	if (!p || kstrtoul(p, 0, &ops) || !ops)
+		return -EINVAL;
+
+	tlbi_max_ops = ops;
+	return 0;
+}
+early_param("tlbi_max_ops", setup_tlbi_max_ops);
+
 #define ASID_MASK		(~GENMASK(asid_bits - 1, 0))
 #define ASID_FIRST_VERSION	(1UL << asid_bits)
 
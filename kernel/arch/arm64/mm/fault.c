@@ -18,11 +18,19 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <rtochius/mm.h>
+#include <rtochius/mmap.h>
+#include <rtochius/sched.h>
+#include <rtochius/spinlock.h>
 
 #include <asm/exception.h>
+#include <asm/esr.h>
+#include <asm/extable.h>
+#include <asm/ptrace.h>
 
 #include <asm/base/cmpxchg.h>
 
+#include <base/errno.h>
+
 /*
  * This function sets the access flags (dirty, accessed), as well as write
  * permission, and only to a more permissive setting.
@@ -66,10 +74,68 @@ int ptep_set_access_flags(struct vm_area_struct *vma,
 	return 1;
 }
 
+static inline bool is_el0_instruction_abort(unsigned int esr)
+{
+	return ESR_ELx_EC(esr) == ESR_ELx_EC_IABT_LOW;
+}
+
+/* Cache maintenance operations report as writes, but only need to read. */
+static inline bool is_write_abort(unsigned int esr)
+{
+	return (esr & ESR_ELx_WNR) && !(esr & ESR_ELx_CM);
+}
+
+/*
+ * Resolve a translation, access flag or permission fault on a user
+ * address of the current address space. Returns 0 once the access can
+ * be retried.
+ */
+static int do_page_fault(unsigned long addr, unsigned int esr,
+			 struct pt_regs *regs)
+{
+	struct mm_struct *mm = current->mm;
+	struct vm_area_struct *vma;
+	unsigned int flags = 0;
+	int ret;
+
+	switch (esr & ESR_ELx_FSC_TYPE) {
+	case ESR_ELx_FSC_FAULT:
+	case ESR_ELx_FSC_ACCESS:
+	case ESR_ELx_FSC_PERM:
+		break;
+	default:
+		return -EFAULT;
+	}
+
+	if (addr >= TASK_SIZE || !mm)
+		return -EFAULT;
+
+	if (is_el0_instruction_abort(esr))
+		flags |= FAULT_FLAG_INSTRUCTION;
+	else if (is_write_abort(esr))
+		flags |= FAULT_FLAG_WRITE;
+
+	read_lock(&mm->mmap_lock);
+	vma = find_vma(mm, addr);
+	if (vma && vma->vm_start <= addr)
+		ret = handle_mm_fault(vma, addr, flags);
+	else
+		ret = -EFAULT;
+	read_unlock(&mm->mmap_lock);
+
+	return ret;
+}
 
 asmlinkage void __exception do_mem_abort(unsigned long addr, unsigned int esr,
 					 struct pt_regs *regs)
 {
+	if (!do_page_fault(addr, esr, regs))
+		return;
+
+	/* A uaccess routine of the kernel gets to handle it. */
+	if (!user_mode(regs) && fixup_exception(regs))
+		return;
+
 	panic("Data abort sync, addr: 0x%lx, esr: 0x%x\n", addr, esr);
 }
 
@@ -91,6 +157,9 @@ asmlinkage void __exception do_el0_ia_bp_hardening(unsigned long addr,
 						   unsigned int esr,
 						   struct pt_regs *regs)
 {
+	if (!do_page_fault(addr, esr, regs))
+		return;
+
 	panic("el0 Instruction abort handling sync, addr: 0x%lx, esr: 0x%x\n", addr, esr);
 }
 
@@ -388,6 +388,31 @@ static phys_addr_t pgd_pgtable_alloc(void)
 	return __pa(ptr);
 }
 
+/**
+ * create_user_mapping - map a physically contiguous range into @mm
+ * @mm: the user address space
+ * @phys: physical start address
+ * @virt: user virtual start address
+ * @size: size in bytes
+ * @prot: page protection
+ *
+ * Only ever uses page sized entries without the contiguous bit: the fault,
+ * fork and unmap paths change user PTEs one at a time, which a contiguous
+ * block does not allow. The PTEs are checked and written under
+ * mm->page_table_lock, and each page gets a reference.
+ *
+ * Returns -EEXIST if part of the range is mapped already and -ENOMEM if a
+ * page table can't be allocated, with nothing mapped in either case.
+ */
+int create_user_mapping(struct mm_struct *mm, phys_addr_t phys,
+			unsigned long virt, phys_addr_t size, pgprot_t prot)
+{
+	BUG_ON(mm == &init_mm);
+
+	return map_user_pages(mm, virt, phys_to_page(phys), size >> PAGE_SHIFT,
+			      prot);
+}
+
 int __init __create_iomap_remap(phys_addr_t phys_addr, u64 virt,
 					size_t size, pgprot_t prot, int flags)
 {
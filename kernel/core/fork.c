@@ -11,9 +11,23 @@
  * Fork is rather simple, once you get the hang of it, but the memory
  * management can be a bitch. See 'mm/memory.c': 'copy_page_range()'
  */
+#include <base/rbtree.h>
+#include <base/err.h>
+
 #include <rtochius/sched.h>
+#include <rtochius/sched/mm.h>
 #include <rtochius/sched/task.h>
 #include <rtochius/sched/task_stack.h>
+#include <rtochius/mm_types.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/slab.h>
+#include <rtochius/gfp.h>
+#include <rtochius/mmap.h>
+#include <rtochius/smp.h>
+
+#include <uapi/rtochius/sched.h>
+
+#include <asm/pgalloc.h>
 
 void set_task_stack_end_magic(struct task_struct *tsk)
 {
@@ -23,8 +37,15 @@ void set_task_stack_end_magic(struct task_struct *tsk)
 	*stackend = STACK_END_MAGIC;	/* for overflow detection */
 }
 
+#define THREAD_STACK_ORDER	get_order(THREAD_SIZE)
+
+/* The last pid handed out, pids are never reused: */
+static atomic_t last_pid = ATOMIC_INIT(0);
+
 static void release_task_stack(struct task_struct *tsk)
 {
+	free_pages((unsigned long)tsk->stack, THREAD_STACK_ORDER);
+	tsk->stack = NULL;
 }
 
 void put_task_stack(struct task_struct *tsk)
@@ -40,6 +61,8 @@ void thread_stack_cache_init(void)
 
 void __put_task_struct(struct task_struct *tsk)
 {
+	WARN_ON(tsk == &init_task);
+	kfree(tsk);
 }
 
 int __weak arch_dup_task_struct(struct task_struct *dst,
@@ -48,3 +71,194 @@ int __weak arch_dup_task_struct(struct task_struct *dst,
 	*dst = *src;
 	return 0;
 }
+
+/*
+ * Only init_mm is set up statically, every other address space goes
+ * through here before find_vma(), dup_mmap() or a fault may look at it.
+ */
+static struct mm_struct *mm_init(struct mm_struct *mm)
+{
+	mm->mm_rb = RB_ROOT;
+	rwlock_init(&mm->mmap_lock);
+	spin_lock_init(&mm->page_table_lock);
+	mm->pmd_huge_pte = NULL;
+	atomic_long_set(&mm->pgtables_bytes, 0);
+	atomic_set(&mm->tlb_flush_pending, 0);
+
+	mm->pgd = pgd_alloc(mm);
+	if (unlikely(!mm->pgd)) {
+		kfree(mm);
+		return NULL;
+	}
+
+	return mm;
+}
+
+/*
+ * Allocate and initialize an mm_struct.
+ */
+struct mm_struct *mm_alloc(void)
+{
+	struct mm_struct *mm;
+
+	mm = kzalloc(sizeof(*mm), GFP_KERNEL);
+	if (!mm)
+		return NULL;
+
+	return mm_init(mm);
+}
+
+static struct task_struct *dup_task_struct(struct task_struct *orig)
+{
+	struct task_struct *tsk;
+	unsigned long stack;
+
+	tsk = kmalloc(sizeof(*tsk), GFP_KERNEL);
+	if (!tsk)
+		return NULL;
+
+	/* Buddy blocks are aligned to their size, as THREAD_ALIGN wants. */
+	stack = __get_free_pages(GFP_KERNEL, THREAD_STACK_ORDER);
+	if (!stack) {
+		kfree(tsk);
+		return NULL;
+	}
+
+	arch_dup_task_struct(tsk, orig);
+	tsk->stack = (void *)stack;
+	clear_tsk_need_resched(tsk);
+	set_task_stack_end_magic(tsk);
+
+	/*
+	 * Nobody waits for children yet, the only reference is the one
+	 * for running as current, dropped by finish_task_switch().
+	 */
+	atomic_set(&tsk->usage, 1);
+	atomic_set(&tsk->stack_refcount, 1);
+
+	return tsk;
+}
+
+static int copy_mm(unsigned long clone_flags, struct task_struct *tsk)
+{
+	struct mm_struct *oldmm = current->mm;
+	struct mm_struct *mm;
+	int err;
+
+	/* Kernel threads and CLONE_VM children run on the parent's mm. */
+	if (!oldmm || (clone_flags & CLONE_VM))
+		return 0;
+
+	mm = mm_alloc();
+	if (!mm)
+		return -ENOMEM;
+
+	err = dup_mmap(mm, oldmm);
+	if (err)
+		return err;
+
+	tsk->mm = tsk->active_mm = mm;
+
+	return 0;
+}
+
+/*
+ * Create a new task as a copy of current, ready for wake_up_new_task()
+ * but not on any runqueue yet.
+ */
+static struct task_struct *copy_process(unsigned long clone_flags,
+					unsigned long stack_start,
+					unsigned long stack_size)
+{
+	struct task_struct *p;
+	int err;
+
+	p = dup_task_struct(current);
+	if (!p)
+		return ERR_PTR(-ENOMEM);
+
+	/* Only the tasks started as drivers are given PF_DRIVER. */
+	p->flags &= ~(PF_IDLE | PF_DRIVER);
+	spin_lock_init(&p->alloc_lock);
+	raw_spin_lock_init(&p->pi_lock);
+	INIT_LIST_HEAD(&p->children);
+	INIT_LIST_HEAD(&p->sibling);
+
+	p->pid = atomic_inc_return(&last_pid);
+	if (clone_flags & CLONE_THREAD) {
+		p->tgid = current->tgid;
+		p->group_leader = current->group_leader;
+	} else {
+		p->tgid = p->pid;
+		p->group_leader = p;
+	}
+	p->real_parent = current;
+
+	err = sched_fork(clone_flags, p);
+	if (err)
+		goto bad_fork_free;
+
+	err = copy_mm(clone_flags, p);
+	if (err)
+		goto bad_fork_free;
+
+	err = copy_thread_tls(clone_flags, stack_start, stack_size, p, 0);
+	if (err)
+		goto bad_fork_free;
+
+	return p;
+
+bad_fork_free:
+	release_task_stack(p);
+	kfree(p);
+	return ERR_PTR(err);
+}
+
+/**
+ * _do_fork - create a task and put it on a runqueue
+ * @clone_flags: CLONE_* flags
+ * @stack_start: the child's user stack, or the function a kernel thread runs
+ * @stack_size: the argument of a kernel thread's function
+ *
+ * Returns the pid of the child or a negative error.
+ */
+long _do_fork(unsigned long clone_flags, unsigned long stack_start,
+	      unsigned long stack_size)
+{
+	struct task_struct *p;
+	pid_t pid;
+
+	p = copy_process(clone_flags, stack_start, stack_size);
+	if (IS_ERR(p))
+		return PTR_ERR(p);
+
+	/* Read before the child gets a chance to run and go away. */
+	pid = task_pid_nr(p);
+	wake_up_new_task(p);
+
+	return pid;
+}
+
+/*
+ * Create a kernel thread running @fn(@arg).
+ */
+pid_t kernel_thread(int (*fn)(void *), void *arg, unsigned long flags)
+{
+	return _do_fork(flags | CLONE_VM, (unsigned long)fn,
+			(unsigned long)arg);
+}
+
+/*
+ * The idle task of a secondary CPU. It never goes through
+ * wake_up_new_task(), init_idle() makes it the CPU's current task.
+ */
+struct task_struct *fork_idle(int cpu)
+{
+	struct task_struct *task;
+
+	task = copy_process(CLONE_VM, 0, 0);
+	if (!IS_ERR(task))
+		init_idle(task, cpu);
+
+	return task;
+}
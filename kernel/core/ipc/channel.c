@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Shared-memory ring channels between servers.
+ *
+ * The kernel allocates the ring, initialises its header through the
+ * linear map and maps the very same pages into each address space that
+ * asks for them. Producers and the consumer then exchange slots with
+ * the lock-less operations of <base/ring.h> and never enter the kernel
+ * for it, except to sleep when the ring is empty (consumer) or full
+ * (producers), and to wake a sleeper up again. The waiting flags in the
+ * ring header tell a producer or consumer whether that is needed.
+ *
+ * Only the creator of a channel and the tasks it shares it with may map
+ * the ring, unless it was created CHANNEL_PUBLIC.
+ */
+#define pr_fmt(fmt) "channel: " fmt
+
+#include <base/compiler.h>
+#include <base/common.h>
+#include <base/errno.h>
+#include <base/log2.h>
+#include <base/ring.h>
+
+#include <rtochius/ipc.h>
+#include <rtochius/syscalls.h>
+#include <rtochius/sched.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/swait.h>
+#include <rtochius/slab.h>
+#include <rtochius/idr.h>
+#include <rtochius/mm.h>
+#include <rtochius/printf.h>
+
+#include <uapi/rtochius/channel.h>
+
+#include <asm/ptrace.h>
+
+struct channel {
+	struct ring_hdr		*ring;
+	struct page		*pages;
+	unsigned int		order;
+	unsigned int		flags;
+	pid_t			owner;
+	/* Tasks the owner lets map the ring, 0 for a free slot: */
+	pid_t			peers[CHANNEL_MAX_PEERS];
+	/* The consumer, waiting for data: */
+	struct swait_queue_head	data_wq;
+	/* Producers, waiting for space: */
+	struct swait_queue_head	space_wq;
+};
+
+/*
+ * Channels live as long as the system does: nothing tracks which address
+ * spaces still map a ring, so there is no way to tear one down yet.
+ */
+static DEFINE_IDR(channel_idr);
+static DEFINE_SPINLOCK(channel_lock);
+
+static struct channel *channel_find(unsigned long id)
+{
+	struct channel *ch;
+
+	if (unlikely(id > INT_MAX))
+		return NULL;
+
+	spin_lock(&channel_lock);
+	ch = idr_find(&channel_idr, id);
+	spin_unlock(&channel_lock);
+
+	return ch;
+}
+
+static bool channel_may_map(struct channel *ch, pid_t pid)
+{
+	int i;
+
+	if ((ch->flags & CHANNEL_PUBLIC) || pid == ch->owner)
+		return true;
+
+	for (i = 0; i < CHANNEL_MAX_PEERS; i++) {
+		if (READ_ONCE(ch->peers[i]) == pid)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * sys_channel_create - allocate a ring of x0 slots of x1 bytes each.
+ *
+ * x2 holds CHANNEL_* flags. Returns the channel id or a negative error.
+ */
+asmlinkage long sys_channel_create(struct pt_regs *regs)
+{
+	unsigned long nr_slots = regs->regs[0];
+	unsigned long slot_size = regs->regs[1];
+	unsigned long flags = regs->regs[2];
+	struct channel *ch;
+	int id;
+
+	if (nr_slots < 2 || nr_slots > CHANNEL_MAX_SLOTS ||
+	    !is_power_of_2(nr_slots))
+		return -EINVAL;
+	if (!slot_size || slot_size > CHANNEL_MAX_SLOT_SIZE ||
+	    !IS_ALIGNED(slot_size, sizeof(u64)))
+		return -EINVAL;
+	if (RING_BYTES(nr_slots, slot_size) > CHANNEL_MAX_BYTES ||
+	    get_order(RING_BYTES(nr_slots, slot_size)) >= MAX_ORDER)
+		return -EINVAL;
+	if (flags & ~(CHANNEL_MP | CHANNEL_PUBLIC))
+		return -EINVAL;
+
+	ch = kzalloc(sizeof(*ch), GFP_KERNEL);
+	if (!ch)
+		return -ENOMEM;
+
+	ch->flags = flags;
+	ch->owner = ipc_current_pid();
+	ch->order = get_order(RING_BYTES(nr_slots, slot_size));
+	ch->pages = alloc_pages(GFP_KERNEL | GFP_ZERO | __GFP_COMPACT,
+				ch->order);
+	if (!ch->pages) {
+		kfree(ch);
+		return -ENOMEM;
+	}
+
+	ch->ring = page_address(ch->pages);
+	ring_init(ch->ring, nr_slots, slot_size,
+		  flags & CHANNEL_MP ? RING_F_MP : 0);
+	init_swait_queue_head(&ch->data_wq);
+	init_swait_queue_head(&ch->space_wq);
+
+	spin_lock(&channel_lock);
+	id = idr_alloc(&channel_idr, ch, 0, 0, GFP_KERNEL);
+	spin_unlock(&channel_lock);
+
+	if (id < 0) {
+		__free_pages(ch->pages, ch->order);
+		kfree(ch);
+	}
+
+	return id;
+}
+
+/*
+ * sys_channel_share - let the task with pid x1 map channel x0. Only its
+ * owner may share it.
+ */
+asmlinkage long sys_channel_share(struct pt_regs *regs)
+{
+	unsigned long pid = regs->regs[1];
+	struct channel *ch;
+	int i, free = -1;
+	long ret = 0;
+
+	ch = channel_find(regs->regs[0]);
+	if (!ch)
+		return -EINVAL;
+	if (ch->owner != ipc_current_pid())
+		return -EPERM;
+	if (!pid || pid > INT_MAX)
+		return -EINVAL;
+
+	spin_lock(&channel_lock);
+	for (i = 0; i < CHANNEL_MAX_PEERS; i++) {
+		if (ch->peers[i] == pid)
+			goto out_unlock;
+		if (!ch->peers[i] && free < 0)
+			free = i;
+	}
+	if (free < 0)
+		ret = -ENOSPC;
+	else
+		WRITE_ONCE(ch->peers[free], pid);
+out_unlock:
+	spin_unlock(&channel_lock);
+
+	return ret;
+}
+
+/*
+ * sys_channel_map - map channel x0 at the page aligned user address x1.
+ *
+ * Returns the size of the mapping in bytes or a negative error, -EPERM
+ * if the channel was not shared with the caller.
+ */
+asmlinkage long sys_channel_map(struct pt_regs *regs)
+{
+	unsigned long addr = regs->regs[1];
+	struct mm_struct *mm = current->mm;
+	struct channel *ch;
+	int err;
+
+	ch = channel_find(regs->regs[0]);
+	if (!ch)
+		return -EINVAL;
+	if (!mm)
+		return -EINVAL;
+	if (!channel_may_map(ch, ipc_current_pid()))
+		return -EPERM;
+
+	err = map_user_pages(mm, addr, ch->pages, 1UL << ch->order,
+			     PAGE_SHARED);
+	if (err)
+		return err;
+
+	return PAGE_SIZE << ch->order;
+}
+
+/* The waiting flag the sleeper publishes in the ring. */
+static inline atomic_t *channel_waiting(struct channel *ch, int what)
+{
+	return what == CHANNEL_DATA ? &ch->ring->cons_waiting :
+				      &ch->ring->prod_waiting;
+}
+
+/* The condition the sleeper waits to become false. */
+static inline bool channel_blocked(struct channel *ch, int what)
+{
+	return what == CHANNEL_DATA ? ring_empty(ch->ring) :
+				      ring_full(ch->ring);
+}
+
+/*
+ * sys_channel_wait - sleep until channel x0 is no longer empty (x1 is
+ * CHANNEL_DATA) or no longer full (CHANNEL_SPACE).
+ *
+ * The ring is re-checked through the kernel mapping after the waiting
+ * flag is set again, so a notification can't be lost between the caller's
+ * own check and the sleep. Returns 0 or a negative error, -EPERM for a
+ * task that may not map the channel.
+ */
+asmlinkage long sys_channel_wait(struct pt_regs *regs)
+{
+	unsigned long what = regs->regs[1];
+	struct swait_queue_head *wq;
+	struct channel *ch;
+	DECLARE_SWAITQUEUE(wait);
+
+	ch = channel_find(regs->regs[0]);
+	if (!ch)
+		return -EINVAL;
+	if (!channel_may_map(ch, ipc_current_pid()))
+		return -EPERM;
+	if (what != CHANNEL_DATA && what != CHANNEL_SPACE)
+		return -EINVAL;
+
+	wq = what == CHANNEL_DATA ? &ch->data_wq : &ch->space_wq;
+
+	for (;;) {
+		prepare_to_swait_exclusive(wq, &wait, TASK_INTERRUPTIBLE);
+		atomic_set(channel_waiting(ch, what), 1);
+		/*
+		 * Pairs with the smp_mb() in ring_produce_commit() and
+		 * ring_consume_release().
+		 */
+		smp_mb();
+		if (!channel_blocked(ch, what))
+			break;
+		schedule();
+	}
+	finish_swait(wq, &wait);
+
+	return 0;
+}
+
+/*
+ * sys_channel_notify - wake the consumer of channel x0 (x1 is
+ * CHANNEL_DATA) or the producers waiting for space (CHANNEL_SPACE).
+ * Like channel_wait, open only to the tasks that may map the channel.
+ */
+asmlinkage long sys_channel_notify(struct pt_regs *regs)
+{
+	unsigned long what = regs->regs[1];
+	struct channel *ch;
+
+	ch = channel_find(regs->regs[0]);
+	if (!ch)
+		return -EINVAL;
+	if (!channel_may_map(ch, ipc_current_pid()))
+		return -EPERM;
+
+	switch (what) {
+	case CHANNEL_DATA:
+		atomic_set(&ch->ring->cons_waiting, 0);
+		swake_up_one(&ch->data_wq);
+		break;
+	case CHANNEL_SPACE:
+		atomic_set(&ch->ring->prod_waiting, 0);
+		swake_up_all(&ch->space_wq);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
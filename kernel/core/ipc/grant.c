@@ -0,0 +1,358 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Zero-copy page grants between address spaces.
+ *
+ * A grant pins the pages behind a range of the owner's address space
+ * and maps them into the receiver by writing its page tables directly,
+ * one physically contiguous run at a time through create_user_mapping().
+ * The receiver's PTEs never get the contiguous bit, the fault and unmap
+ * paths must be free to change them one at a time.
+ */
+#define pr_fmt(fmt) "grant: " fmt
+
+#include <base/compiler.h>
+#include <base/common.h>
+#include <base/errno.h>
+#include <base/atomic.h>
+
+#include <rtochius/ipc.h>
+#include <rtochius/syscalls.h>
+#include <rtochius/sched.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/percpu.h>
+#include <rtochius/slab.h>
+#include <rtochius/idr.h>
+#include <rtochius/mm.h>
+#include <rtochius/printf.h>
+
+#include <uapi/rtochius/grant.h>
+
+#include <asm/ptrace.h>
+#include <asm/mmu.h>
+
+struct grant {
+	spinlock_t		lock;
+	atomic_t		refcount;
+	unsigned int		flags;
+	bool			revoked;
+	struct mm_struct	*owner;
+	pid_t			owner_pid;
+	/* The only task that may map the grant: */
+	pid_t			receiver;
+	/* Where the receiver has the pages mapped, if it does: */
+	struct mm_struct	*mapped_mm;
+	unsigned long		mapped_addr;
+	unsigned long		nr_pages;
+	/* One reference held on each: */
+	struct page		*pages[];
+};
+
+struct grant_stats {
+	unsigned long		pages_granted;
+	unsigned long		pages_mapped;
+	/* Physically contiguous runs the mapped pages came in: */
+	unsigned long		runs;
+};
+
+static DEFINE_PER_CPU(struct grant_stats, grant_stats);
+
+static DEFINE_IDR(grant_idr);
+static DEFINE_SPINLOCK(grant_lock);
+
+static struct grant *grant_get(unsigned long id)
+{
+	struct grant *g;
+
+	if (unlikely(id > INT_MAX))
+		return NULL;
+
+	spin_lock(&grant_lock);
+	g = idr_find(&grant_idr, id);
+	if (g)
+		atomic_inc(&g->refcount);
+	spin_unlock(&grant_lock);
+
+	return g;
+}
+
+static void grant_release_pages(struct grant *g)
+{
+	unsigned long i;
+
+	for (i = 0; i < g->nr_pages; i++)
+		put_page(g->pages[i]);
+}
+
+static void grant_put(struct grant *g)
+{
+	if (atomic_dec_and_test(&g->refcount)) {
+		grant_release_pages(g);
+		kfree(g);
+	}
+}
+
+static inline bool user_range_ok(unsigned long addr, unsigned long nr_pages)
+{
+	return PAGE_ALIGNED(addr) && nr_pages && nr_pages <= GRANT_MAX_PAGES &&
+	       addr < TASK_SIZE && (nr_pages << PAGE_SHIFT) <= TASK_SIZE - addr;
+}
+
+/*
+ * sys_grant_create - grant x1 pages of the caller's memory at x0 to the
+ * task with pid x3.
+ *
+ * x2 holds GRANT_* flags. Returns the grant id or a negative error.
+ */
+asmlinkage long sys_grant_create(struct pt_regs *regs)
+{
+	unsigned long addr = regs->regs[0];
+	unsigned long nr_pages = regs->regs[1];
+	unsigned long flags = regs->regs[2];
+	unsigned long receiver = regs->regs[3];
+	struct mm_struct *mm = current->mm;
+	struct grant *g;
+	unsigned long i;
+	int id;
+
+	if (!mm || !user_range_ok(addr, nr_pages))
+		return -EINVAL;
+	if (flags & ~(GRANT_WRITE | GRANT_TRANSFER))
+		return -EINVAL;
+	if (!receiver || receiver > INT_MAX)
+		return -EINVAL;
+
+	g = kzalloc(sizeof(*g) + nr_pages * sizeof(g->pages[0]), GFP_KERNEL);
+	if (!g)
+		return -ENOMEM;
+
+	spin_lock_init(&g->lock);
+	atomic_set(&g->refcount, 1);
+	g->flags = flags;
+	g->owner = mm;
+	g->owner_pid = ipc_current_pid();
+	g->receiver = receiver;
+
+	for (i = 0; i < nr_pages; i++) {
+		g->pages[i] = pin_user_page(mm, addr + (i << PAGE_SHIFT),
+					    flags & GRANT_WRITE);
+		if (!g->pages[i]) {
+			grant_put(g);
+			return -EFAULT;
+		}
+		g->nr_pages++;
+	}
+
+	/*
+	 * Reserve the id before a transfer takes the pages away from the
+	 * owner, and publish the grant only once they are gone.
+	 */
+	spin_lock(&grant_lock);
+	id = idr_alloc(&grant_idr, NULL, 0, 0, GFP_KERNEL);
+	spin_unlock(&grant_lock);
+
+	if (id < 0) {
+		grant_put(g);
+		return id;
+	}
+
+	if (flags & GRANT_TRANSFER)
+		unmap_user_pages(mm, addr, nr_pages);
+
+	spin_lock(&grant_lock);
+	idr_replace(&grant_idr, g, id);
+	spin_unlock(&grant_lock);
+
+	this_cpu_add(grant_stats.pages_granted, nr_pages);
+
+	return id;
+}
+
+/*
+ * Map the grant at @addr, one physically contiguous run at a time. The
+ * mapping holds its own page references. On failure the runs mapped so
+ * far are taken down again.
+ */
+static int grant_map_pages(struct grant *g, struct mm_struct *mm,
+			   unsigned long addr)
+{
+	pgprot_t prot = g->flags & GRANT_WRITE ? PAGE_SHARED : PAGE_READONLY;
+	unsigned long i, j;
+	int err;
+
+	for (i = 0; i < g->nr_pages; i = j) {
+		phys_addr_t phys = page_to_phys(g->pages[i]);
+
+		for (j = i + 1; j < g->nr_pages; j++) {
+			if (page_to_phys(g->pages[j]) !=
+			    phys + ((j - i) << PAGE_SHIFT))
+				break;
+		}
+
+		err = create_user_mapping(mm, phys, addr + (i << PAGE_SHIFT),
+					  (j - i) << PAGE_SHIFT, prot);
+		if (err) {
+			if (i)
+				unmap_user_pages(mm, addr, i);
+			return err;
+		}
+		this_cpu_inc(grant_stats.runs);
+	}
+
+	this_cpu_add(grant_stats.pages_mapped, g->nr_pages);
+
+	return 0;
+}
+
+/*
+ * sys_grant_map - map grant x0 at the page aligned user address x1.
+ *
+ * The range must be unmapped, otherwise -EEXIST is returned. A transferred
+ * grant is used up by this and its id is gone afterwards.
+ */
+asmlinkage long sys_grant_map(struct pt_regs *regs)
+{
+	unsigned long id = regs->regs[0];
+	unsigned long addr = regs->regs[1];
+	struct mm_struct *mm = current->mm;
+	struct grant *g;
+	long ret = 0;
+
+	g = grant_get(id);
+	if (!g)
+		return -EINVAL;
+
+	if (g->receiver != ipc_current_pid()) {
+		ret = -EPERM;
+		goto out;
+	}
+
+	if (!mm || !user_range_ok(addr, g->nr_pages)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	spin_lock(&g->lock);
+	if (g->revoked) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+	if (g->mapped_mm) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	ret = grant_map_pages(g, mm, addr);
+	if (ret)
+		goto out_unlock;
+
+	g->mapped_mm = mm;
+	g->mapped_addr = addr;
+	spin_unlock(&g->lock);
+
+	if (g->flags & GRANT_TRANSFER) {
+		/* The mapping owns the pages now, drop the grant's id. */
+		spin_lock(&grant_lock);
+		if (idr_remove(&grant_idr, id) == g)
+			grant_put(g);
+		spin_unlock(&grant_lock);
+	}
+out:
+	grant_put(g);
+
+	return ret;
+
+out_unlock:
+	spin_unlock(&g->lock);
+	grant_put(g);
+
+	return ret;
+}
+
+/*
+ * sys_grant_unmap - the receiver gives lent grant x0 back.
+ */
+asmlinkage long sys_grant_unmap(struct pt_regs *regs)
+{
+	struct mm_struct *mm = current->mm;
+	unsigned long addr;
+	struct grant *g;
+
+	g = grant_get(regs->regs[0]);
+	if (!g)
+		return -EINVAL;
+
+	if (g->receiver != ipc_current_pid()) {
+		grant_put(g);
+		return -EPERM;
+	}
+
+	spin_lock(&g->lock);
+	if (!mm || g->mapped_mm != mm) {
+		spin_unlock(&g->lock);
+		grant_put(g);
+		return -EINVAL;
+	}
+	addr = g->mapped_addr;
+	g->mapped_mm = NULL;
+	spin_unlock(&g->lock);
+
+	unmap_user_pages(mm, addr, g->nr_pages);
+	grant_put(g);
+
+	return 0;
+}
+
+/*
+ * sys_grant_revoke - the owner ends grant x0, unmapping it from the
+ * receiver if needed.
+ */
+asmlinkage long sys_grant_revoke(struct pt_regs *regs)
+{
+	unsigned long id = regs->regs[0];
+	struct mm_struct *mapped_mm;
+	unsigned long addr;
+	struct grant *g;
+
+	if (id > INT_MAX)
+		return -EINVAL;
+
+	spin_lock(&grant_lock);
+	g = idr_find(&grant_idr, id);
+	if (g && (g->owner != current->mm ||
+		  g->owner_pid != ipc_current_pid())) {
+		spin_unlock(&grant_lock);
+		return -EPERM;
+	}
+	if (g)
+		idr_remove(&grant_idr, id);
+	spin_unlock(&grant_lock);
+
+	if (!g)
+		return -EINVAL;
+
+	spin_lock(&g->lock);
+	g->revoked = true;
+	mapped_mm = g->mapped_mm;
+	addr = g->mapped_addr;
+	g->mapped_mm = NULL;
+	spin_unlock(&g->lock);
+
+	if (mapped_mm)
+		unmap_user_pages(mapped_mm, addr, g->nr_pages);
+
+	grant_put(g);
+
+	return 0;
+}
+
+void show_grant_stats(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct grant_stats *st = per_cpu_ptr(&grant_stats, cpu);
+
+		pr_info("CPU%d: granted %lu mapped %lu in %lu runs\n",
+			cpu, st->pages_granted, st->pages_mapped, st->runs);
+	}
+}
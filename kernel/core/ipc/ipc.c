@@ -0,0 +1,418 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Synchronous call/reply IPC over endpoints.
+ *
+ * An endpoint is a rendezvous point: a caller blocks on it until a
+ * server is waiting, the message is copied register to register
+ * between the two saved pt_regs and the caller then waits for the
+ * reply. A server answers and waits for its next caller in one step
+ * with ipc_reply_wait.
+ *
+ * Whenever the partner is already blocked, the sender switches to it
+ * directly with schedule_direct() and lends it the rest of its
+ * timeslice, so a round trip on one CPU never goes through
+ * pick_next_task().
+ *
+ * The creator of an endpoint serves it, callers have to be named with
+ * ipc_endpoint_share unless it was created IPC_ENDPOINT_PUBLIC.
+ */
+#define pr_fmt(fmt) "ipc: " fmt
+
+#include <base/compiler.h>
+#include <base/common.h>
+#include <base/errno.h>
+#include <base/atomic.h>
+
+#include <rtochius/ipc.h>
+#include <rtochius/syscalls.h>
+#include <rtochius/sched.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/percpu.h>
+#include <rtochius/slab.h>
+#include <rtochius/idr.h>
+#include <rtochius/printf.h>
+
+#include <asm/ptrace.h>
+
+struct ipc_endpoint {
+	raw_spinlock_t		lock;
+	atomic_t		refcount;
+	bool			dead;
+	unsigned int		flags;
+	pid_t			owner;
+	/* Tasks the owner lets call, 0 for a free slot: */
+	pid_t			peers[IPC_ENDPOINT_MAX_PEERS];
+	/* Callers waiting for a server: */
+	struct list_head	sendq;
+	/* Servers waiting for a caller: */
+	struct list_head	recvq;
+};
+
+struct ipc_stats {
+	unsigned long		calls;
+	unsigned long		replies;
+	/* Calls that found a server waiting and were handed to it: */
+	unsigned long		direct;
+	/* Calls that had to queue for a server: */
+	unsigned long		queued;
+};
+
+static DEFINE_PER_CPU(struct ipc_stats, ipc_stats);
+
+static DEFINE_IDR(ipc_endpoint_idr);
+static DEFINE_SPINLOCK(ipc_endpoint_lock);
+
+/**
+ * ipc_current_pid - the pid IPC objects check access against
+ *
+ * That is the caller's own pid, except while the idle task runs the calls
+ * of an SQPOLL ring, which it does on behalf of the ring's owner.
+ */
+pid_t ipc_current_pid(void)
+{
+	return current->ipc.sqpoll_pid ?: task_pid_nr(current);
+}
+
+static struct ipc_endpoint *ipc_endpoint_get(unsigned long id)
+{
+	struct ipc_endpoint *ep;
+
+	if (unlikely(id > INT_MAX))
+		return NULL;
+
+	spin_lock(&ipc_endpoint_lock);
+	ep = idr_find(&ipc_endpoint_idr, id);
+	if (ep)
+		atomic_inc(&ep->refcount);
+	spin_unlock(&ipc_endpoint_lock);
+
+	return ep;
+}
+
+static void ipc_endpoint_put(struct ipc_endpoint *ep)
+{
+	if (atomic_dec_and_test(&ep->refcount))
+		kfree(ep);
+}
+
+static bool ipc_endpoint_may_call(struct ipc_endpoint *ep, pid_t pid)
+{
+	int i;
+
+	if ((ep->flags & IPC_ENDPOINT_PUBLIC) || pid == ep->owner)
+		return true;
+
+	for (i = 0; i < IPC_ENDPOINT_MAX_PEERS; i++) {
+		if (READ_ONCE(ep->peers[i]) == pid)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Copy the tag and the message registers it covers. Both sides are
+ * saved user register frames: @from belongs to a thread which is blocked
+ * or is current, @to to one which is blocked or is current.
+ */
+static __always_inline void ipc_copy_msg(struct pt_regs *to,
+					 const struct pt_regs *from)
+{
+	unsigned long tag = from->regs[1];
+	unsigned int i, len;
+
+	len = min_t(unsigned long, IPC_TAG_LEN(tag), IPC_MSG_REGS);
+	to->regs[1] = IPC_TAG(IPC_TAG_LABEL(tag), len);
+	for (i = 0; i < len; i++)
+		to->regs[2 + i] = from->regs[2 + i];
+}
+
+/*
+ * Hand a blocked thread its syscall return value. It still has to be
+ * woken by the caller, either through wake_up_process() or by switching
+ * to it directly.
+ */
+static inline void ipc_deliver(struct task_struct *p, long status)
+{
+	p->ipc.status = status;
+	/* Pairs with the smp_load_acquire() in ipc_wait(): */
+	smp_store_release(&p->ipc.state, IPC_RUNNING);
+}
+
+static long ipc_wait(void)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (smp_load_acquire(&current->ipc.state) == IPC_RUNNING)
+			break;
+		schedule();
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return current->ipc.status;
+}
+
+/*
+ * sys_ipc_endpoint_create - create an endpoint served by the caller.
+ *
+ * x0 holds IPC_ENDPOINT_* flags. Returns the endpoint id or a negative
+ * error.
+ */
+asmlinkage long sys_ipc_endpoint_create(struct pt_regs *regs)
+{
+	unsigned long flags = regs->regs[0];
+	struct ipc_endpoint *ep;
+	int id;
+
+	if (flags & ~IPC_ENDPOINT_PUBLIC)
+		return -EINVAL;
+
+	ep = kzalloc(sizeof(*ep), GFP_KERNEL);
+	if (!ep)
+		return -ENOMEM;
+
+	raw_spin_lock_init(&ep->lock);
+	atomic_set(&ep->refcount, 1);
+	ep->flags = flags;
+	ep->owner = ipc_current_pid();
+	INIT_LIST_HEAD(&ep->sendq);
+	INIT_LIST_HEAD(&ep->recvq);
+
+	spin_lock(&ipc_endpoint_lock);
+	id = idr_alloc(&ipc_endpoint_idr, ep, 0, 0, GFP_KERNEL);
+	spin_unlock(&ipc_endpoint_lock);
+
+	if (id < 0)
+		kfree(ep);
+
+	return id;
+}
+
+/*
+ * sys_ipc_endpoint_share - let the task with pid x1 call endpoint x0.
+ * Only its owner may share it.
+ */
+asmlinkage long sys_ipc_endpoint_share(struct pt_regs *regs)
+{
+	unsigned long pid = regs->regs[1];
+	struct ipc_endpoint *ep;
+	int i, free = -1;
+	long ret = 0;
+
+	ep = ipc_endpoint_get(regs->regs[0]);
+	if (!ep)
+		return -EINVAL;
+	if (ep->owner != ipc_current_pid()) {
+		ret = -EPERM;
+		goto out;
+	}
+	if (!pid || pid > INT_MAX) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	spin_lock(&ipc_endpoint_lock);
+	for (i = 0; i < IPC_ENDPOINT_MAX_PEERS; i++) {
+		if (ep->peers[i] == pid)
+			goto out_unlock;
+		if (!ep->peers[i] && free < 0)
+			free = i;
+	}
+	if (free < 0)
+		ret = -ENOSPC;
+	else
+		WRITE_ONCE(ep->peers[free], pid);
+out_unlock:
+	spin_unlock(&ipc_endpoint_lock);
+out:
+	ipc_endpoint_put(ep);
+
+	return ret;
+}
+
+/*
+ * Unpublish the endpoint and fail every thread queued on it with -EPIPE.
+ * Threads already in a call keep their reply slot and get answered. Only
+ * the owner may destroy an endpoint.
+ */
+asmlinkage long sys_ipc_endpoint_destroy(struct pt_regs *regs)
+{
+	unsigned long id = regs->regs[0];
+	struct ipc_endpoint *ep;
+	struct task_struct *p, *n;
+	LIST_HEAD(waiters);
+
+	if (id > INT_MAX)
+		return -EINVAL;
+
+	spin_lock(&ipc_endpoint_lock);
+	ep = idr_find(&ipc_endpoint_idr, id);
+	if (ep && ep->owner != ipc_current_pid()) {
+		spin_unlock(&ipc_endpoint_lock);
+		return -EPERM;
+	}
+	if (ep)
+		idr_remove(&ipc_endpoint_idr, id);
+	spin_unlock(&ipc_endpoint_lock);
+
+	if (!ep)
+		return -EINVAL;
+
+	raw_spin_lock_irq(&ep->lock);
+	ep->dead = true;
+	list_splice_init(&ep->sendq, &waiters);
+	list_splice_init(&ep->recvq, &waiters);
+	raw_spin_unlock_irq(&ep->lock);
+
+	list_for_each_entry_safe(p, n, &waiters, ipc.node) {
+		list_del_init(&p->ipc.node);
+		ipc_deliver(p, -EPIPE);
+		wake_up_process(p);
+	}
+
+	ipc_endpoint_put(ep);
+
+	return 0;
+}
+
+/*
+ * sys_ipc_call - send a message on an endpoint and wait for the reply.
+ *
+ * Returns 0 with the reply in x1-x7, or a negative error, -EPERM if the
+ * endpoint was not shared with the caller.
+ */
+asmlinkage long sys_ipc_call(struct pt_regs *regs)
+{
+	struct ipc_endpoint *ep;
+	struct task_struct *dest;
+	long ret;
+
+	ep = ipc_endpoint_get(regs->regs[0]);
+	if (unlikely(!ep))
+		return -EINVAL;
+	if (unlikely(!ipc_endpoint_may_call(ep, ipc_current_pid()))) {
+		ipc_endpoint_put(ep);
+		return -EPERM;
+	}
+
+	this_cpu_inc(ipc_stats.calls);
+
+	raw_spin_lock_irq(&ep->lock);
+	if (unlikely(ep->dead)) {
+		raw_spin_unlock_irq(&ep->lock);
+		ipc_endpoint_put(ep);
+		return -EPIPE;
+	}
+
+	if (list_empty(&ep->recvq)) {
+		/* No server yet, the first one to come takes our message. */
+		current->ipc.state = IPC_BLOCKED_SEND;
+		list_add_tail(&current->ipc.node, &ep->sendq);
+		set_current_state(TASK_INTERRUPTIBLE);
+		raw_spin_unlock_irq(&ep->lock);
+
+		this_cpu_inc(ipc_stats.queued);
+		schedule();
+		goto wait;
+	}
+
+	dest = list_first_entry(&ep->recvq, struct task_struct, ipc.node);
+	list_del_init(&dest->ipc.node);
+
+	ipc_copy_msg(task_pt_regs(dest), regs);
+	dest->ipc.caller = current;
+	current->ipc.state = IPC_BLOCKED_REPLY;
+	set_current_state(TASK_INTERRUPTIBLE);
+	ipc_deliver(dest, task_pid_nr(current));
+	raw_spin_unlock_irq(&ep->lock);
+
+	this_cpu_inc(ipc_stats.direct);
+	schedule_direct(dest);
+wait:
+	ret = ipc_wait();
+	ipc_endpoint_put(ep);
+
+	return ret;
+}
+
+/*
+ * sys_ipc_reply_wait - answer the last caller, then wait on an endpoint.
+ *
+ * The reply is taken from x1-x7. Returns the pid of the next caller with
+ * its message in x1-x7, or a negative error. With nobody to answer this
+ * is a plain receive. Only the owner of the endpoint may wait on it.
+ */
+asmlinkage long sys_ipc_reply_wait(struct pt_regs *regs)
+{
+	struct task_struct *caller = current->ipc.caller;
+	struct ipc_endpoint *ep;
+	struct task_struct *src;
+	long ret;
+
+	ep = ipc_endpoint_get(regs->regs[0]);
+	if (unlikely(!ep))
+		return -EINVAL;
+	if (unlikely(ep->owner != ipc_current_pid())) {
+		ipc_endpoint_put(ep);
+		return -EPERM;
+	}
+
+	if (caller) {
+		current->ipc.caller = NULL;
+		ipc_copy_msg(task_pt_regs(caller), regs);
+		ipc_deliver(caller, 0);
+		this_cpu_inc(ipc_stats.replies);
+	}
+
+	raw_spin_lock_irq(&ep->lock);
+	if (unlikely(ep->dead)) {
+		ret = -EPIPE;
+		goto out_unlock;
+	}
+
+	if (!list_empty(&ep->sendq)) {
+		/* A caller is already queued, keep running and serve it. */
+		src = list_first_entry(&ep->sendq, struct task_struct, ipc.node);
+		list_del_init(&src->ipc.node);
+		src->ipc.state = IPC_BLOCKED_REPLY;
+		current->ipc.caller = src;
+		ipc_copy_msg(regs, task_pt_regs(src));
+		ret = task_pid_nr(src);
+		goto out_unlock;
+	}
+
+	current->ipc.state = IPC_BLOCKED_RECV;
+	list_add_tail(&current->ipc.node, &ep->recvq);
+	set_current_state(TASK_INTERRUPTIBLE);
+	raw_spin_unlock_irq(&ep->lock);
+
+	if (caller)
+		schedule_direct(caller);
+	else
+		schedule();
+
+	ret = ipc_wait();
+	ipc_endpoint_put(ep);
+
+	return ret;
+
+out_unlock:
+	raw_spin_unlock_irq(&ep->lock);
+	if (caller)
+		wake_up_process(caller);
+	ipc_endpoint_put(ep);
+
+	return ret;
+}
+
+void show_ipc_stats(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct ipc_stats *st = per_cpu_ptr(&ipc_stats, cpu);
+
+		pr_info("CPU%d: calls %lu direct %lu queued %lu replies %lu\n",
+			cpu, st->calls, st->direct, st->queued, st->replies);
+	}
+}
@@ -0,0 +1,410 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Asynchronous notification objects and interrupt forwarding.
+ *
+ * Signalling never blocks and never queues anything: the sender ORs its
+ * bits into the pending word and only the signal that turns the word
+ * non-zero has to wake the waiter. The waiter takes the whole word with
+ * one xchg, so a burst of events arriving while it runs, or before it
+ * gets to run, is collected by a single notification_wait.
+ *
+ * Interrupts are forwarded to user-level drivers the same way: a bound
+ * line signals its bit from hardirq context and stays masked until the
+ * driver has serviced the device and calls irq_ack.
+ *
+ * Ids are global, so every object records who may use it: the creator
+ * of a notification waits on it and binds lines to it, and only tasks it
+ * shares the notification with may signal it besides itself.
+ */
+#define pr_fmt(fmt) "notification: " fmt
+
+#include <base/compiler.h>
+#include <base/common.h>
+#include <base/errno.h>
+#include <base/atomic.h>
+#include <base/bitops.h>
+
+#include <rtochius/ipc.h>
+#include <rtochius/syscalls.h>
+#include <rtochius/sched.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/swait.h>
+#include <rtochius/percpu.h>
+#include <rtochius/slab.h>
+#include <rtochius/idr.h>
+#include <rtochius/interrupt.h>
+#include <rtochius/irq.h>
+#include <rtochius/printf.h>
+
+#include <uapi/rtochius/notification.h>
+
+#include <asm/ptrace.h>
+
+struct notification {
+	atomic_t		pending;
+	struct swait_queue_head	wq;
+	pid_t			owner;
+	/* Tasks the owner lets signal, 0 for a free slot: */
+	pid_t			peers[NOTIFICATION_MAX_PEERS];
+};
+
+/* An interrupt line forwarded to a notification bit. */
+struct irq_notify {
+	struct notification	*ntfn;
+	unsigned int		irq;
+	u32			bit;
+	/* The task that bound the line, the only one that may ack it: */
+	pid_t			owner;
+	/* Set when the handler disabled the line, consumed by irq_ack: */
+	atomic_t		masked;
+};
+
+struct notification_stats {
+	unsigned long		signals;
+	/* Signals that found the word empty and had to wake the waiter: */
+	unsigned long		wakeups;
+	/* Waits that returned bits, and the bits they returned: */
+	unsigned long		collects;
+	unsigned long		bits;
+	unsigned long		irqs;
+};
+
+static DEFINE_PER_CPU(struct notification_stats, notification_stats);
+
+/*
+ * Notifications live as long as the system does, an interrupt handler
+ * may still signal one at any time.
+ */
+static DEFINE_IDR(notification_idr);
+static DEFINE_SPINLOCK(notification_lock);
+
+/* Bound interrupt lines, indexed by irq number: */
+static DEFINE_IDR(irq_notify_idr);
+static DEFINE_SPINLOCK(irq_notify_lock);
+
+static struct notification *notification_find(unsigned long id)
+{
+	struct notification *ntfn;
+
+	if (unlikely(id > INT_MAX))
+		return NULL;
+
+	spin_lock(&notification_lock);
+	ntfn = idr_find(&notification_idr, id);
+	spin_unlock(&notification_lock);
+
+	return ntfn;
+}
+
+static bool notification_may_signal(struct notification *ntfn, pid_t pid)
+{
+	int i;
+
+	if (pid == ntfn->owner)
+		return true;
+
+	for (i = 0; i < NOTIFICATION_MAX_PEERS; i++) {
+		if (READ_ONCE(ntfn->peers[i]) == pid)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Callable from any context, including hardirq.
+ */
+static void notification_signal(struct notification *ntfn, u32 bits)
+{
+	this_cpu_inc(notification_stats.signals);
+
+	/* Fully ordered, pairs with set_current_state() in the waiter. */
+	if (atomic_fetch_or(bits, &ntfn->pending))
+		return;
+
+	this_cpu_inc(notification_stats.wakeups);
+	swake_up_one(&ntfn->wq);
+}
+
+static inline u32 notification_collect(struct notification *ntfn)
+{
+	return atomic_xchg(&ntfn->pending, 0);
+}
+
+asmlinkage long sys_notification_create(struct pt_regs *regs)
+{
+	struct notification *ntfn;
+	int id;
+
+	ntfn = kzalloc(sizeof(*ntfn), GFP_KERNEL);
+	if (!ntfn)
+		return -ENOMEM;
+
+	atomic_set(&ntfn->pending, 0);
+	init_swait_queue_head(&ntfn->wq);
+	ntfn->owner = ipc_current_pid();
+
+	spin_lock(&notification_lock);
+	id = idr_alloc(&notification_idr, ntfn, 0, 0, GFP_KERNEL);
+	spin_unlock(&notification_lock);
+
+	if (id < 0)
+		kfree(ntfn);
+
+	return id;
+}
+
+/*
+ * sys_notification_share - let the task with pid x1 signal notification
+ * x0. Only its owner may share it.
+ */
+asmlinkage long sys_notification_share(struct pt_regs *regs)
+{
+	unsigned long pid = regs->regs[1];
+	struct notification *ntfn;
+	int i, free = -1;
+	long ret = 0;
+
+	ntfn = notification_find(regs->regs[0]);
+	if (!ntfn)
+		return -EINVAL;
+	if (ntfn->owner != ipc_current_pid())
+		return -EPERM;
+	if (!pid || pid > INT_MAX)
+		return -EINVAL;
+
+	spin_lock(&notification_lock);
+	for (i = 0; i < NOTIFICATION_MAX_PEERS; i++) {
+		if (ntfn->peers[i] == pid)
+			goto out_unlock;
+		if (!ntfn->peers[i] && free < 0)
+			free = i;
+	}
+	if (free < 0)
+		ret = -ENOSPC;
+	else
+		WRITE_ONCE(ntfn->peers[free], pid);
+out_unlock:
+	spin_unlock(&notification_lock);
+
+	return ret;
+}
+
+/*
+ * sys_notification_signal - OR the bits in x1 into notification x0.
+ */
+asmlinkage long sys_notification_signal(struct pt_regs *regs)
+{
+	unsigned long bits = regs->regs[1];
+	struct notification *ntfn;
+
+	ntfn = notification_find(regs->regs[0]);
+	if (!ntfn)
+		return -EINVAL;
+	if (!notification_may_signal(ntfn, ipc_current_pid()))
+		return -EPERM;
+	if (!bits || bits > U32_MAX)
+		return -EINVAL;
+
+	notification_signal(ntfn, bits);
+
+	return 0;
+}
+
+/*
+ * sys_notification_wait - collect the pending bits of notification x0.
+ *
+ * Only the owner may wait. Sleeps until at least one bit is pending
+ * unless x1 has NOTIFICATION_NONBLOCK. Returns the bits, all cleared in
+ * the object, or a negative error.
+ */
+asmlinkage long sys_notification_wait(struct pt_regs *regs)
+{
+	unsigned long flags = regs->regs[1];
+	struct notification *ntfn;
+	DECLARE_SWAITQUEUE(wait);
+	u32 bits;
+
+	ntfn = notification_find(regs->regs[0]);
+	if (!ntfn)
+		return -EINVAL;
+	if (ntfn->owner != ipc_current_pid())
+		return -EPERM;
+	if (flags & ~NOTIFICATION_NONBLOCK)
+		return -EINVAL;
+
+	bits = notification_collect(ntfn);
+	if (bits || (flags & NOTIFICATION_NONBLOCK))
+		goto out;
+
+	for (;;) {
+		prepare_to_swait_exclusive(&ntfn->wq, &wait, TASK_INTERRUPTIBLE);
+		bits = notification_collect(ntfn);
+		if (bits)
+			break;
+		schedule();
+	}
+	finish_swait(&ntfn->wq, &wait);
+
+out:
+	if (bits) {
+		this_cpu_inc(notification_stats.collects);
+		this_cpu_add(notification_stats.bits, hweight32(bits));
+	}
+
+	return bits;
+}
+
+static irqreturn_t irq_notify_handler(int irq, void *dev_id)
+{
+	struct irq_notify *in = dev_id;
+
+	/* Keep the line quiet until the driver has serviced the device. */
+	disable_irq_nosync(irq);
+	atomic_set(&in->masked, 1);
+
+	this_cpu_inc(notification_stats.irqs);
+	notification_signal(in->ntfn, BIT(in->bit));
+
+	return IRQ_HANDLED;
+}
+
+/*
+ * sys_irq_bind - forward interrupt x0 to bit x2 of notification x1.
+ *
+ * Only driver tasks (PF_DRIVER) may bind lines, and only to their own
+ * notifications. Every interrupt masks the line and signals the bit,
+ * irq_ack unmasks it again. A line can only be bound once, until
+ * irq_unbind, and never if the kernel handles it: -EBUSY.
+ */
+asmlinkage long sys_irq_bind(struct pt_regs *regs)
+{
+	unsigned long irq = regs->regs[0];
+	unsigned long bit = regs->regs[2];
+	struct notification *ntfn;
+	struct irq_notify *in;
+	int ret;
+
+	if (!(current->flags & PF_DRIVER))
+		return -EPERM;
+
+	ntfn = notification_find(regs->regs[1]);
+	if (!ntfn)
+		return -EINVAL;
+	if (ntfn->owner != ipc_current_pid())
+		return -EPERM;
+	if (irq >= INT_MAX || bit >= NOTIFICATION_BITS || !irq_to_desc(irq))
+		return -EINVAL;
+
+	/*
+	 * Lines with a kernel handler, per-cpu ones such as the timer
+	 * included, stay with the kernel. request_irq() would refuse a
+	 * second handler anyway, this just says so without a warning.
+	 */
+	if (irq_is_percpu_devid(irq) || irq_has_action(irq))
+		return -EBUSY;
+
+	in = kzalloc(sizeof(*in), GFP_KERNEL);
+	if (!in)
+		return -ENOMEM;
+
+	in->ntfn = ntfn;
+	in->irq = irq;
+	in->bit = bit;
+	in->owner = ipc_current_pid();
+	atomic_set(&in->masked, 0);
+
+	spin_lock(&irq_notify_lock);
+	ret = idr_alloc(&irq_notify_idr, in, irq, irq + 1, GFP_KERNEL);
+	spin_unlock(&irq_notify_lock);
+	if (ret < 0) {
+		kfree(in);
+		return ret == -ENOSPC ? -EBUSY : ret;
+	}
+
+	ret = request_irq(irq, irq_notify_handler, 0, "irq-notify", in);
+	if (ret) {
+		spin_lock(&irq_notify_lock);
+		idr_remove(&irq_notify_idr, irq);
+		spin_unlock(&irq_notify_lock);
+		kfree(in);
+		return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * sys_irq_ack - unmask bound interrupt x0 after its notification.
+ *
+ * Only the task that bound the line may ack it. An ack with no interrupt
+ * outstanding does nothing, so every disable in the handler is matched by
+ * exactly one enable.
+ */
+asmlinkage long sys_irq_ack(struct pt_regs *regs)
+{
+	unsigned long irq = regs->regs[0];
+	struct irq_notify *in;
+	long ret = 0;
+
+	if (irq >= INT_MAX)
+		return -EINVAL;
+
+	spin_lock(&irq_notify_lock);
+	in = idr_find(&irq_notify_idr, irq);
+	if (!in)
+		ret = -EINVAL;
+	else if (in->owner != ipc_current_pid())
+		ret = -EPERM;
+	else if (atomic_xchg(&in->masked, 0))
+		enable_irq(irq);
+	spin_unlock(&irq_notify_lock);
+
+	return ret;
+}
+
+/*
+ * sys_irq_unbind - stop forwarding interrupt x0 and release the line.
+ *
+ * Only the task that bound the line may unbind it.
+ */
+asmlinkage long sys_irq_unbind(struct pt_regs *regs)
+{
+	unsigned long irq = regs->regs[0];
+	struct irq_notify *in;
+
+	if (irq >= INT_MAX)
+		return -EINVAL;
+
+	spin_lock(&irq_notify_lock);
+	in = idr_find(&irq_notify_idr, irq);
+	if (in && in->owner != ipc_current_pid()) {
+		spin_unlock(&irq_notify_lock);
+		return -EPERM;
+	}
+	if (in)
+		idr_remove(&irq_notify_idr, irq);
+	spin_unlock(&irq_notify_lock);
+
+	if (!in)
+		return -EINVAL;
+
+	/* Waits for a running handler, the line is shut down afterwards. */
+	free_irq(irq, in);
+	kfree(in);
+
+	return 0;
+}
+
+void show_notification_stats(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct notification_stats *st = per_cpu_ptr(&notification_stats, cpu);
+
+		pr_info("CPU%d: signals %lu wakeups %lu irqs %lu collects %lu bits %lu\n",
+			cpu, st->signals, st->wakeups, st->irqs,
+			st->collects, st->bits);
+	}
+}
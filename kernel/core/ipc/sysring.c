@@ -0,0 +1,517 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Batched system call submission rings.
+ *
+ * The submission and completion queues are <base/ring.h> rings in
+ * kernel pages mapped into the owner, like channels. sysring_enter
+ * drains the SQ and runs every call through the regular system call
+ * table with a pt_regs built from the sqe, so a whole batch pays for one
+ * kernel_entry/kernel_exit.
+ *
+ * Rings set up with SYSRING_SQPOLL are also drained by idle CPUs: the
+ * idle loop polls them for a while before it goes to WFI, and only when
+ * the last poller stops does it ask user space, through
+ * SYSRING_SQ_NEED_WAKEUP, to call sysring_enter again.
+ */
+#define pr_fmt(fmt) "sysring: " fmt
+
+#include <base/compiler.h>
+#include <base/common.h>
+#include <base/errno.h>
+#include <base/atomic.h>
+#include <base/string.h>
+#include <base/log2.h>
+#include <base/ring.h>
+#include <base/math64.h>
+
+#include <rtochius/ipc.h>
+#include <rtochius/sysring.h>
+#include <rtochius/syscalls.h>
+#include <rtochius/nospec.h>
+#include <rtochius/sched.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/percpu.h>
+#include <rtochius/slab.h>
+#include <rtochius/idr.h>
+#include <rtochius/mm.h>
+#include <rtochius/printf.h>
+
+#include <asm/ptrace.h>
+#include <asm/syscall.h>
+#include <asm/unistd.h>
+#include <asm/arch_timer.h>
+
+/* SQ entries handled per ring and pass of an idle poller: */
+#define SYSRING_POLL_BATCH	32
+/* How long idle CPUs keep polling after the last submission, in ms: */
+#define SYSRING_IDLE_SPIN_MS	1
+
+struct sysring {
+	spinlock_t		lock;
+	unsigned int		flags;
+	struct mm_struct	*mm;
+	unsigned long		addr;
+	pid_t			owner;
+	struct page		*pages;
+	unsigned int		order;
+	struct sysring_params	*params;
+	struct ring_hdr		*sq;
+	struct ring_hdr		*cq;
+	/*
+	 * The ring headers are mapped writable in the owner, only their
+	 * indices are read from there. Everything that places a slot is
+	 * kept here:
+	 */
+	u32			sq_mask;
+	u32			cq_mask;
+	u32			sq_head;	/* next sqe to run */
+	u32			cq_tail;	/* next cqe to fill in */
+	/* On sysring_poll_list with SYSRING_SQPOLL: */
+	struct list_head	poll_node;
+};
+
+struct sysring_stats {
+	unsigned long		enters;
+	unsigned long		submitted;
+	/* Entries drained by idle CPUs: */
+	unsigned long		polled;
+};
+
+static DEFINE_PER_CPU(struct sysring_stats, sysring_stats);
+
+static DEFINE_IDR(sysring_idr);
+static DEFINE_SPINLOCK(sysring_lock);
+
+static LIST_HEAD(sysring_poll_list);
+static DEFINE_SPINLOCK(sysring_poll_lock);
+/*
+ * Idle CPUs currently polling, and the counter value at which each
+ * gives up. The counter rather than jiffies: the tick may be stopped.
+ */
+static atomic_t sysring_pollers;
+static DEFINE_PER_CPU(bool, sysring_polling);
+static DEFINE_PER_CPU(u64, sysring_poll_end);
+
+/*
+ * The calls that may be batched: none of them sleeps or looks at the
+ * caller's saved registers, so they run from the idle loop just as well.
+ * A batch runs under r->lock, which also rules out channel_create: its
+ * ring allocation may compact.
+ */
+static const bool sysring_op_ok[__NR_syscalls] = {
+	[__NR_ipc_endpoint_create]	= true,
+	[__NR_ipc_endpoint_destroy]	= true,
+	[__NR_channel_map]		= true,
+	[__NR_channel_notify]		= true,
+	[__NR_notification_create]	= true,
+	[__NR_notification_signal]	= true,
+	[__NR_irq_ack]			= true,
+	[__NR_grant_create]		= true,
+	[__NR_grant_map]		= true,
+	[__NR_grant_unmap]		= true,
+	[__NR_grant_revoke]		= true,
+};
+
+static long sysring_do_call(const struct sysring_sqe *sqe)
+{
+	unsigned int nr = sqe->opcode;
+	struct pt_regs regs;
+	int i;
+
+	if (nr >= __NR_syscalls || sqe->flags)
+		return -EINVAL;
+	nr = array_index_nospec(nr, __NR_syscalls);
+	if (!sysring_op_ok[nr])
+		return -EINVAL;
+
+	memset(&regs, 0, sizeof(regs));
+	for (i = 0; i < ARRAY_SIZE(sqe->args); i++)
+		regs.regs[i] = sqe->args[i];
+	regs.regs[8] = nr;
+	regs.orig_x0 = regs.regs[0];
+	regs.syscallno = nr;
+
+	return sys_call_table[nr](&regs);
+}
+
+static inline struct sysring_sqe *sysring_sqe(struct sysring *r, u32 idx)
+{
+	return (struct sysring_sqe *)(r->sq + 1) + (idx & r->sq_mask);
+}
+
+static inline struct sysring_cqe *sysring_cqe(struct sysring *r, u32 idx)
+{
+	return (struct sysring_cqe *)(r->cq + 1) + (idx & r->cq_mask);
+}
+
+static inline bool sysring_sq_pending(struct sysring *r)
+{
+	return (u32)atomic_read(&r->sq->prod_tail) != r->sq_head;
+}
+
+/*
+ * Run up to @max queued calls, fewer if the CQ fills up. Called with
+ * r->lock held, which makes the kernel the single SQ consumer and CQ
+ * producer. current->mm must be the ring owner's.
+ *
+ * The owner's SQ tail and CQ head are the only input taken from the
+ * shared headers. If they are further from the kernel's own indices than
+ * the rings are long, the headers were scribbled over and nothing runs.
+ */
+static unsigned int sysring_submit(struct sysring *r, unsigned int max)
+{
+	struct sysring_sqe sqe;
+	struct sysring_cqe *cqe;
+	unsigned int done = 0;
+	u32 sq_tail, cq_head;
+
+	/* Pairs with the release of prod_tail in ring_produce_commit(). */
+	sq_tail = atomic_read_acquire(&r->sq->prod_tail);
+	/* Pairs with the release of cons_tail in ring_consume_release(). */
+	cq_head = atomic_read_acquire(&r->cq->cons_tail);
+
+	if (sq_tail - r->sq_head > r->sq_mask + 1 ||
+	    r->cq_tail - cq_head > r->cq_mask + 1)
+		return 0;
+
+	while (done < max && r->sq_head != sq_tail &&
+	       r->cq_tail - cq_head <= r->cq_mask) {
+		/* The owner can rewrite the slot under us, work on a copy. */
+		memcpy(&sqe, sysring_sqe(r, r->sq_head), sizeof(sqe));
+		atomic_set_release(&r->sq->cons_tail, ++r->sq_head);
+
+		cqe = sysring_cqe(r, r->cq_tail);
+		cqe->user_data = sqe.user_data;
+		cqe->res = sysring_do_call(&sqe);
+		r->cq_tail++;
+		atomic_set(&r->cq->prod_head, r->cq_tail);
+		atomic_set_release(&r->cq->prod_tail, r->cq_tail);
+		done++;
+	}
+
+	return done;
+}
+
+/*
+ * Rings go away with their address space, so one of current->mm stays
+ * valid without a reference.
+ */
+static struct sysring *sysring_find(unsigned long id)
+{
+	struct sysring *r;
+
+	if (unlikely(id > INT_MAX))
+		return NULL;
+
+	spin_lock(&sysring_lock);
+	r = idr_find(&sysring_idr, id);
+	if (r && r->mm != current->mm)
+		r = NULL;
+	spin_unlock(&sysring_lock);
+
+	return r;
+}
+
+/*
+ * sys_sysring_setup - create a ring pair with x0 SQ and x1 CQ entries
+ * and map it at the page aligned user address x3.
+ *
+ * x2 holds SYSRING_* flags. Returns the ring id or a negative error.
+ */
+asmlinkage long sys_sysring_setup(struct pt_regs *regs)
+{
+	unsigned long sq_entries = regs->regs[0];
+	unsigned long cq_entries = regs->regs[1];
+	unsigned long flags = regs->regs[2];
+	unsigned long addr = regs->regs[3];
+	struct mm_struct *mm = current->mm;
+	unsigned long sq_off, cq_off, size;
+	struct sysring *r;
+	int id, err;
+
+	if (!mm)
+		return -EINVAL;
+	if (sq_entries < 2 || sq_entries > SYSRING_MAX_ENTRIES ||
+	    !is_power_of_2(sq_entries))
+		return -EINVAL;
+	if (cq_entries < sq_entries || cq_entries > 2 * SYSRING_MAX_ENTRIES ||
+	    !is_power_of_2(cq_entries))
+		return -EINVAL;
+	if ((flags & ~SYSRING_SQPOLL) || !PAGE_ALIGNED(addr))
+		return -EINVAL;
+
+	sq_off = ALIGN(sizeof(struct sysring_params), SMP_CACHE_BYTES);
+	cq_off = sq_off + RING_BYTES(sq_entries, sizeof(struct sysring_sqe));
+	size = cq_off + RING_BYTES(cq_entries, sizeof(struct sysring_cqe));
+
+	r = kzalloc(sizeof(*r), GFP_KERNEL);
+	if (!r)
+		return -ENOMEM;
+
+	spin_lock_init(&r->lock);
+	INIT_LIST_HEAD(&r->poll_node);
+	r->flags = flags;
+	r->mm = mm;
+	r->addr = addr;
+	r->owner = ipc_current_pid();
+	r->order = get_order(size);
+	r->pages = alloc_pages(GFP_KERNEL | GFP_ZERO | __GFP_COMPACT,
+			       r->order);
+	if (!r->pages) {
+		kfree(r);
+		return -ENOMEM;
+	}
+
+	r->params = page_address(r->pages);
+	r->params->sq_off = sq_off;
+	r->params->cq_off = cq_off;
+	r->sq = (void *)r->params + sq_off;
+	r->cq = (void *)r->params + cq_off;
+	ring_init(r->sq, sq_entries, sizeof(struct sysring_sqe), 0);
+	ring_init(r->cq, cq_entries, sizeof(struct sysring_cqe), 0);
+	r->sq_mask = sq_entries - 1;
+	r->cq_mask = cq_entries - 1;
+
+	err = map_user_pages(mm, addr, r->pages, 1UL << r->order, PAGE_SHARED);
+	if (err)
+		goto out_free;
+
+	spin_lock(&sysring_lock);
+	id = idr_alloc(&sysring_idr, r, 0, 0, GFP_KERNEL);
+	spin_unlock(&sysring_lock);
+	if (id < 0) {
+		unmap_user_pages(mm, addr, 1UL << r->order);
+		err = id;
+		goto out_free;
+	}
+
+	if (flags & SYSRING_SQPOLL) {
+		/*
+		 * Pollers come and go under the lock, so the flag is right
+		 * for the ring until the next one does, which updates it.
+		 */
+		spin_lock(&sysring_poll_lock);
+		if (!atomic_read(&sysring_pollers))
+			WRITE_ONCE(r->params->flags, SYSRING_SQ_NEED_WAKEUP);
+		list_add_tail(&r->poll_node, &sysring_poll_list);
+		spin_unlock(&sysring_poll_lock);
+	}
+
+	return id;
+
+out_free:
+	__free_pages(r->pages, r->order);
+	kfree(r);
+
+	return err;
+}
+
+/*
+ * sys_sysring_enter - run everything queued on the SQ of ring x0.
+ *
+ * Only the task that set the ring up may enter it, the calls run with its
+ * identity. Returns the number of calls submitted, their results are on
+ * the CQ.
+ */
+asmlinkage long sys_sysring_enter(struct pt_regs *regs)
+{
+	struct sysring *r;
+	unsigned int done;
+
+	r = sysring_find(regs->regs[0]);
+	if (!r)
+		return -EINVAL;
+	if (r->owner != ipc_current_pid())
+		return -EPERM;
+
+	spin_lock(&r->lock);
+	done = sysring_submit(r, UINT_MAX);
+	spin_unlock(&r->lock);
+
+	this_cpu_inc(sysring_stats.enters);
+	this_cpu_add(sysring_stats.submitted, done);
+
+	return done;
+}
+
+/**
+ * sysring_release_mm - free the rings set up in an address space
+ * @mm: the address space being torn down
+ *
+ * Called from exit_mmap(). Idle pollers walk sysring_poll_list under
+ * sysring_poll_lock, so once a ring is off the list under it, none of
+ * them can be running its calls any more.
+ */
+void sysring_release_mm(struct mm_struct *mm)
+{
+	struct sysring *r, *next;
+	LIST_HEAD(dead);
+	int id;
+
+	spin_lock(&sysring_lock);
+	idr_for_each_entry(&sysring_idr, r, id) {
+		if (r->mm != mm)
+			continue;
+		idr_remove(&sysring_idr, id);
+		/* Not polled, poll_node is free to collect it. */
+		if (!(r->flags & SYSRING_SQPOLL))
+			list_add(&r->poll_node, &dead);
+	}
+	spin_unlock(&sysring_lock);
+
+	spin_lock(&sysring_poll_lock);
+	list_for_each_entry_safe(r, next, &sysring_poll_list, poll_node) {
+		if (r->mm == mm)
+			list_move(&r->poll_node, &dead);
+	}
+	spin_unlock(&sysring_poll_lock);
+
+	list_for_each_entry_safe(r, next, &dead, poll_node) {
+		unmap_user_pages(mm, r->addr, 1UL << r->order);
+		__free_pages(r->pages, r->order);
+		kfree(r);
+	}
+}
+
+static void sysring_set_need_wakeup(bool wakeup)
+{
+	struct sysring *r;
+
+	list_for_each_entry(r, &sysring_poll_list, poll_node)
+		WRITE_ONCE(r->params->flags,
+			   wakeup ? SYSRING_SQ_NEED_WAKEUP : 0);
+}
+
+static bool sysring_poll_pending(void)
+{
+	struct sysring *r;
+
+	list_for_each_entry(r, &sysring_poll_list, poll_node) {
+		if (sysring_sq_pending(r))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * One pass over the SQPOLL rings. The idle task borrows each owner's mm
+ * and pid while it runs that owner's calls.
+ */
+static unsigned int sysring_poll_rings(void)
+{
+	struct mm_struct *mm = current->mm;
+	unsigned int done = 0;
+	struct sysring *r;
+
+	list_for_each_entry(r, &sysring_poll_list, poll_node) {
+		if (!sysring_sq_pending(r) || !spin_trylock(&r->lock))
+			continue;
+
+		current->mm = r->mm;
+		current->ipc.sqpoll_pid = r->owner;
+		done += sysring_submit(r, SYSRING_POLL_BATCH);
+		current->ipc.sqpoll_pid = 0;
+		current->mm = mm;
+
+		spin_unlock(&r->lock);
+	}
+
+	return done;
+}
+
+static void sysring_poll_extend(void)
+{
+	u64 spin = div_u64((u64)arch_timer_get_cntfrq() * SYSRING_IDLE_SPIN_MS,
+			   1000);
+
+	__this_cpu_write(sysring_poll_end, arch_counter_get_cntvct() + spin);
+}
+
+/**
+ * sysring_idle_poll - drain SQPOLL rings from the idle loop
+ *
+ * Called by the idle task with interrupts enabled. Returns true while
+ * the CPU should keep polling instead of entering WFI.
+ */
+bool sysring_idle_poll(void)
+{
+	bool *polling = this_cpu_ptr(&sysring_polling);
+	unsigned int done;
+
+	if (list_empty(&sysring_poll_list))
+		return false;
+
+	spin_lock(&sysring_poll_lock);
+
+	if (!*polling) {
+		*polling = true;
+		sysring_poll_extend();
+		if (atomic_inc_return(&sysring_pollers) == 1)
+			sysring_set_need_wakeup(false);
+	}
+
+	done = sysring_poll_rings();
+	if (done) {
+		sysring_poll_extend();
+		this_cpu_add(sysring_stats.polled, done);
+		goto keep_polling;
+	}
+
+	if ((s64)(arch_counter_get_cntvct() -
+		  __this_cpu_read(sysring_poll_end)) < 0)
+		goto keep_polling;
+
+	*polling = false;
+	if (atomic_dec_and_test(&sysring_pollers)) {
+		sysring_set_need_wakeup(true);
+		/*
+		 * Pairs with the barrier between queueing an sqe and reading
+		 * the flag in user space: either the submitter sees the flag
+		 * or we see its entry.
+		 */
+		smp_mb();
+		if (sysring_poll_pending()) {
+			spin_unlock(&sysring_poll_lock);
+			return true;
+		}
+	}
+
+	spin_unlock(&sysring_poll_lock);
+	return false;
+
+keep_polling:
+	spin_unlock(&sysring_poll_lock);
+	cpu_relax();
+	return true;
+}
+
+/*
+ * The idle loop is about to schedule, stop counting this CPU as a
+ * poller.
+ */
+void sysring_idle_exit(void)
+{
+	bool *polling = this_cpu_ptr(&sysring_polling);
+
+	if (!*polling)
+		return;
+
+	spin_lock(&sysring_poll_lock);
+	*polling = false;
+	if (atomic_dec_and_test(&sysring_pollers))
+		sysring_set_need_wakeup(true);
+	spin_unlock(&sysring_poll_lock);
+}
+
+void show_sysring_stats(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct sysring_stats *st = per_cpu_ptr(&sysring_stats, cpu);
+
+		pr_info("CPU%d: enters %lu submitted %lu polled %lu\n",
+			cpu, st->enters, st->submitted, st->polled);
+	}
+}
@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Idle-time work stealing between the per-CPU runqueues.
+ *
+ * A CPU that is about to go idle looks for the busiest online neighbour
+ * and pulls up to half of the imbalance over to itself. CPUs which get
+ * a second runnable task kick one idle CPU with IPI_RESCHEDULE so that
+ * it comes out of WFI and runs the steal.
+ */
+#define pr_fmt(fmt) "sched: " fmt
+
+#include <base/compiler.h>
+#include <base/bitops.h>
+
+#include <rtochius/sched.h>
+#include <rtochius/smp.h>
+#include <rtochius/cpumask.h>
+#include <rtochius/printf.h>
+
+#include "sched.h"
+
+/*
+ * Lock the busiest runqueue while already holding this_rq->lock.
+ * Runqueue locks nest by ascending address, so this_rq->lock may be
+ * dropped and retaken on the way; returns 1 if it was.
+ */
+static int double_lock_balance(struct rq *this_rq, struct rq *busiest)
+{
+	int ret = 0;
+
+	if (unlikely(!raw_spin_trylock(&busiest->lock))) {
+		if (busiest < this_rq) {
+			raw_spin_unlock(&this_rq->lock);
+			raw_spin_lock(&busiest->lock);
+			raw_spin_lock(&this_rq->lock);
+			ret = 1;
+		} else
+			raw_spin_lock(&busiest->lock);
+	}
+
+	return ret;
+}
+
+static inline void double_unlock_balance(struct rq *this_rq, struct rq *busiest)
+{
+	raw_spin_unlock(&busiest->lock);
+}
+
+/*
+ * can_migrate_task - may task p from runqueue rq be migrated to this_cpu?
+ */
+static inline int can_migrate_task(struct task_struct *p, struct rq *rq,
+				   int this_cpu)
+{
+	/*
+	 * We do not migrate tasks that are:
+	 * 1) running (obviously), or
+	 * 2) cannot be migrated to this CPU due to cpus_allowed.
+	 */
+	if (task_running(rq, p))
+		return 0;
+	if (!cpumask_test_cpu(this_cpu, &p->cpus_allowed))
+		return 0;
+
+	return 1;
+}
+
+/*
+ * pull_task - move a task from a remote runqueue to the local runqueue.
+ * Both runqueues must be locked.
+ */
+static void pull_task(struct rq *src_rq, struct task_struct *p,
+		      struct rq *this_rq)
+{
+	deactivate_task(src_rq, p);
+	set_task_cpu(p, cpu_of(this_rq));
+	activate_task(this_rq, p);
+
+	src_rq->nr_migrations_out++;
+	this_rq->nr_migrations_in++;
+}
+
+/*
+ * Steal up to @max_pull tasks from @busiest. The expired array is
+ * tried first, its tasks have run least recently and are the most
+ * likely to be cache-cold; within an array we go from the highest
+ * priority queue down and take from the tail of each queue.
+ */
+static int move_tasks(struct rq *this_rq, struct rq *busiest, int max_pull)
+{
+	struct prio_array *array, *arrays[2];
+	struct task_struct *p, *tmp;
+	int this_cpu = cpu_of(this_rq);
+	int i, idx, pulled = 0;
+
+	arrays[0] = busiest->expired;
+	arrays[1] = busiest->active;
+
+	for (i = 0; i < 2 && pulled < max_pull; i++) {
+		array = arrays[i];
+		if (!array->nr_active)
+			continue;
+
+		for_each_set_bit(idx, array->bitmap, MAX_PRIO) {
+			list_for_each_entry_safe_reverse(p, tmp,
+					array->queue + idx, run_list) {
+				if (!can_migrate_task(p, busiest, this_cpu))
+					continue;
+
+				pull_task(busiest, p, this_rq);
+				if (++pulled >= max_pull)
+					return pulled;
+			}
+		}
+	}
+
+	return pulled;
+}
+
+/*
+ * find_busiest_queue - the online CPU with the most runnable tasks.
+ * nr_running is sampled locklessly, the caller re-checks it under the
+ * runqueue locks. A runqueue with a single task has nothing to give.
+ */
+static struct rq *find_busiest_queue(struct rq *this_rq)
+{
+	struct rq *busiest = NULL;
+	unsigned int max_load = 1;
+	int this_cpu = cpu_of(this_rq);
+	int cpu;
+
+	for_each_cpu_wrap(cpu, cpu_online_mask, this_cpu + 1) {
+		unsigned int load;
+
+		if (cpu == this_cpu)
+			continue;
+
+		load = READ_ONCE(cpu_rq(cpu)->nr_running);
+		if (load > max_load) {
+			max_load = load;
+			busiest = cpu_rq(cpu);
+		}
+	}
+
+	return busiest;
+}
+
+/*
+ * idle_balance is called by schedule() if this_cpu is about to become
+ * idle. Attempts to pull tasks from other CPUs.
+ *
+ * Called with this_rq->lock held and interrupts disabled.
+ */
+void idle_balance(struct rq *this_rq)
+{
+	struct rq *busiest;
+	int imbalance;
+
+	if (unlikely(!this_rq->online))
+		return;
+
+	this_rq->nr_steal_attempts++;
+
+	busiest = find_busiest_queue(this_rq);
+	if (!busiest)
+		return;
+
+	double_lock_balance(this_rq, busiest);
+
+	/*
+	 * Both queues may have changed while we were unlocked: someone
+	 * else could have stolen from busiest, or woken a task here.
+	 * Leave the remote CPU its currently running task.
+	 */
+	imbalance = ((int)busiest->nr_running - (int)this_rq->nr_running) / 2;
+	if (imbalance > 0 && !this_rq->nr_running) {
+		if (move_tasks(this_rq, busiest, imbalance))
+			this_rq->nr_steals++;
+	}
+
+	double_unlock_balance(this_rq, busiest);
+}
+
+/*
+ * Called with busy_rq->lock held after a task was queued on it. If that
+ * made it overloaded, send one idle CPU an IPI_RESCHEDULE so that it
+ * leaves WFI and steals the surplus through idle_balance().
+ */
+void kick_idle_balance(struct rq *busy_rq)
+{
+	int busy_cpu = cpu_of(busy_rq);
+	int cpu;
+
+	if (busy_rq->nr_running < 2)
+		return;
+
+	for_each_cpu_wrap(cpu, cpu_online_mask, busy_cpu + 1) {
+		struct task_struct *idle;
+
+		if (cpu == busy_cpu || !idle_cpu(cpu))
+			continue;
+
+		idle = cpu_rq(cpu)->idle;
+		/* Already kicked, its steal is on the way. */
+		if (test_tsk_need_resched(idle))
+			return;
+
+		set_tsk_need_resched(idle);
+		busy_rq->nr_kicks++;
+
+		if (cpu == smp_processor_id()) {
+			set_preempt_need_resched();
+			return;
+		}
+
+		/* Make the flag visible before the IPI lands. */
+		smp_mb();
+		smp_send_reschedule(cpu);
+		return;
+	}
+}
+
+/*
+ * need_idle_balance - does some other online CPU have a task to spare?
+ */
+bool need_idle_balance(struct rq *this_rq)
+{
+	int this_cpu = cpu_of(this_rq);
+	int cpu;
+
+	if (unlikely(!this_rq->online))
+		return false;
+
+	for_each_online_cpu(cpu) {
+		if (cpu != this_cpu && READ_ONCE(cpu_rq(cpu)->nr_running) > 1)
+			return true;
+	}
+
+	return false;
+}
+
+void show_sched_balance_stats(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+
+		pr_info("CPU%d: running %u switches %llu steal %lu/%lu migrations in %lu out %lu kicks %lu\n",
+			cpu, READ_ONCE(rq->nr_running), rq->nr_switches,
+			rq->nr_steals, rq->nr_steal_attempts,
+			rq->nr_migrations_in, rq->nr_migrations_out,
+			rq->nr_kicks);
+	}
+}
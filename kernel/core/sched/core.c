@@ -4,27 +4,443 @@
  *  Core kernel scheduler code and related syscalls
  *
  *  Copyright (C) 1991-2002  Linus Torvalds
+ *
+ *  2002-01-04	New ultra-scalable O(1) scheduler by Ingo Molnar:
+ *		hybrid priority-list and round-robin design with
+ *		an array-switch method of distributing timeslices
+ *		and per-CPU runqueues.
  */
 #include <base/compiler.h>
+#include <base/bitops.h>
+#include <base/init.h>
 
 #include <rtochius/sched/init.h>
 #include <rtochius/sched.h>
 #include <rtochius/sched/task.h>
+#include <rtochius/sched/task_stack.h>
+#include <rtochius/mm_types.h>
+#include <rtochius/smp.h>
+#include <rtochius/cpumask.h>
+#include <rtochius/tick.h>
+#include <rtochius/syscalls.h>
+
+#include <asm-generic/switch_to.h>
+
+#include <asm/mmu_context.h>
+
+#include "sched.h"
+
+DEFINE_PER_CPU_SHARED_ALIGNED(struct rq, runqueues);
 
 /*
- * this is the entry point to schedule() from kernel preemption
- * off of irq context.
- * Note, that this is called and return with irqs disabled. This will
- * protect us against recursive calling from irq.
+ * Scale a timeslice with the static priority: nice -20 gets 800ms,
+ * nice 0 gets 100ms and nice 19 gets 5ms (at HZ >= 200).
  */
-asmlinkage __visible void __sched preempt_schedule_irq(void)
+#define SCALE_PRIO(x, prio) \
+	max(x * (MAX_PRIO - prio) / (MAX_USER_PRIO / 2), MIN_TIMESLICE)
+
+static unsigned int task_timeslice(struct task_struct *p)
+{
+	if (p->static_prio < NICE_TO_PRIO(0))
+		return SCALE_PRIO(DEF_TIMESLICE * 4, p->static_prio);
+	else
+		return SCALE_PRIO(DEF_TIMESLICE, p->static_prio);
+}
+
+/*
+ * __task_rq_lock - lock the rq @p resides on.
+ */
+struct rq *__task_rq_lock(struct task_struct *p)
+{
+	struct rq *rq;
+
+	for (;;) {
+		rq = task_rq(p);
+		raw_spin_lock(&rq->lock);
+		if (likely(rq == task_rq(p)))
+			return rq;
+		/* @p moved meanwhile, retry on the rq it is on now. */
+		raw_spin_unlock(&rq->lock);
+	}
+}
+
+/*
+ * task_rq_lock - lock p->pi_lock and lock the rq @p resides on.
+ */
+struct rq *task_rq_lock(struct task_struct *p, unsigned long *flags)
+{
+	struct rq *rq;
+
+	for (;;) {
+		raw_spin_lock_irqsave(&p->pi_lock, *flags);
+		rq = task_rq(p);
+		raw_spin_lock(&rq->lock);
+		/*
+		 * set_task_cpu() is called with either p->pi_lock or the
+		 * old rq->lock held, so with both taken and the same rq
+		 * seen again @p is pinned to it.
+		 */
+		if (likely(rq == task_rq(p)))
+			return rq;
+		raw_spin_unlock(&rq->lock);
+		raw_spin_unlock_irqrestore(&p->pi_lock, *flags);
+	}
+}
+
+/*
+ * Adding/removing a task to/from a priority array:
+ */
+void dequeue_task(struct task_struct *p, struct prio_array *array)
+{
+	array->nr_active--;
+	list_del(&p->run_list);
+	if (list_empty(array->queue + p->prio))
+		__clear_bit(p->prio, array->bitmap);
+}
+
+void enqueue_task(struct task_struct *p, struct prio_array *array)
+{
+	list_add_tail(&p->run_list, array->queue + p->prio);
+	__set_bit(p->prio, array->bitmap);
+	array->nr_active++;
+	p->array = array;
+}
+
+/*
+ * Put task to the end of the run list without the overhead of dequeue
+ * followed by enqueue.
+ */
+static void requeue_task(struct task_struct *p, struct prio_array *array)
+{
+	list_move_tail(&p->run_list, array->queue + p->prio);
+}
+
+void activate_task(struct rq *rq, struct task_struct *p)
+{
+	enqueue_task(p, rq->active);
+	WRITE_ONCE(rq->nr_running, rq->nr_running + 1);
+	p->on_rq = 1;
+
+	/* A second task needs the tick for time slicing. */
+	if (rq->nr_running == 2)
+		tick_nohz_full_kick_cpu(cpu_of(rq));
+}
+
+void deactivate_task(struct rq *rq, struct task_struct *p)
+{
+	WRITE_ONCE(rq->nr_running, rq->nr_running - 1);
+	dequeue_task(p, p->array);
+	p->array = NULL;
+	p->on_rq = 0;
+}
+
+/*
+ * resched_curr - mark rq's current task 'to be rescheduled now'.
+ *
+ * On UP this means the setting of the need_resched flag, on SMP it
+ * might also involve a cross-CPU call to trigger the scheduler on
+ * the target CPU.
+ */
+void resched_curr(struct rq *rq)
+{
+	struct task_struct *curr = rq->curr;
+	int cpu;
+
+	if (test_tsk_need_resched(curr))
+		return;
+
+	cpu = cpu_of(rq);
+
+	set_tsk_need_resched(curr);
+	if (cpu == smp_processor_id()) {
+		set_preempt_need_resched();
+		return;
+	}
+
+	/* Make the flag visible before the IPI lands. */
+	smp_mb();
+	smp_send_reschedule(cpu);
+}
+
+void check_preempt_curr(struct rq *rq, struct task_struct *p)
+{
+	if (p->prio < rq->curr->prio)
+		resched_curr(rq);
+}
+
+void set_task_cpu(struct task_struct *p, unsigned int new_cpu)
+{
+	/*
+	 * We should never call set_task_cpu() on a blocked task,
+	 * ttwu() will sort out the placement.
+	 */
+	WARN_ON_ONCE(p->state != TASK_RUNNING && p->state != TASK_WAKING &&
+			!p->on_rq && p->state != TASK_NEW);
+
+	/*
+	 * Make sure all prior stores to the task are visible before
+	 * another CPU can observe it on its runqueue.
+	 */
+	smp_wmb();
+	WRITE_ONCE(p->cpu, new_cpu);
+}
+
+/*
+ * Pick a runqueue for a waking or new task: stay where the task last
+ * ran if that is still allowed, otherwise fall back to any allowed
+ * online CPU.
+ */
+static int select_task_rq(struct task_struct *p)
+{
+	int cpu = task_cpu(p);
+
+	if (likely(cpumask_test_cpu(cpu, &p->cpus_allowed) && cpu_online(cpu)))
+		return cpu;
+
+	cpu = cpumask_any_and(&p->cpus_allowed, cpu_online_mask);
+	if (unlikely(cpu >= nr_cpu_ids))
+		cpu = smp_processor_id();
+
+	return cpu;
+}
+
+/**
+ * try_to_wake_up - wake up a thread
+ * @p: the thread to be awakened
+ * @state: the mask of task states that can be woken
+ * @wake_flags: wake modifier flags (WF_*)
+ *
+ * Put @p on the run-queue if it's not already there. The caller must
+ * ensure that the task *will* perform a schedule() or has already done
+ * so, otherwise the wakeup could be lost.
+ *
+ * Return: %true if @p->state changes (an actual wakeup was done),
+ *	   %false otherwise.
+ */
+static int try_to_wake_up(struct task_struct *p, unsigned int state,
+			  int wake_flags)
+{
+	unsigned long flags;
+	struct rq *rq;
+	int cpu, success = 0;
+
+	raw_spin_lock_irqsave(&p->pi_lock, flags);
+	smp_mb__after_spinlock();
+	if (!(p->state & state))
+		goto out;
+
+	success = 1;
+
+	/*
+	 * Still queued: it went to sleep but has not been switched out
+	 * yet, so flipping the state back is all that is needed.
+	 */
+	if (READ_ONCE(p->on_rq)) {
+		rq = __task_rq_lock(p);
+		if (p->on_rq) {
+			p->state = TASK_RUNNING;
+			__task_rq_unlock(rq);
+			goto out;
+		}
+		__task_rq_unlock(rq);
+	}
+
+	/*
+	 * Wait for the previous CPU to finish switching out of @p before
+	 * we touch its stack by enqueueing it somewhere else.
+	 */
+	smp_cond_load_acquire(&p->on_cpu, !VAL);
+
+	p->state = TASK_WAKING;
+
+	cpu = select_task_rq(p);
+	if (task_cpu(p) != cpu)
+		set_task_cpu(p, cpu);
+
+	rq = cpu_rq(cpu);
+	raw_spin_lock(&rq->lock);
+	activate_task(rq, p);
+	p->state = TASK_RUNNING;
+	check_preempt_curr(rq, p);
+	kick_idle_balance(rq);
+	raw_spin_unlock(&rq->lock);
+out:
+	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+
+	return success;
+}
+
+/**
+ * wake_up_process - Wake up a specific process
+ * @p: The process to be woken up.
+ *
+ * Attempt to wake up the nominated process and move it to the set of runnable
+ * processes.
+ *
+ * Return: 1 if the process was woken up, 0 if it was already running.
+ */
+int wake_up_process(struct task_struct *p)
+{
+	return try_to_wake_up(p, TASK_NORMAL, 0);
+}
+
+int wake_up_state(struct task_struct *p, unsigned int state)
 {
-	panic("preempt_schedule_irq\n");
+	return try_to_wake_up(p, state, 0);
 }
 
-void sched_init(void)
+/*
+ * fork()/clone()-time setup:
+ */
+int sched_fork(unsigned long clone_flags, struct task_struct *p)
 {
+	unsigned long flags;
+
+	/*
+	 * We mark the process as NEW here. This guarantees that
+	 * nobody will actually run it, and a signal or other external
+	 * event cannot wake it up and insert it on the runqueue either.
+	 */
+	p->state = TASK_NEW;
+	p->on_cpu = 0;
+	p->on_rq = 0;
+	p->array = NULL;
+	INIT_LIST_HEAD(&p->run_list);
+	ipc_task_init(&p->ipc);
+
+	/*
+	 * The idle tasks sit below every priority and have no timeslice,
+	 * their children (kernel_init, the idle tasks of the other CPUs)
+	 * start out as regular nice 0 tasks with a full one.
+	 */
+	if (unlikely(current->flags & PF_IDLE)) {
+		p->static_prio = NICE_TO_PRIO(0);
+		p->prio = p->static_prio;
+		p->time_slice = task_timeslice(p);
+		goto out;
+	}
 
+	/*
+	 * Make sure we do not leak PI boosting priority to the child.
+	 */
+	p->prio = current->static_prio;
+
+	/*
+	 * Share the timeslice between parent and child, thus the
+	 * total amount of pending timeslices in the system doesn't change,
+	 * resulting in more scheduling fairness.
+	 */
+	local_irq_save(flags);
+	p->time_slice = (current->time_slice + 1) >> 1;
+	current->time_slice >>= 1;
+	if (unlikely(!current->time_slice)) {
+		/*
+		 * This case is rare, it happens when the parent has only
+		 * a single jiffy left from its timeslice. Taking the
+		 * runqueue lock is not a problem.
+		 */
+		current->time_slice = 1;
+		set_tsk_need_resched(current);
+	}
+	local_irq_restore(flags);
+
+out:
+	init_task_preempt_count(p);
+
+	raw_spin_lock_irqsave(&p->pi_lock, flags);
+	set_task_cpu(p, smp_processor_id());
+	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+
+	return 0;
+}
+
+/*
+ * wake_up_new_task - wake up a newly created task for the first time.
+ *
+ * This function will do some initial scheduler statistics housekeeping
+ * that must be done for every newly created context, then puts the task
+ * on the runqueue and wakes it.
+ */
+void wake_up_new_task(struct task_struct *p)
+{
+	unsigned long flags;
+	struct rq *rq;
+
+	raw_spin_lock_irqsave(&p->pi_lock, flags);
+	p->state = TASK_RUNNING;
+	set_task_cpu(p, select_task_rq(p));
+	rq = task_rq(p);
+	raw_spin_lock(&rq->lock);
+	activate_task(rq, p);
+	check_preempt_curr(rq, p);
+	kick_idle_balance(rq);
+	task_rq_unlock(rq, p, &flags);
+}
+
+/**
+ * prepare_task_switch - prepare to switch tasks
+ * @rq: the runqueue preparing to switch
+ * @next: the task we are going to switch to.
+ *
+ * This is called with the rq lock held and interrupts off. It must
+ * be paired with a subsequent finish_task_switch after the context
+ * switch.
+ */
+static inline void prepare_task_switch(struct rq *rq, struct task_struct *next)
+{
+	/*
+	 * Claim the task as running, we do this before switching to it
+	 * such that any running task will have this set.
+	 */
+	WRITE_ONCE(next->on_cpu, 1);
+}
+
+/**
+ * finish_task_switch - clean up after a task-switch
+ * @prev: the thread we just switched away from.
+ *
+ * finish_task_switch must be called after the context switch, paired
+ * with a prepare_task_switch call before the context switch.
+ * finish_task_switch will reconcile locking set up by prepare_task_switch,
+ * and do any other architecture-specific cleanup actions.
+ *
+ * The context switch have flipped the stack from under us and restored the
+ * local variables which were saved when this task called schedule() in the
+ * past. prev == current is still correct but we need to recalculate this_rq
+ * because prev may have moved to another CPU.
+ */
+static struct rq *finish_task_switch(struct task_struct *prev)
+{
+	struct rq *rq = this_rq();
+	long prev_state;
+
+	/*
+	 * A task struct has one reference for the use as "current".
+	 * If a task dies, then it sets TASK_DEAD in tsk->state and calls
+	 * schedule one last time. The schedule call will never return, and
+	 * the scheduled task must drop that reference.
+	 *
+	 * We must observe prev->state before clearing prev->on_cpu,
+	 * otherwise a concurrent wakeup can get prev running on another
+	 * CPU and we could race with its RUNNING -> DEAD transition,
+	 * resulting in a double drop.
+	 */
+	prev_state = prev->state;
+
+	/*
+	 * After ->on_cpu is cleared, the task can be moved to a different CPU.
+	 * We must ensure this doesn't happen until the switch is completely
+	 * finished.
+	 */
+	smp_store_release(&prev->on_cpu, 0);
+	raw_spin_unlock_irq(&rq->lock);
+
+	if (unlikely(prev_state == TASK_DEAD)) {
+		put_task_stack(prev);
+		put_task_struct(prev);
+	}
+
+	return rq;
 }
 
 /**
@@ -33,14 +449,268 @@ void sched_init(void)
  */
 asmlinkage __visible void schedule_tail(struct task_struct *prev)
 {
+	/*
+	 * New tasks start with FORK_PREEMPT_COUNT, see there and
+	 * finish_task_switch() for details.
+	 *
+	 * finish_task_switch() will drop rq->lock() and lower preempt_count
+	 * and the preempt_enable() will end up enabling preemption (on
+	 * PREEMPT_COUNT kernels).
+	 */
+	finish_task_switch(prev);
+	preempt_enable();
+}
+
+/*
+ * context_switch - switch to the new MM and the new thread's register state.
+ */
+static __always_inline struct rq *
+context_switch(struct rq *rq, struct task_struct *prev,
+	       struct task_struct *next)
+{
+	struct mm_struct *mm, *oldmm;
+
+	prepare_task_switch(rq, next);
+
+	mm = next->mm;
+	oldmm = prev->active_mm;
+
+	/*
+	 * Kernel threads borrow the address space of whoever ran before
+	 * them, user tasks install their own page tables.
+	 */
+	if (!mm) {
+		next->active_mm = oldmm;
+		enter_lazy_tlb(oldmm, next);
+	} else
+		switch_mm(oldmm, mm, next);
 
+	if (!prev->mm)
+		prev->active_mm = NULL;
+
+	/* Here we just switch the register state and the stack. */
+	switch_to(prev, next, prev);
+	barrier();
+
+	return finish_task_switch(prev);
 }
 
-int in_sched_functions(unsigned long addr)
+/*
+ * pick_next_task - the O(1) part of the scheduler: the first set bit
+ * of the active bitmap names the highest priority non-empty queue.
+ * When the active array runs dry the expired one takes its place.
+ */
+static inline struct task_struct *pick_next_task(struct rq *rq)
 {
-	return in_lock_functions(addr) ||
-		(addr >= (unsigned long)__sched_text_start
-		&& addr < (unsigned long)__sched_text_end);
+	struct prio_array *array = rq->active;
+	int idx;
+
+	if (unlikely(!rq->nr_running))
+		return rq->idle;
+
+	if (unlikely(!array->nr_active)) {
+		rq->active = rq->expired;
+		rq->expired = array;
+		array = rq->active;
+	}
+
+	idx = find_first_bit(array->bitmap, MAX_PRIO);
+
+	return list_first_entry(array->queue + idx, struct task_struct,
+				run_list);
+}
+
+/*
+ * __schedule() is the main scheduler function.
+ *
+ * The main means of driving the scheduler and thus entering this function are:
+ *
+ *   1. Explicit blocking: mutex, semaphore, waitqueue, etc.
+ *
+ *   2. TIF_NEED_RESCHED flag is checked on interrupt and userspace return
+ *      paths. For example, see arch/arm64/core/entry.S.
+ *
+ *      To drive preemption between tasks, the scheduler sets the flag in timer
+ *      interrupt handler scheduler_tick().
+ *
+ *   3. Wakeups don't really cause entry into schedule(). They add a
+ *      task to the run-queue and that's it.
+ *
+ * WARNING: must be called with preemption disabled!
+ */
+static void __sched __schedule(bool preempt)
+{
+	struct task_struct *prev, *next;
+	struct rq *rq;
+
+	rq = this_rq();
+	prev = rq->curr;
+
+	local_irq_disable();
+
+	raw_spin_lock(&rq->lock);
+	smp_mb__after_spinlock();
+
+	if (!preempt && prev->state)
+		deactivate_task(rq, prev);
+
+	if (unlikely(!rq->nr_running))
+		idle_balance(rq);
+
+	next = pick_next_task(rq);
+	clear_tsk_need_resched(prev);
+	clear_preempt_need_resched();
+
+	if (likely(prev != next)) {
+		rq->nr_switches++;
+		rq->curr = next;
+
+		/* Also unlocks the rq: */
+		rq = context_switch(rq, prev, next);
+	} else {
+		raw_spin_unlock_irq(&rq->lock);
+	}
+}
+
+asmlinkage __visible void __sched schedule(void)
+{
+	do {
+		preempt_disable();
+		__schedule(false);
+		sched_preempt_enable_no_resched();
+	} while (need_resched());
+}
+
+/*
+ * synchronize_rcu_tasks() makes sure that no task is stuck in preempted
+ * state (have scheduled out non-voluntarily) by making sure that all
+ * tasks have either left the run queue or have gone into user space.
+ * As idle tasks do not do either, they must not ever be preempted
+ * (schedule out non-voluntarily).
+ *
+ * schedule_idle() is similar to schedule_preempt_disable() except that it
+ * never enables preemption because it does not call sched_submit_work().
+ */
+void __sched schedule_idle(void)
+{
+	/*
+	 * As this skips calling sched_submit_work(), which the idle task does
+	 * regardless because that function is a nop when the task is in a
+	 * TASK_RUNNING state, make sure this isn't used someplace that the
+	 * current task can be in any other state. Note, idle is always in the
+	 * TASK_RUNNING state.
+	 */
+	WARN_ON_ONCE(current->state);
+	do {
+		__schedule(false);
+	} while (need_resched());
+}
+
+/*
+ * Leave the CPU for good. finish_task_switch() on the next task drops
+ * the stack and the task_struct.
+ */
+void __noreturn do_task_dead(void)
+{
+	preempt_disable();
+	current->state = TASK_DEAD;
+	__schedule(false);
+	BUG();
+
+	/* BUG() may compile to nothing, never return regardless. */
+	for (;;)
+		cpu_relax();
+}
+
+/**
+ * schedule_preempt_disabled - called with preemption disabled
+ *
+ * Returns with preemption disabled. Note: preempt_count must be 1
+ */
+void __sched schedule_preempt_disabled(void)
+{
+	sched_preempt_enable_no_resched();
+	schedule();
+	preempt_disable();
+}
+
+/**
+ * schedule_direct - block current and run @next in its place
+ * @next: a blocked task which has just been handed work by current
+ *
+ * The synchronous IPC fast path. Rather than putting @next on a runqueue
+ * through try_to_wake_up() and having pick_next_task() find it again,
+ * @next is queued on this CPU and switched to straight away. It runs on
+ * what is left of current's timeslice and current gets @next's leftovers
+ * back, so a call/reply round trip neither creates nor destroys time.
+ *
+ * The caller must have set current->state before handing @next its work.
+ * Falls back to a regular wakeup and schedule() when @next is still being
+ * switched out elsewhere, may not run on this CPU, or has a lower priority
+ * than current.
+ */
+void __sched schedule_direct(struct task_struct *next)
+{
+	struct task_struct *prev = current;
+	unsigned int slice;
+	struct rq *rq;
+	int cpu;
+
+	preempt_disable();
+	local_irq_disable();
+
+	cpu = smp_processor_id();
+	rq = cpu_rq(cpu);
+
+	raw_spin_lock(&next->pi_lock);
+	smp_mb__after_spinlock();
+
+	if (unlikely(!(next->state & TASK_NORMAL) || next->on_rq ||
+		     READ_ONCE(next->on_cpu) || next->prio > prev->prio ||
+		     !cpumask_test_cpu(cpu, &next->cpus_allowed))) {
+		raw_spin_unlock(&next->pi_lock);
+		local_irq_enable();
+		sched_preempt_enable_no_resched();
+
+		wake_up_process(next);
+		schedule();
+		return;
+	}
+
+	raw_spin_lock(&rq->lock);
+	smp_mb__after_spinlock();
+
+	if (prev->state)
+		deactivate_task(rq, prev);
+
+	next->state = TASK_WAKING;
+	if (task_cpu(next) != cpu)
+		set_task_cpu(next, cpu);
+	activate_task(rq, next);
+	next->state = TASK_RUNNING;
+	raw_spin_unlock(&next->pi_lock);
+
+	/* Donate the rest of our timeslice: */
+	slice = next->time_slice;
+	next->time_slice = prev->time_slice;
+	prev->time_slice = slice;
+
+	/* prev stays queued if it was not blocking after all: */
+	kick_idle_balance(rq);
+
+	clear_tsk_need_resched(prev);
+	clear_preempt_need_resched();
+
+	rq->nr_switches++;
+	rq->nr_direct_switches++;
+	rq->curr = next;
+
+	/* Also unlocks the rq: */
+	context_switch(rq, prev, next);
+
+	sched_preempt_enable_no_resched();
+	if (need_resched())
+		schedule();
 }
 
 /*
@@ -50,10 +720,314 @@ int in_sched_functions(unsigned long addr)
  */
 asmlinkage __visible void __sched preempt_schedule(void)
 {
+	/*
+	 * If there is a non-zero preempt_count or interrupts are disabled,
+	 * we do not want to preempt the current task. Just return..
+	 */
+	if (likely(!preemptible()))
+		return;
+
+	do {
+		preempt_disable();
+		__schedule(true);
+		sched_preempt_enable_no_resched();
+		/*
+		 * Check again in case we missed a preemption opportunity
+		 * between schedule and now.
+		 */
+	} while (need_resched());
+}
+
+/*
+ * this is the entry point to schedule() from kernel preemption
+ * off of irq context.
+ * Note, that this is called and return with irqs disabled. This will
+ * protect us against recursive calling from irq.
+ */
+asmlinkage __visible void __sched preempt_schedule_irq(void)
+{
+	/* Catch callers which need to be fixed */
+	BUG_ON(preempt_count() || !irqs_disabled());
+
+	do {
+		preempt_disable();
+		local_irq_enable();
+		__schedule(true);
+		local_irq_disable();
+		sched_preempt_enable_no_resched();
+	} while (need_resched());
+}
+
+/*
+ * This function gets called by the timer code, with HZ frequency.
+ * We call it with interrupts disabled.
+ */
+void scheduler_tick(void)
+{
+	struct rq *rq = this_rq();
+	struct task_struct *p = rq->curr;
+
+	if (p == rq->idle) {
+		/*
+		 * Catch imbalances whose kick we missed: do_idle() keeps
+		 * the tick of an idle CPU running while there are any,
+		 * so it looks for work at least once per tick.
+		 */
+		if (need_idle_balance(rq)) {
+			set_tsk_need_resched(p);
+			set_preempt_need_resched();
+		}
+		return;
+	}
+
+	raw_spin_lock(&rq->lock);
+
+	/* Task might have expired already, but not scheduled off yet */
+	if (unlikely(p->array != rq->active)) {
+		set_tsk_need_resched(p);
+		goto out_unlock;
+	}
+
+	/*
+	 * The task was running during this tick - update the
+	 * time slice counter. Note: we do not update a thread's
+	 * priority until it either goes to sleep or uses up its
+	 * timeslice.
+	 */
+	if (rt_task(p)) {
+		/*
+		 * RR tasks need a special form of timeslice management.
+		 * FIFO tasks have no timeslices.
+		 */
+		if ((p->policy == SCHED_RR) && !--p->time_slice) {
+			p->time_slice = task_timeslice(p);
+			set_tsk_need_resched(p);
+
+			/* put it at the end of the queue: */
+			requeue_task(p, rq->active);
+		}
+		goto out_unlock;
+	}
+
+	if (!--p->time_slice) {
+		dequeue_task(p, rq->active);
+		set_tsk_need_resched(p);
+		p->time_slice = task_timeslice(p);
+		enqueue_task(p, rq->expired);
+	}
+
+out_unlock:
+	raw_spin_unlock(&rq->lock);
+	if (test_tsk_need_resched(p))
+		set_preempt_need_resched();
+}
+
+/*
+ * The IPI_RESCHEDULE handler: the sender already set TIF_NEED_RESCHED
+ * on our current task, fold it into the preempt count so the return
+ * from interrupt path notices.
+ */
+void scheduler_ipi(void)
+{
+	preempt_fold_need_resched();
+	tick_nohz_full_check();
+}
 
+/*
+ * sched_can_stop_tick - may the current CPU run without the tick?
+ *
+ * With at most one runnable task there is nobody to time slice against.
+ * Called with interrupts disabled.
+ */
+bool sched_can_stop_tick(void)
+{
+	return READ_ONCE(this_rq()->nr_running) <= 1;
 }
 
-int wake_up_process(struct task_struct *tsk)
+/**
+ * yield - yield the current processor to other threads.
+ *
+ * Real-time tasks are put at the tail of their priority queue so that
+ * peers of equal priority run first; normal tasks go to the expired
+ * array so that every other runnable task gets a turn.
+ */
+void __sched yield(void)
 {
+	struct rq *rq;
+	struct task_struct *p = current;
+
+	local_irq_disable();
+	rq = this_rq();
+	raw_spin_lock(&rq->lock);
+
+	if (rt_task(p)) {
+		if (p->array->nr_active > 1)
+			requeue_task(p, p->array);
+	} else if (rq->expired != p->array) {
+		dequeue_task(p, p->array);
+		enqueue_task(p, rq->expired);
+	} else {
+		requeue_task(p, p->array);
+	}
+
+	/*
+	 * Since we are going to call schedule() anyway, there's
+	 * no need to preempt or enable interrupts:
+	 */
+	preempt_disable();
+	raw_spin_unlock_irq(&rq->lock);
+	sched_preempt_enable_no_resched();
+
+	schedule();
+}
+
+asmlinkage long sys_sched_yield(struct pt_regs *regs)
+{
+	yield();
 	return 0;
 }
+
+/**
+ * idle_cpu - is a given CPU idle currently?
+ * @cpu: the processor in question.
+ *
+ * Return: 1 if the CPU is currently idle. 0 otherwise.
+ */
+int idle_cpu(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+
+	if (rq->curr != rq->idle)
+		return 0;
+
+	if (READ_ONCE(rq->nr_running))
+		return 0;
+
+	return 1;
+}
+
+/**
+ * idle_task - return the idle task for a given CPU.
+ * @cpu: the processor in question.
+ *
+ * Return: The idle task for the CPU @cpu.
+ */
+struct task_struct *idle_task(int cpu)
+{
+	return cpu_rq(cpu)->idle;
+}
+
+unsigned long nr_running(void)
+{
+	unsigned long i, sum = 0;
+
+	for_each_online_cpu(i)
+		sum += READ_ONCE(cpu_rq(i)->nr_running);
+
+	return sum;
+}
+
+u64 nr_context_switches(void)
+{
+	int i;
+	u64 sum = 0;
+
+	for_each_possible_cpu(i)
+		sum += cpu_rq(i)->nr_switches;
+
+	return sum;
+}
+
+/**
+ * init_idle - set up an idle thread for a given CPU
+ * @idle: task in question
+ * @cpu: CPU the idle task belongs to
+ *
+ * NOTE: this function does not set the idle thread's NEED_RESCHED
+ * flag, to make booting more robust.
+ */
+void init_idle(struct task_struct *idle, int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&idle->pi_lock, flags);
+	raw_spin_lock(&rq->lock);
+
+	idle->state = TASK_RUNNING;
+	idle->flags |= PF_IDLE;
+	idle->prio = idle->static_prio = MAX_PRIO;
+	idle->array = NULL;
+	idle->on_rq = 0;
+
+	cpumask_copy(&idle->cpus_allowed, cpumask_of(cpu));
+	idle->nr_cpus_allowed = 1;
+	set_task_cpu(idle, cpu);
+
+	rq->curr = rq->idle = idle;
+	idle->on_cpu = 1;
+
+	raw_spin_unlock(&rq->lock);
+	raw_spin_unlock_irqrestore(&idle->pi_lock, flags);
+
+	/* Set the preempt count _outside_ the spinlocks! */
+	init_idle_preempt_count(idle, cpu);
+}
+
+int in_sched_functions(unsigned long addr)
+{
+	return in_lock_functions(addr) ||
+		(addr >= (unsigned long)__sched_text_start
+		&& addr < (unsigned long)__sched_text_end);
+}
+
+void __init sched_init_smp(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		cpu_rq(cpu)->online = 1;
+}
+
+void __init sched_init(void)
+{
+	int i, j, k;
+
+	for_each_possible_cpu(i) {
+		struct prio_array *array;
+		struct rq *rq;
+
+		rq = cpu_rq(i);
+		raw_spin_lock_init(&rq->lock);
+		rq->nr_running = 0;
+		rq->nr_switches = 0;
+		rq->cpu = i;
+		rq->online = 0;
+		rq->active = rq->arrays;
+		rq->expired = rq->arrays + 1;
+
+		for (j = 0; j < 2; j++) {
+			array = rq->arrays + j;
+			array->nr_active = 0;
+			for (k = 0; k < MAX_PRIO; k++)
+				INIT_LIST_HEAD(array->queue + k);
+			bitmap_zero(array->bitmap, MAX_PRIO);
+			/* delimiter for bitsearch: */
+			__set_bit(MAX_PRIO, array->bitmap);
+		}
+	}
+
+	/*
+	 * The boot idle thread does lazy MMU switching as well:
+	 */
+	enter_lazy_tlb(&init_mm, current);
+
+	/*
+	 * Make us the idle thread. Technically, schedule() should not be
+	 * called from this thread, however somewhere below it might be,
+	 * but because we are the idle thread, we just pick up running again
+	 * when this runqueue becomes "idle".
+	 */
+	init_idle(current, smp_processor_id());
+	cpu_rq(smp_processor_id())->online = 1;
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Generic entry points for the idle threads and
+ * implementation of the idle task scheduling class.
+ */
+#include <base/compiler.h>
+
+#include <rtochius/sched.h>
+#include <rtochius/sched/idle.h>
+#include <rtochius/cpu.h>
+#include <rtochius/irqflags.h>
+#include <rtochius/tick.h>
+#include <rtochius/sysring.h>
+#include <rtochius/mm.h>
+
+#include "sched.h"
+
+/*
+ * Generic idle loop implementation
+ *
+ * Called with polling cleared.
+ */
+static void do_idle(void)
+{
+	/*
+	 * If the arch has a polling bit, we maintain an invariant:
+	 *
+	 * Our polling bit is clear if we're not scheduled (i.e. if rq->curr !=
+	 * rq->idle). This means that, if rq->idle has the polling bit set,
+	 * then setting need_resched is guaranteed to cause the CPU to
+	 * reschedule.
+	 */
+	while (!need_resched()) {
+		/* Submission rings in SQPOLL mode get served before WFI. */
+		if (sysring_idle_poll())
+			continue;
+
+		/* Then the struct pages boot left for later get set up. */
+		if (deferred_init_idle())
+			continue;
+
+		/* Then free pages get cleared ahead of __GFP_ZERO users. */
+		if (prezero_idle())
+			continue;
+
+		local_irq_disable();
+		/*
+		 * Re-check under disabled interrupts: a wakeup IPI that
+		 * landed after the test above is still pending and will
+		 * bring us straight back out of WFI.
+		 */
+		if (need_resched()) {
+			local_irq_enable();
+			break;
+		}
+		/*
+		 * A stopped tick would leave a missed steal kick missed
+		 * for good, so keep it running while some other CPU has
+		 * a task to spare and scheduler_tick() retries for us.
+		 */
+		if (need_idle_balance(this_rq()))
+			tick_nohz_idle_exit();
+		else
+			tick_nohz_idle_enter();
+		arch_cpu_idle();
+	}
+
+	sysring_idle_exit();
+
+	local_irq_disable();
+	tick_nohz_idle_exit();
+	local_irq_enable();
+
+	/*
+	 * Since we fell out of the loop above, we know TIF_NEED_RESCHED must
+	 * be set, propagate it into PREEMPT_NEED_RESCHED.
+	 *
+	 * This is required because for polling idle loops we will not have had
+	 * an IPI to fold the state for us.
+	 */
+	preempt_set_need_resched();
+	schedule_idle();
+}
+
+void cpu_startup_entry(enum cpuhp_state state)
+{
+	while (1)
+		do_idle();
+}
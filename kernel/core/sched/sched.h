@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Scheduler internal types and methods:
+ */
+#ifndef __KERNEL_SCHED_SCHED_H_
+#define __KERNEL_SCHED_SCHED_H_
+
+#include <base/bitmap.h>
+#include <base/list.h>
+
+#include <rtochius/sched.h>
+#include <rtochius/sched/prio.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/percpu.h>
+#include <rtochius/jiffies.h>
+
+/*
+ * These are the 'tuning knobs' of the scheduler:
+ *
+ * Timeslices get refilled after they expire. RT tasks never
+ * expire, they are simply round-robined within their priority.
+ */
+#define MIN_TIMESLICE		max(5 * HZ / 1000, 1)
+#define DEF_TIMESLICE		(100 * HZ / 1000)
+
+/*
+ * The prio-array type of the O(1) scheduler. Every runnable task
+ * sits on queue[p->prio] of either the active or the expired array
+ * of its runqueue and the bitmap tracks which queues are non-empty,
+ * so picking the next task is one find_first_bit() over MAX_PRIO
+ * bits no matter how many tasks are runnable.
+ */
+struct prio_array {
+	unsigned int		nr_active;
+	DECLARE_BITMAP(bitmap, MAX_PRIO + 1); /* include 1 bit for delimiter */
+	struct list_head	queue[MAX_PRIO];
+};
+
+/*
+ * This is the main, per-CPU runqueue data structure.
+ *
+ * Locking rule: those places that want to lock multiple runqueues
+ * (such as the load balancing or the thread migration code), lock
+ * acquire operations must be ordered by ascending &runqueue.
+ */
+struct rq {
+	raw_spinlock_t		lock;
+
+	/*
+	 * nr_running is updated under rq->lock but read locklessly by
+	 * other CPUs, hence the READ_ONCE()/WRITE_ONCE() accessors.
+	 */
+	unsigned int		nr_running;
+	u64			nr_switches;
+	/* Switches done by schedule_direct(), a subset of nr_switches: */
+	u64			nr_direct_switches;
+
+	struct task_struct	*curr;
+	struct task_struct	*idle;
+
+	struct prio_array	*active;
+	struct prio_array	*expired;
+	struct prio_array	arrays[2];
+
+	int			cpu;
+	int			online;
+
+	/* Idle balancing statistics: */
+	unsigned long		nr_steal_attempts;
+	unsigned long		nr_steals;
+	unsigned long		nr_migrations_in;
+	unsigned long		nr_migrations_out;
+	unsigned long		nr_kicks;
+};
+
+DECLARE_PER_CPU_SHARED_ALIGNED(struct rq, runqueues);
+
+#define cpu_rq(cpu)		(&per_cpu(runqueues, (cpu)))
+#define this_rq()		this_cpu_ptr(&runqueues)
+#define task_rq(p)		cpu_rq(task_cpu(p))
+#define cpu_curr(cpu)		(cpu_rq(cpu)->curr)
+
+static inline int cpu_of(struct rq *rq)
+{
+	return rq->cpu;
+}
+
+static inline int task_current(struct rq *rq, struct task_struct *p)
+{
+	return rq->curr == p;
+}
+
+static inline int task_running(struct rq *rq, struct task_struct *p)
+{
+	return p->on_cpu;
+}
+
+struct rq *__task_rq_lock(struct task_struct *p);
+struct rq *task_rq_lock(struct task_struct *p, unsigned long *flags);
+
+static inline void __task_rq_unlock(struct rq *rq)
+{
+	raw_spin_unlock(&rq->lock);
+}
+
+static inline void
+task_rq_unlock(struct rq *rq, struct task_struct *p, unsigned long *flags)
+{
+	raw_spin_unlock(&rq->lock);
+	raw_spin_unlock_irqrestore(&p->pi_lock, *flags);
+}
+
+extern void enqueue_task(struct task_struct *p, struct prio_array *array);
+extern void dequeue_task(struct task_struct *p, struct prio_array *array);
+extern void activate_task(struct rq *rq, struct task_struct *p);
+extern void deactivate_task(struct rq *rq, struct task_struct *p);
+extern void resched_curr(struct rq *rq);
+extern void check_preempt_curr(struct rq *rq, struct task_struct *p);
+
+extern void idle_balance(struct rq *this_rq);
+extern void kick_idle_balance(struct rq *busy_rq);
+extern bool need_idle_balance(struct rq *this_rq);
+
+#endif /* !__KERNEL_SCHED_SCHED_H_ */
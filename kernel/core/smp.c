@@ -8,12 +8,14 @@
 #include <base/cache.h>
 #include <base/init.h>
 #include <base/errno.h>
+#include <base/err.h>
 
 #include <rtochius/spinlock.h>
 #include <rtochius/irqflags.h>
 #include <rtochius/percpu.h>
 #include <rtochius/cpumask.h>
 #include <rtochius/smp.h>
+#include <rtochius/sched/task.h>
 
 enum {
 	CSD_FLAG_LOCK		= 0x01,
@@ -453,7 +455,25 @@ void __init setup_nr_cpu_ids(void)
 /* Called by boot processor to activate the rest. */
 void __init smp_init(void)
 {
-	panic("TODO\n");
+	struct task_struct *idle;
+	unsigned int cpu;
+
+	pr_info("Bringing up secondary CPUs ...\n");
+
+	for_each_present_cpu(cpu) {
+		if (cpu_online(cpu))
+			continue;
+
+		idle = fork_idle(cpu);
+		if (IS_ERR(idle)) {
+			pr_err("CPU%u: no idle task: %ld\n", cpu, PTR_ERR(idle));
+			continue;
+		}
+
+		__cpu_up(cpu, idle);
+	}
+
+	smp_cpus_done(nr_cpu_ids);
 }
 
 /*
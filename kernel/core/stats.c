@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Dump the statistics of the various subsystems on request.
+ */
+#define pr_fmt(fmt) "stats: " fmt
+
+#include <base/compiler.h>
+#include <base/common.h>
+
+#include <rtochius/syscalls.h>
+#include <rtochius/sched.h>
+#include <rtochius/sched/debug.h>
+#include <rtochius/tick.h>
+#include <rtochius/ipc.h>
+#include <rtochius/slab.h>
+#include <rtochius/mm.h>
+#include <rtochius/cma.h>
+#include <rtochius/compaction.h>
+#include <rtochius/vmalloc.h>
+#include <rtochius/percpu.h>
+#include <rtochius/printf.h>
+
+#include <uapi/rtochius/stats.h>
+
+#include <asm/ptrace.h>
+#include <asm/fpsimd.h>
+
+static const struct {
+	unsigned int	mask;
+	const char	*name;
+	void		(*show)(void);
+} stats_sections[] = {
+	{ STATS_SCHED,		"sched",	show_sched_balance_stats },
+	{ STATS_TICK,		"tick",		show_tick_stats },
+	{ STATS_IPC,		"ipc",		show_ipc_stats },
+	{ STATS_NOTIFICATION,	"notification",	show_notification_stats },
+	{ STATS_GRANT,		"grant",	show_grant_stats },
+	{ STATS_SYSRING,	"sysring",	show_sysring_stats },
+	{ STATS_FPSIMD,		"fpsimd",	show_fpsimd_stats },
+	{ STATS_SLAB,		"slab",		show_slab_stats },
+	{ STATS_PAGE_ALLOC,	"page_alloc",	show_page_alloc_stats },
+	{ STATS_CMA,		"cma",		show_cma_stats },
+	{ STATS_COMPACT,	"compact",	show_compaction_stats },
+	{ STATS_VMALLOC,	"vmalloc",	show_vmalloc_stats },
+	{ STATS_PERCPU,		"percpu",	show_percpu_stats },
+	{ STATS_FAULT,		"fault",	show_fault_stats },
+};
+
+/*
+ * sys_show_stats - print the statistics selected by the STATS_* mask x0
+ * on the console.
+ */
+asmlinkage long sys_show_stats(struct pt_regs *regs)
+{
+	unsigned int mask = regs->regs[0];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(stats_sections); i++) {
+		if (!(mask & stats_sections[i].mask))
+			continue;
+
+		pr_info("--- %s ---\n", stats_sections[i].name);
+		stats_sections[i].show();
+	}
+
+	return 0;
+}
@@ -0,0 +1,338 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ *  Periodic and dynamic (NO_HZ) tick handling
+ *
+ *  Copyright(C) 2005-2006, Thomas Gleixner <tglx@linutronix.de>
+ *  Copyright(C) 2005-2007, Red Hat, Inc., Ingo Molnar
+ *
+ *  The tick is driven straight off the per-CPU EL1 virtual timer in
+ *  compare-value mode. Every CPU may advance jiffies_64: the update is
+ *  a catch-up from the counter, so a CPU that had its tick stopped for
+ *  a while simply accounts all the periods it slept through.
+ */
+#define pr_fmt(fmt) "tick: " fmt
+
+#include <base/types.h>
+#include <base/init.h>
+#include <base/common.h>
+#include <base/math64.h>
+
+#include <rtochius/tick.h>
+#include <rtochius/jiffies.h>
+#include <rtochius/sched.h>
+#include <rtochius/smp.h>
+#include <rtochius/percpu.h>
+#include <rtochius/param.h>
+#include <rtochius/printf.h>
+#include <rtochius/irqflags.h>
+#include <rtochius/interrupt.h>
+#include <rtochius/irqdomain.h>
+#include <rtochius/of.h>
+
+#include <asm/arch_timer.h>
+
+static DEFINE_PER_CPU(struct tick_sched, tick_cpu_sched);
+
+/* The virtual timer PPI, 0 if no interrupt controller maps it: */
+static unsigned int tick_timer_irq __read_mostly;
+
+/* Counter cycles per jiffy: */
+static u64 tick_period __read_mostly;
+
+/*
+ * The CNTVCT value jiffies_64 was last advanced to, protected by
+ * jiffies_lock. Read locklessly for the "nothing to do" check.
+ */
+static u64 last_jiffies_update;
+static DEFINE_RAW_SPINLOCK(jiffies_lock);
+
+/*
+ * Must be called with interrupts disabled !
+ */
+static void tick_do_update_jiffies64(u64 now)
+{
+	u64 delta, ticks;
+
+	/* Quick check without the lock, it is the common case. */
+	delta = now - READ_ONCE(last_jiffies_update);
+	if (delta < tick_period)
+		return;
+
+	raw_spin_lock(&jiffies_lock);
+	delta = now - last_jiffies_update;
+	if (delta >= tick_period) {
+		ticks = div64_u64(delta, tick_period);
+		WRITE_ONCE(last_jiffies_update,
+			   last_jiffies_update + ticks * tick_period);
+		WRITE_ONCE(jiffies_64, jiffies_64 + ticks);
+	}
+	raw_spin_unlock(&jiffies_lock);
+}
+
+/*
+ * The next period boundary after @now, aligned with the jiffies grid.
+ */
+static u64 tick_next_period(u64 now)
+{
+	u64 last = READ_ONCE(last_jiffies_update);
+
+	return last + (div64_u64(now - last, tick_period) + 1) * tick_period;
+}
+
+/*
+ * tick_handle_periodic - the architected timer interrupt body.
+ *
+ * Called from the virtual timer PPI handler with interrupts disabled.
+ */
+void tick_handle_periodic(void)
+{
+	struct tick_sched *ts = this_cpu_ptr(&tick_cpu_sched);
+	u64 now = arch_counter_get_cntvct();
+
+	ts->ticks_taken++;
+	tick_do_update_jiffies64(now);
+	scheduler_tick();
+
+#ifdef CONFIG_NO_HZ_FULL
+	/*
+	 * A full dynticks CPU with a single runnable task has no use for
+	 * the tick, leave the timer masked until the next enqueue kicks
+	 * us with IPI_RESCHEDULE.
+	 */
+	if (tick_nohz_full_cpu(smp_processor_id()) && sched_can_stop_tick()) {
+		ts->tick_stopped = 1;
+		ts->stop_tick = now;
+		arch_timer_mask_event();
+		return;
+	}
+#endif
+
+	ts->next_tick = tick_next_period(now);
+	arch_timer_set_next_event(ts->next_tick);
+}
+
+static irqreturn_t tick_timer_interrupt(int irq, void *dev_id)
+{
+	tick_handle_periodic();
+
+	return IRQ_HANDLED;
+}
+
+/*
+ * The "arm,armv8-timer" node lists the secure, non-secure, virtual and
+ * hypervisor timer PPIs in this order, three GIC cells each.
+ */
+#define ARCH_TIMER_VIRT_PPI	2
+#define ARCH_TIMER_IRQ_CELLS	3
+
+static unsigned int __init tick_of_timer_irq(void)
+{
+	struct of_phandle_args args = { .args_count = ARCH_TIMER_IRQ_CELLS };
+	struct device_node *np, *parent;
+	int i;
+
+	np = of_find_compatible_node(NULL, NULL, "arm,armv8-timer");
+	if (!np)
+		return 0;
+
+	for (i = 0; i < ARCH_TIMER_IRQ_CELLS; i++) {
+		if (of_property_read_u32_index(np, "interrupts",
+				ARCH_TIMER_VIRT_PPI * ARCH_TIMER_IRQ_CELLS + i,
+				&args.args[i]))
+			return 0;
+	}
+
+	/* interrupt-parent is inherited from the closest node that has one. */
+	for (parent = np; parent && !args.np; parent = of_get_parent(parent))
+		args.np = of_parse_phandle(parent, "interrupt-parent", 0);
+
+	return irq_create_of_mapping(&args);
+}
+
+/*
+ * Restart a stopped tick and account for the ticks that did not fire
+ * while it was off.
+ */
+static void tick_nohz_restart(struct tick_sched *ts, u64 now)
+{
+	u64 missed;
+
+	missed = div64_u64(now - ts->stop_tick, tick_period);
+	ts->ticks_suppressed += missed;
+	ts->tick_stopped = 0;
+
+	tick_do_update_jiffies64(now);
+
+	ts->next_tick = tick_next_period(now);
+	arch_timer_set_next_event(ts->next_tick);
+}
+
+#ifdef CONFIG_NO_HZ_COMMON
+/**
+ * tick_nohz_idle_enter - prepare for entering idle on the current CPU
+ *
+ * Called from the idle loop with interrupts disabled, right before
+ * arch_cpu_idle(). Nothing but an interrupt can end the idle period,
+ * so there is no deadline to keep and the tick is masked entirely.
+ */
+void tick_nohz_idle_enter(void)
+{
+	struct tick_sched *ts = this_cpu_ptr(&tick_cpu_sched);
+
+	ts->inidle = 1;
+	ts->idle_calls++;
+
+	if (ts->tick_stopped || need_resched())
+		return;
+
+	ts->stop_tick = arch_counter_get_cntvct();
+	ts->tick_stopped = 1;
+	ts->idle_sleeps++;
+	arch_timer_mask_event();
+}
+
+/**
+ * tick_nohz_idle_exit - restart the idle tick from the idle task
+ *
+ * Restart the idle tick when the CPU is woken up from idle. Called with
+ * interrupts disabled, on the way from the idle loop to schedule().
+ */
+void tick_nohz_idle_exit(void)
+{
+	struct tick_sched *ts = this_cpu_ptr(&tick_cpu_sched);
+
+	ts->inidle = 0;
+
+	if (ts->tick_stopped)
+		tick_nohz_restart(ts, arch_counter_get_cntvct());
+}
+#endif /* CONFIG_NO_HZ_COMMON */
+
+#ifdef CONFIG_NO_HZ_FULL
+cpumask_var_t tick_nohz_full_mask;
+bool tick_nohz_full_running;
+
+/*
+ * Kick the CPU if it's full dynticks in order to force it to
+ * re-evaluate its dependency on the tick and restart it if necessary.
+ * The local CPU does so right away.
+ */
+void tick_nohz_full_kick_cpu(int cpu)
+{
+	if (!tick_nohz_full_cpu(cpu))
+		return;
+
+	if (!READ_ONCE(per_cpu(tick_cpu_sched, cpu).tick_stopped))
+		return;
+
+	if (cpu == smp_processor_id())
+		tick_nohz_full_check();
+	else
+		smp_send_reschedule(cpu);
+}
+
+/*
+ * Called from the IPI_RESCHEDULE handler, or straight from the enqueue on
+ * the local CPU, with interrupts disabled: a second task showed up on a
+ * full dynticks CPU, so time slicing needs the tick back.
+ */
+void tick_nohz_full_check(void)
+{
+	struct tick_sched *ts = this_cpu_ptr(&tick_cpu_sched);
+
+	if (!ts->tick_stopped || ts->inidle)
+		return;
+
+	if (!sched_can_stop_tick())
+		tick_nohz_restart(ts, arch_counter_get_cntvct());
+}
+
+static int __init tick_nohz_full_setup(char *str)
+{
+	cpumask_clear(tick_nohz_full_mask);
+	if (cpulist_parse(str, tick_nohz_full_mask) < 0) {
+		pr_warn("NO_HZ: Incorrect nohz_full cpumask\n");
+		return 1;
+	}
+
+	tick_nohz_full_running = true;
+
+	return 0;
+}
+early_param("nohz_full", tick_nohz_full_setup);
+#endif /* CONFIG_NO_HZ_FULL */
+
+/*
+ * tick_setup_cpu - start the periodic tick on the calling CPU.
+ *
+ * Called by tick_init() for the boot CPU and by secondary_start_kernel()
+ * for the others.
+ */
+void tick_setup_cpu(unsigned int cpu)
+{
+	struct tick_sched *ts = per_cpu_ptr(&tick_cpu_sched, cpu);
+	unsigned long flags;
+
+	local_irq_save(flags);
+	if (tick_timer_irq)
+		enable_percpu_irq(tick_timer_irq);
+	ts->tick_stopped = 0;
+	ts->next_tick = tick_next_period(arch_counter_get_cntvct());
+	arch_timer_set_next_event(ts->next_tick);
+	local_irq_restore(flags);
+}
+
+void __init tick_init(void)
+{
+	u32 freq = arch_timer_get_cntfrq();
+
+	tick_period = DIV_ROUND_UP(freq, HZ);
+	last_jiffies_update = arch_counter_get_cntvct();
+
+#ifdef CONFIG_NO_HZ_FULL
+	if (tick_nohz_full_running) {
+		/* The boot CPU keeps the tick for timekeeping. */
+		if (cpumask_test_cpu(smp_processor_id(), tick_nohz_full_mask)) {
+			pr_warn("NO_HZ: Clearing %d from nohz_full range for timekeeping\n",
+				smp_processor_id());
+			cpumask_clear_cpu(smp_processor_id(), tick_nohz_full_mask);
+		}
+		pr_info("NO_HZ: Full dynticks CPUs: %*pbl.\n",
+			cpumask_pr_args(tick_nohz_full_mask));
+	}
+#endif
+
+	pr_info("%u Hz counter, %llu cycles per tick\n", freq, tick_period);
+
+	tick_timer_irq = tick_of_timer_irq();
+	if (tick_timer_irq &&
+	    request_percpu_irq(tick_timer_irq, tick_timer_interrupt,
+			       "arch_timer", &tick_cpu_sched))
+		tick_timer_irq = 0;
+	if (!tick_timer_irq)
+		pr_warn("no virtual timer interrupt, the tick won't fire\n");
+
+	tick_setup_cpu(smp_processor_id());
+}
+
+void tick_get_stats(int cpu, unsigned long *taken, unsigned long *suppressed)
+{
+	struct tick_sched *ts = per_cpu_ptr(&tick_cpu_sched, cpu);
+
+	*taken = READ_ONCE(ts->ticks_taken);
+	*suppressed = READ_ONCE(ts->ticks_suppressed);
+}
+
+void show_tick_stats(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct tick_sched *ts = per_cpu_ptr(&tick_cpu_sched, cpu);
+
+		pr_info("CPU%d: ticks taken %lu suppressed %lu idle %lu/%lu%s\n",
+			cpu, ts->ticks_taken, ts->ticks_suppressed,
+			ts->idle_sleeps, ts->idle_calls,
+			ts->tick_stopped ? " (stopped)" : "");
+	}
+}
@@ -17,6 +17,7 @@
 #include <rtochius/of_fdt.h>
 #include <rtochius/of_reserved_mem.h>
 #include <rtochius/memory.h>
+#include <rtochius/cma.h>
 
 #include <asm/cache.h>
 
@@ -199,6 +200,37 @@ static void __init __rmem_check_for_overlap(void)
 	}
 }
 
+/*
+ * A "shared-dma-pool" marked "reusable" is a CMA area: its memory is
+ * given back to the page allocator until contiguous buffers are needed.
+ */
+static int __init rmem_cma_setup(struct reserved_mem *rmem)
+{
+	unsigned long node = rmem->fdt_node;
+	struct cma *cma;
+	int err;
+
+	if (of_get_flat_dt_prop(node, "no-map", NULL)) {
+		pr_err("Reusable '%s' must not be no-map\n", rmem->name);
+		return -EINVAL;
+	}
+
+	err = cma_declare_contiguous(rmem->base, rmem->size, rmem->name, &cma);
+	if (err) {
+		pr_err("Reserved memory: unable to setup CMA region '%s'\n",
+		       rmem->name);
+		return err;
+	}
+
+	if (of_get_flat_dt_prop(node, "linux,cma-default", NULL) ||
+	    !dma_contiguous_default_area)
+		dma_contiguous_default_area = cma;
+
+	rmem->priv = cma;
+
+	return 0;
+}
+
 /**
  * fdt_init_reserved_mem - allocate and init all saved reserved memory regions
  */
@@ -225,6 +257,10 @@ void __init fdt_init_reserved_mem(void)
 		if (rmem->size == 0)
 			err = __reserved_mem_alloc_size(node, rmem->name,
 						 &rmem->base, &rmem->size);
+		if (err == 0 &&
+		    of_flat_dt_is_compatible(node, "shared-dma-pool") &&
+		    of_get_flat_dt_prop(node, "reusable", NULL))
+			err = rmem_cma_setup(rmem);
 		/* TODO now reserved to device call func*/
 	}
 }
@@ -16,4 +16,10 @@
 #ifndef __CLKSOURCE_ARM_ARCH_TIMER_H_
 #define __CLKSOURCE_ARM_ARCH_TIMER_H_
 
+#include <base/bitops.h>
+
+#define ARCH_TIMER_CTRL_ENABLE		(1 << 0)
+#define ARCH_TIMER_CTRL_IT_MASK		(1 << 1)
+#define ARCH_TIMER_CTRL_IT_STAT		(1 << 2)
+
 #endif /* !__CLKSOURCE_ARM_ARCH_TIMER_H_ */
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __RTOCHIUS_CMA_H_
+#define __RTOCHIUS_CMA_H_
+
+#include <base/types.h>
+
+#define MAX_CMA_AREAS	8
+
+struct cma;
+struct page;
+struct mm_struct;
+
+/* The area user space drivers get their DMA buffers from. */
+extern struct cma *dma_contiguous_default_area;
+
+extern int cma_declare_contiguous(phys_addr_t base, phys_addr_t size,
+				  const char *name, struct cma **res_cma);
+extern struct page *cma_alloc(struct cma *cma, unsigned long count,
+			      unsigned int align);
+extern bool cma_release(struct cma *cma, struct page *pages,
+			unsigned long count);
+
+extern void dma_release_mm(struct mm_struct *mm);
+
+extern void show_cma_stats(void);
+
+#endif /* !__RTOCHIUS_CMA_H_ */
@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __RTOCHIUS_COMPACTION_H_
+#define __RTOCHIUS_COMPACTION_H_
+
+struct zone;
+
+/* Compact the whole zone rather than stop at the first suitable block: */
+#define COMPACT_ORDER_ALL	(-1)
+
+extern long compact_zone(struct zone *zone, int order);
+
+extern void show_compaction_stats(void);
+
+#endif /* !__RTOCHIUS_COMPACTION_H_ */
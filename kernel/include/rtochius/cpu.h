@@ -60,4 +60,6 @@ static inline int cpuhp_setup_state(enum cpuhp_state state,
 
 extern void notify_cpu_starting(unsigned int cpu);
 
+extern void cpu_startup_entry(enum cpuhp_state state);
+
 #endif /* !__RTOCHIUS_CPU_H_ */
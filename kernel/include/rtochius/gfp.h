@@ -15,7 +15,9 @@
 #define ___GFP_KERNEL		BIT(5)
 #define ___GFP_USER			BIT(6)
 
-#define __GFP_BITS_SHIFT	7
+#define ___GFP_COMPACT		BIT(7)
+
+#define __GFP_BITS_SHIFT	8
 #define __GFP_BITS_MASK 	((gfp_t)((1 << __GFP_BITS_SHIFT) - 1))
 
 #define __GFP_DMA			((gfp_t)___GFP_DMA)
@@ -29,6 +31,13 @@
 #define __GFP_KERNEL		((gfp_t)___GFP_KERNEL)
 #define __GFP_USER			((gfp_t)___GFP_USER)
 
+/*
+ * A failed high-order allocation may compact the zone, which takes the
+ * page table locks of other address spaces. Only for callers that hold
+ * no spinlock of their own.
+ */
+#define __GFP_COMPACT		((gfp_t)___GFP_COMPACT)
+
 #define GFP_DMA				(__GFP_DMA)
 #define GFP_MOVABLE			(__GFP_MOVABLE)
 #define GFP_NORMAL			(__GFP_NORMAL)
@@ -59,10 +68,27 @@ extern struct page *__alloc_pages(gfp_t gfp_mask, unsigned int order);
 #define alloc_pages(gfp_mask, order)	__alloc_pages(gfp_mask, order)
 #define alloc_page(gfp_mask) alloc_pages(gfp_mask, 0)
 
+extern unsigned long __alloc_pages_bulk(gfp_t gfp_mask, unsigned long nr_pages,
+					struct list_head *page_list,
+					struct page **page_array);
+
+/* Bulk allocate order-0 pages */
+#define alloc_pages_bulk(gfp_mask, nr_pages, page_array)	\
+	__alloc_pages_bulk(gfp_mask, nr_pages, NULL, page_array)
+
+#define alloc_pages_bulk_list(gfp_mask, nr_pages, page_list)	\
+	__alloc_pages_bulk(gfp_mask, nr_pages, page_list, NULL)
+
 extern void __free_pages(struct page *page, unsigned int order);
 extern void free_pages(unsigned long addr, unsigned int order);
 
 #define __free_page(page) __free_pages((page), 0)
 #define free_page(addr) free_pages((addr), 0)
 
+extern void split_page(struct page *page, unsigned int order);
+
+/* The range must lie within a single zone, see alloc_contig_range(). */
+extern int alloc_contig_range(unsigned long start_pfn, unsigned long end_pfn);
+extern void free_contig_range(unsigned long pfn, unsigned long nr_pages);
+
 #endif /* !__RTOCHIUS_GFP_H_ */
@@ -142,6 +142,19 @@ struct irqaction {
  */
 #define IRQ_NOTCONNECTED	(1U << 31)
 
+extern int
+request_irq(unsigned int irq, irq_handler_t handler, unsigned long flags,
+	    const char *name, void *dev);
+extern const void *free_irq(unsigned int, void *);
+
+extern int
+request_percpu_irq(unsigned int irq, irq_handler_t handler,
+		   const char *devname, void __percpu *percpu_dev_id);
+extern void enable_percpu_irq(unsigned int irq);
+
+extern void disable_irq_nosync(unsigned int irq);
+extern void enable_irq(unsigned int irq);
+
 
 
 
@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __RTOCHIUS_IPC_H_
+#define __RTOCHIUS_IPC_H_
+
+#include <base/types.h>
+#include <base/list.h>
+
+#include <uapi/rtochius/ipc.h>
+
+struct task_struct;
+struct ipc_endpoint;
+
+/* ipc_thread::state */
+#define IPC_RUNNING		0
+#define IPC_BLOCKED_SEND	1	/* queued on an endpoint, no receiver yet */
+#define IPC_BLOCKED_RECV	2	/* waiting on an endpoint for a caller */
+#define IPC_BLOCKED_REPLY	3	/* message delivered, waiting for the reply */
+
+/*
+ * Per-thread IPC state, embedded in task_struct.
+ */
+struct ipc_thread {
+	int			state;
+	/* Handed to the thread on wakeup, becomes the syscall return: */
+	long			status;
+	/* The caller we owe a reply to, set between receive and reply: */
+	struct task_struct	*caller;
+	/* Entry on ipc_endpoint::sendq or ::recvq: */
+	struct list_head	node;
+	/* The ring owner the idle task runs SQPOLL calls for, or 0: */
+	pid_t			sqpoll_pid;
+};
+
+static inline void ipc_task_init(struct ipc_thread *ipc)
+{
+	ipc->state = IPC_RUNNING;
+	ipc->status = 0;
+	ipc->caller = NULL;
+	INIT_LIST_HEAD(&ipc->node);
+	ipc->sqpoll_pid = 0;
+}
+
+extern pid_t ipc_current_pid(void);
+
+extern void show_ipc_stats(void);
+extern void show_notification_stats(void);
+extern void show_grant_stats(void);
+extern void show_sysring_stats(void);
+
+#endif /* !__RTOCHIUS_IPC_H_ */
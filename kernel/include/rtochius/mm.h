@@ -110,6 +110,23 @@ static inline pg_data_t *page_pgdat(const struct page *page)
 	return NODE_DATA();
 }
 
+/*
+ * A movable page is a user page mapped exactly once, at page->index in
+ * the address space page->mapping, which compaction may move to another
+ * physical page with migrate_user_page(). Compaction clears the flag
+ * while it holds the page isolated, and it goes away when the page is
+ * freed.
+ */
+static inline void set_page_movable(struct page *page, struct mm_struct *mm,
+				    unsigned long addr)
+{
+	page->mapping = mm;
+	page->index = addr;
+	/* Pairs with the recheck of the flag in isolate_migratepages(). */
+	smp_wmb();
+	SetPageMovable(page);
+}
+
 extern void mem_print_memory_info(void);
 extern void reserve_bootmem_region(phys_addr_t start, phys_addr_t end);
 extern void memblock_free_pages(struct page *page, unsigned long pfn,
@@ -120,7 +137,7 @@ extern unsigned long free_reserved_area(void *start, void *end,
 					int poison, const char *s);
 
 extern void free_compound_page(struct page *page);
-extern void free_unref_page(struct page *page);
+extern void free_unref_page(struct page *page, unsigned int order);
 
 extern void arch_free_page(struct page *page, int order);
 
@@ -129,7 +146,7 @@ static inline void __put_page(struct page *page)
 	if (unlikely(PageCompound(page)))
 		free_compound_page(page);
 	else
-		free_unref_page(page);
+		free_unref_page(page, 0);
 }
 
 static inline void get_page(struct page *page)
@@ -174,11 +191,106 @@ static inline void pgtable_page_dtor(struct page *page)
 	__ClearPageTable(page);
 }
 
+#ifdef __PAGETABLE_PUD_FOLDED
+static inline int __pud_alloc(struct mm_struct *mm, p4d_t *p4d,
+						unsigned long address)
+{
+	return 0;
+}
+#else
+int __pud_alloc(struct mm_struct *mm, p4d_t *p4d, unsigned long address);
+#endif
+
+#ifdef __PAGETABLE_PMD_FOLDED
+static inline int __pmd_alloc(struct mm_struct *mm, pud_t *pud,
+						unsigned long address)
+{
+	return 0;
+}
+#else
+int __pmd_alloc(struct mm_struct *mm, pud_t *pud, unsigned long address);
+#endif
+
+int __pte_alloc(struct mm_struct *mm, pmd_t *pmd, unsigned long address);
+int __pte_alloc_kernel(pmd_t *pmd, unsigned long address);
+
+/*
+ * The following ifdef needed to get the 5level-fixup.h header to work.
+ * Remove it when 5level-fixup.h has been removed.
+ */
+#ifndef __ARCH_HAS_5LEVEL_HACK
+static inline p4d_t *p4d_alloc(struct mm_struct *mm, pgd_t *pgd,
+		unsigned long address)
+{
+	return (unlikely(pgd_none(*pgd)) && __p4d_alloc(mm, pgd, address)) ?
+		NULL : p4d_offset(pgd, address);
+}
+
+static inline pud_t *pud_alloc(struct mm_struct *mm, p4d_t *p4d,
+		unsigned long address)
+{
+	return (unlikely(p4d_none(*p4d)) && __pud_alloc(mm, p4d, address)) ?
+		NULL : pud_offset(p4d, address);
+}
+#endif /* !__ARCH_HAS_5LEVEL_HACK */
+
+static inline pmd_t *pmd_alloc(struct mm_struct *mm, pud_t *pud, unsigned long address)
+{
+	return (unlikely(pud_none(*pud)) && __pmd_alloc(mm, pud, address))?
+		NULL: pmd_offset(pud, address);
+}
+
+#define pte_offset_map_lock(mm, pmd, address, ptlp)	\
+({							\
+	spinlock_t *__ptl = pte_lockptr(mm, pmd);	\
+	pte_t *__pte = pte_offset_map(pmd, address);	\
+	*(ptlp) = __ptl;				\
+	spin_lock(__ptl);				\
+	__pte;						\
+})
+
+#define pte_unmap_unlock(pte, ptl)	do {		\
+	spin_unlock(ptl);				\
+	pte_unmap(pte);					\
+} while (0)
+
+#define pte_alloc(mm, pmd, address)			\
+	(unlikely(pmd_none(*(pmd))) && __pte_alloc(mm, pmd, address))
+
+#define pte_alloc_map_lock(mm, pmd, address, ptlp)	\
+	(pte_alloc(mm, pmd, address) ?			\
+		 NULL : pte_offset_map_lock(mm, pmd, address, ptlp))
+
+#define pte_alloc_kernel(pmd, address)			\
+	((unlikely(pmd_none(*(pmd))) && __pte_alloc_kernel(pmd, address))? \
+		NULL: pte_offset_kernel(pmd, address))
+
 typedef int (*pte_fn_t)(pte_t *pte, pgtable_t token, unsigned long addr,
 			void *data);
 extern int apply_to_page_range(struct mm_struct *mm, unsigned long address,
 			       unsigned long size, pte_fn_t fn, void *data);
 
+extern int map_user_pages(struct mm_struct *mm, unsigned long addr,
+			  struct page *page, unsigned long nr_pages,
+			  pgprot_t prot);
+extern void unmap_user_pages(struct mm_struct *mm, unsigned long addr,
+			     unsigned long nr_pages);
+extern struct page *pin_user_page(struct mm_struct *mm, unsigned long addr,
+				  bool write);
+extern int migrate_user_page(struct page *page, struct page *newpage);
+
+extern void zap_user_range(struct vm_area_struct *vma, unsigned long start,
+			   unsigned long end);
+extern int copy_page_range(struct vm_area_struct *dst_vma,
+			   struct vm_area_struct *src_vma);
+
+#define FAULT_FLAG_WRITE	0x01	/* Fault was a write access */
+#define FAULT_FLAG_INSTRUCTION	0x02	/* The fault was during an instruction fetch */
+
+extern int handle_mm_fault(struct vm_area_struct *vma, unsigned long addr,
+			   unsigned int flags);
+extern void show_fault_stats(void);
+
 extern unsigned long total_physpages;
 
 extern unsigned long nr_managed_pages(void);
@@ -187,6 +299,10 @@ extern unsigned long nr_free_pages(void);
 extern unsigned long nr_zone_percpu_cache_pages(struct zone *zone);
 extern unsigned long nr_percpu_cache_pages(int cpu);
 
+extern bool prezero_idle(void);
+extern bool deferred_init_idle(void);
+extern void show_page_alloc_stats(void);
+
 static inline void mm_pgtables_bytes_init(struct mm_struct *mm)
 {
 	atomic_long_set(&mm->pgtables_bytes, 0);
@@ -237,6 +353,7 @@ static inline void mm_dec_nr_p4ds(struct mm_struct *mm)
 	atomic_long_sub(PTRS_PER_P4D * sizeof(p4d_t), &mm->pgtables_bytes);
 }
 
+extern void unmap_kernel_range_noflush(unsigned long addr, unsigned long size);
 extern void unmap_kernel_range(unsigned long addr, unsigned long size);
 extern void free_initmem(void);
 
@@ -8,6 +8,7 @@
 #include <base/atomic.h>
 #include <base/log2.h>
 #include <base/list.h>
+#include <base/rbtree.h>
 
 #include <rtochius/spinlock.h>
 
@@ -66,6 +67,9 @@ struct page {
 #define STRUCT_PAGE_MAX_SHIFT	(order_base_2(sizeof(struct page)))
 
 struct mm_struct {
+	struct rb_root mm_rb;		/* VMAs, sorted by address */
+	rwlock_t mmap_lock;		/* Protects mm_rb and the VMAs */
+
 	pgd_t *pgd;
 	/* Architecture-specific MM context */
 	mm_context_t context;
@@ -210,7 +214,13 @@ static inline bool mm_tlb_flush_nested(struct mm_struct *mm)
 }
 
 struct vm_area_struct {
+	unsigned long vm_start;		/* Our start address within vm_mm. */
+	unsigned long vm_end;		/* The first byte after our end address
+					   within vm_mm. */
+	struct rb_node vm_rb;		/* Linked into vm_mm->mm_rb. */
+
 	struct mm_struct *vm_mm;	/* The address space we belong to. */
+	pgprot_t vm_page_prot;		/* Access permissions of this VMA. */
 	unsigned long vm_flags;		/* Flags, see mm.h. */
 };
 
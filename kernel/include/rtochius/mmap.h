@@ -5,6 +5,14 @@
 
 #include <asm/pgtable-types.h>
 
+struct mm_struct;
+struct vm_area_struct;
+
 extern pgprot_t vm_get_page_prot(unsigned long vm_flags);
 
+extern struct vm_area_struct *find_vma(struct mm_struct *mm,
+				       unsigned long addr);
+extern int dup_mmap(struct mm_struct *mm, struct mm_struct *oldmm);
+extern void exit_mmap(struct mm_struct *mm);
+
 #endif /* !__RTOCHIUS_MMAP_H_ */
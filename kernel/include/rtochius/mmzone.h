@@ -34,8 +34,15 @@ struct free_area {
 	unsigned long		nr_free;
 };
 
+/*
+ * Blocks up to PAGE_ALLOC_COSTLY_ORDER are cached on per-cpu lists, one
+ * list per order. Anything larger always goes through zone->lock.
+ */
+#define PAGE_ALLOC_COSTLY_ORDER	3
+#define NR_PCP_ORDERS		(PAGE_ALLOC_COSTLY_ORDER + 1)
+
 struct per_cpu_pages {
-	int count;		/* number of pages in the list */
+	int count;		/* number of blocks in the list */
 	int high;		/* high watermark, emptying needed */
 	int batch;		/* chunk size for buddy add/remove */
 
@@ -43,7 +50,18 @@ struct per_cpu_pages {
 };
 
 struct per_cpu_pageset {
-	struct per_cpu_pages pcp;
+	/*
+	 * Only ever contended by a remote drain, the owning CPU takes it
+	 * with interrupts off around every use of the lists below.
+	 */
+	spinlock_t lock;
+
+	struct per_cpu_pages pcp[NR_PCP_ORDERS];
+
+	/* Free order-0 pages already cleared from the idle loop: */
+	int zero_count;
+	int zero_high;
+	struct list_head zero_list;
 };
 
 struct zone {
@@ -52,8 +70,12 @@ struct zone {
 
 	/* zone_start_pfn == zone_start_paddr >> PAGE_SHIFT */
 	unsigned long		zone_start_pfn;
+	/* Pages from zone_start_pfn to the end, holes included: */
+	unsigned long		spanned_pages;
 
 	atomic_long_t		managed_pages;
+	/* Managed pages whose struct page is not initialised yet: */
+	atomic_long_t		deferred_pages;
 
 	const char		*name;
 
@@ -86,6 +108,11 @@ static inline unsigned long zone_managed_pages(struct zone *zone)
 	return (unsigned long)atomic_long_read(&zone->managed_pages);
 }
 
+static inline unsigned long zone_end_pfn(const struct zone *zone)
+{
+	return zone->zone_start_pfn + zone->spanned_pages;
+}
+
 #define for_each_order(order) \
 	for (order = 0; order < MAX_ORDER; order++)
 
@@ -13,6 +13,7 @@ enum pageflags {
 	PG_slab,
 	PG_active,
 	PG_arch_1,
+	PG_movable,		/* User page compaction may migrate */
 	__NR_PAGEFLAGS,
 };
 
@@ -138,6 +139,9 @@ __PAGEFLAG(Slab, slab, PF_NO_TAIL)
 PAGEFLAG(Active, active, PF_HEAD) __CLEARPAGEFLAG(Active, active, PF_HEAD)
 	TESTCLEARFLAG(Active, active, PF_HEAD)
 
+PAGEFLAG(Movable, movable, PF_NO_TAIL)
+	TESTCLEARFLAG(Movable, movable, PF_NO_TAIL)
+
 static __always_inline void set_compound_head(struct page *page, struct page *head)
 {
 	WRITE_ONCE(page->compound_head, (unsigned long)head + 1);
@@ -2,11 +2,33 @@
 #ifndef __RTOCHIUS_PERCPU_H_
 #define __RTOCHIUS_PERCPU_H_
 
+#include <base/types.h>
+#include <base/sizes.h>
+
 #include <rtochius/preempt.h>
 #include <rtochius/cpumask.h>
 
 #include <asm/percpu.h>
 
+/* minimum unit size, also is the maximum supported allocation size */
+#define PCPU_MIN_UNIT_SIZE		SZ_32K
+
+/*
+ * Room left in the first chunk after the static section. Everything
+ * allocated before vmalloc is up, the slab caches of the boot in
+ * particular, has to fit in there.
+ */
+#define PERCPU_DYNAMIC_RESERVE		SZ_32K
+
 extern void setup_per_cpu_areas(void);
 
+extern void __percpu *__alloc_percpu(size_t size, size_t align);
+extern void free_percpu(void __percpu *__pdata);
+
+#define alloc_percpu(type)						\
+	(typeof(type) __percpu *)__alloc_percpu(sizeof(type),		\
+						__alignof__(type))
+
+extern void show_percpu_stats(void);
+
 #endif /* !__RTOCHIUS_PERCPU_H_ */
@@ -7,6 +7,9 @@
 #include <uapi/rtochius/sched.h>
 
 #include <rtochius/spinlock.h>
+#include <rtochius/cpumask.h>
+#include <rtochius/ipc.h>
+#include <rtochius/sched/prio.h>
 #include <rtochius/sched/debug.h>
 
 #include <asm/current.h>
@@ -127,6 +130,7 @@
 	} while (0)
 
 struct mm_struct;
+struct prio_array;
 
 /* Task command name length: */
 #define TASK_COMM_LEN			16
@@ -150,10 +154,23 @@ struct task_struct {
 
 	/* Current CPU: */
 	unsigned int			cpu;
+	int				on_cpu;
+	int				on_rq;
+
+	int				prio;
+	int				static_prio;
+	unsigned int			policy;
+
+	/* Remaining ticks, refilled from static_prio on expiry: */
+	unsigned int			time_slice;
+	struct list_head		run_list;
+	struct prio_array		*array;
 
 	int				nr_cpus_allowed;
+	cpumask_t			cpus_allowed;
 
 	struct mm_struct		*mm;
+	struct mm_struct		*active_mm;
 
 	int				exit_state;
 	int				exit_code;
@@ -197,6 +214,9 @@ struct task_struct {
 
 	int				pagefault_disabled;
 
+	/* Synchronous IPC state: */
+	struct ipc_thread		ipc;
+
 	/* CPU-specific state of this task: */
 	struct thread_struct		thread;
 };
@@ -246,6 +266,7 @@ static inline char task_state_to_char(struct task_struct *tsk)
  */
 #define PF_IDLE				0x00000002	/* I am an IDLE thread */
 #define PF_EXITING			0x00000004	/* Getting shut down */
+#define PF_DRIVER			0x00000080	/* I drive hardware, may bind interrupts */
 #define PF_SIGNALED			0x00000400	/* Killed by a signal */
 #define PF_MEMALLOC			0x00000800	/* Allocating memory */
 #define PF_FROZEN			0x00010000	/* Frozen for system suspend */
@@ -343,6 +364,42 @@ static inline unsigned int task_cpu(const struct task_struct *p)
 
 extern void set_task_cpu(struct task_struct *p, unsigned int cpu);
 
+static inline int task_on_rq_queued(struct task_struct *p)
+{
+	return p->on_rq;
+}
+
+static inline int rt_prio(int prio)
+{
+	return unlikely(prio < MAX_RT_PRIO);
+}
+
+static inline int rt_task(struct task_struct *p)
+{
+	return rt_prio(p->prio);
+}
+
+extern void scheduler_tick(void);
+extern void scheduler_ipi(void);
+extern bool sched_can_stop_tick(void);
+
+extern asmlinkage void schedule(void);
+extern void schedule_idle(void);
+extern void schedule_preempt_disabled(void);
+extern void schedule_direct(struct task_struct *next);
+extern void yield(void);
+
+extern void init_idle(struct task_struct *idle, int cpu);
+extern void __noreturn do_task_dead(void);
+extern int idle_cpu(int cpu);
+extern struct task_struct *idle_task(int cpu);
+
+extern int sched_fork(unsigned long clone_flags, struct task_struct *p);
+extern void wake_up_new_task(struct task_struct *tsk);
+extern int wake_up_state(struct task_struct *tsk, unsigned int state);
 extern int wake_up_process(struct task_struct *tsk);
 
+extern unsigned long nr_running(void);
+extern u64 nr_context_switches(void);
+
 #endif /* !__RTOCHIUS_SCHED_H_ */
@@ -16,4 +16,6 @@ extern int in_sched_functions(unsigned long addr);
 
 extern void show_regs(struct pt_regs *);
 
+extern void show_sched_balance_stats(void);
+
 #endif /* !__RTOCHIUS_SCHED_DEBUG_H_ */
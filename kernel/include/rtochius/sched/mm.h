@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __RTOCHIUS_SCHED_MM_H_
+#define __RTOCHIUS_SCHED_MM_H_
+
+struct mm_struct;
+
+extern struct mm_struct *mm_alloc(void);
+
+#endif /* !__RTOCHIUS_SCHED_MM_H_ */
@@ -13,6 +13,10 @@ extern asmlinkage __visible void __sched preempt_schedule_irq(void);
 extern int copy_thread(unsigned long, unsigned long, unsigned long,
 			struct task_struct *);
 
+extern long _do_fork(unsigned long, unsigned long, unsigned long);
+extern pid_t kernel_thread(int (*fn)(void *), void *arg, unsigned long flags);
+extern struct task_struct *fork_idle(int);
+
 /* Architectures that haven't opted into copy_thread_tls get the tls argument
  * via pt_regs, so ignore the tls argument passed via C. */
 static inline int copy_thread_tls(
@@ -14,12 +14,66 @@
 
 struct page;
 
+/*
+ * A magazine is a stack of free objects. Sized so that the whole thing
+ * is 256 bytes.
+ */
+#define SLAB_MAG_SIZE		30
+
+struct slab_magazine {
+	struct slab_magazine *next;	/* In the depot */
+	unsigned int size;		/* Objects in the magazine */
+	void *objects[SLAB_MAG_SIZE];
+};
+
+/*
+ * The magazines of a cache which are not loaded on any cpu.
+ */
+struct slab_depot {
+	spinlock_t lock;
+	struct slab_magazine *full;
+	struct slab_magazine *empty;
+	unsigned int nr_full;
+	unsigned int nr_empty;
+};
+
+/*
+ * Per cpu event counters. The fast path ones are bumped with interrupts
+ * enabled and may lose an update now and then.
+ */
+enum stat_item {
+	ALLOC_FASTPATH,		/* Allocation from the cpu freelist */
+	ALLOC_SLOWPATH,		/* Allocation through __slab_alloc() */
+	ALLOC_BULK,		/* Objects from kmem_cache_alloc_bulk() */
+	ALLOC_REFILL,		/* Cpu freelist refilled from the cpu slab */
+	ALLOC_PARTIAL,		/* Cpu slab taken from the partial list */
+	ALLOC_SLAB,		/* Cpu slab newly allocated */
+	FREE_FASTPATH,		/* Free to the cpu freelist */
+	FREE_REMOTE,		/* Free of an object not in the cpu slab */
+	FREE_BULK,		/* Objects to kmem_cache_free_bulk() */
+	ALLOC_MAG_HIT,		/* Allocation from a loaded magazine */
+	ALLOC_MAG_DEPOT,	/* Allocation after a trip to the depot */
+	ALLOC_MAG_MISS,		/* No magazine had objects */
+	FREE_MAG_HIT,		/* Free to a loaded magazine */
+	FREE_MAG_DEPOT,		/* Free after a trip to the depot */
+	FREE_MAG_MISS,		/* Free to the slab page */
+	NR_SLUB_STAT_ITEMS
+};
+
+/*
+ * freelist and tid are updated together with cmpxchg_double(), so they
+ * must stay adjacent and the pair 16 byte aligned.
+ */
 struct kmem_cache_cpu {
-	void **freelist;
+	void **freelist;	/* Pointer to next available object */
+	unsigned long tid;	/* Globally unique transaction id */
 	struct page *page;
 	unsigned int offset;
 	unsigned int objsize;
-};
+	struct slab_magazine *loaded;	/* Magazine used first */
+	struct slab_magazine *prev;	/* Full or empty, swapped with loaded */
+	unsigned long stat[NR_SLUB_STAT_ITEMS];
+} __aligned(2 * sizeof(void *));
 
 struct kmem_cache_node {
 	spinlock_t list_lock;	/* Protect partial list and nr_partial */
@@ -53,8 +107,9 @@ struct kmem_cache {
 	int align;		/* Alignment */
 	const char *name;	/* Name (only for display!) */
 	struct list_head list;	/* List of slab caches */
+	struct slab_depot depot;
 
-	struct kmem_cache_cpu *cpu_slab[NR_CPUS];
+	struct kmem_cache_cpu __percpu *cpu_slab;
 };
 
 #if defined(ARCH_DMA_MINALIGN) && ARCH_DMA_MINALIGN > 8
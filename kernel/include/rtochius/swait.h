@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __RTOCHIUS_SWAIT_H_
+#define __RTOCHIUS_SWAIT_H_
+
+#include <base/list.h>
+
+#include <rtochius/spinlock.h>
+
+/*
+ * Simple wait queues
+ *
+ * A wait queue head with a raw lock and a plain list of waiting tasks,
+ * no custom wake functions and no wake flags. Waiters are exclusive:
+ * swake_up_one() wakes the oldest one, swake_up_all() all of them.
+ */
+
+struct task_struct;
+
+struct swait_queue_head {
+	raw_spinlock_t		lock;
+	struct list_head	task_list;
+};
+
+struct swait_queue {
+	struct task_struct	*task;
+	struct list_head	task_list;
+};
+
+#define __SWAITQUEUE_INITIALIZER(name) {				\
+	.task		= current,					\
+	.task_list	= LIST_HEAD_INIT((name).task_list),		\
+}
+
+#define DECLARE_SWAITQUEUE(name)					\
+	struct swait_queue name = __SWAITQUEUE_INITIALIZER(name)
+
+#define __SWAIT_QUEUE_HEAD_INITIALIZER(name) {				\
+	.lock		= __RAW_SPIN_LOCK_UNLOCKED(name.lock),		\
+	.task_list	= LIST_HEAD_INIT((name).task_list),		\
+}
+
+#define DECLARE_SWAIT_QUEUE_HEAD(name)					\
+	struct swait_queue_head name = __SWAIT_QUEUE_HEAD_INITIALIZER(name)
+
+static inline void init_swait_queue_head(struct swait_queue_head *q)
+{
+	raw_spin_lock_init(&q->lock);
+	INIT_LIST_HEAD(&q->task_list);
+}
+
+/*
+ * The lockless check pairs with the smp_mb() implied by set_current_state()
+ * in prepare_to_swait_exclusive(), the waker must have published its
+ * condition with a full barrier too.
+ */
+static inline bool swq_has_sleeper(struct swait_queue_head *wq)
+{
+	smp_mb();
+	return !list_empty(&wq->task_list);
+}
+
+extern void swake_up_locked(struct swait_queue_head *q);
+extern void swake_up_one(struct swait_queue_head *q);
+extern void swake_up_all(struct swait_queue_head *q);
+
+extern void prepare_to_swait_exclusive(struct swait_queue_head *q,
+				       struct swait_queue *wait, int state);
+extern void finish_swait(struct swait_queue_head *q, struct swait_queue *wait);
+
+#endif /* !__RTOCHIUS_SWAIT_H_ */
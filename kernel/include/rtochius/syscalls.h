@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * syscalls.h - system call prototypes
+ *
+ * Every system call takes the saved user registers and picks its
+ * arguments from x0-x7 itself.
+ */
+#ifndef __RTOCHIUS_SYSCALLS_H_
+#define __RTOCHIUS_SYSCALLS_H_
+
+#include <base/linkage.h>
+
+struct pt_regs;
+
+asmlinkage long sys_ni_syscall(struct pt_regs *regs);
+
+asmlinkage long sys_sched_yield(struct pt_regs *regs);
+
+asmlinkage long sys_ipc_endpoint_create(struct pt_regs *regs);
+asmlinkage long sys_ipc_endpoint_share(struct pt_regs *regs);
+asmlinkage long sys_ipc_endpoint_destroy(struct pt_regs *regs);
+asmlinkage long sys_ipc_call(struct pt_regs *regs);
+asmlinkage long sys_ipc_reply_wait(struct pt_regs *regs);
+
+asmlinkage long sys_channel_create(struct pt_regs *regs);
+asmlinkage long sys_channel_share(struct pt_regs *regs);
+asmlinkage long sys_channel_map(struct pt_regs *regs);
+asmlinkage long sys_channel_wait(struct pt_regs *regs);
+asmlinkage long sys_channel_notify(struct pt_regs *regs);
+
+asmlinkage long sys_notification_create(struct pt_regs *regs);
+asmlinkage long sys_notification_share(struct pt_regs *regs);
+asmlinkage long sys_notification_signal(struct pt_regs *regs);
+asmlinkage long sys_notification_wait(struct pt_regs *regs);
+asmlinkage long sys_irq_bind(struct pt_regs *regs);
+asmlinkage long sys_irq_ack(struct pt_regs *regs);
+asmlinkage long sys_irq_unbind(struct pt_regs *regs);
+
+asmlinkage long sys_grant_create(struct pt_regs *regs);
+asmlinkage long sys_grant_map(struct pt_regs *regs);
+asmlinkage long sys_grant_unmap(struct pt_regs *regs);
+asmlinkage long sys_grant_revoke(struct pt_regs *regs);
+
+asmlinkage long sys_sysring_setup(struct pt_regs *regs);
+asmlinkage long sys_sysring_enter(struct pt_regs *regs);
+
+asmlinkage long sys_show_stats(struct pt_regs *regs);
+
+asmlinkage long sys_dma_alloc(struct pt_regs *regs);
+asmlinkage long sys_dma_free(struct pt_regs *regs);
+
+asmlinkage long sys_compact_memory(struct pt_regs *regs);
+
+asmlinkage long sys_mmap(struct pt_regs *regs);
+asmlinkage long sys_munmap(struct pt_regs *regs);
+
+#endif /* !__RTOCHIUS_SYSCALLS_H_ */
@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __RTOCHIUS_SYSRING_H_
+#define __RTOCHIUS_SYSRING_H_
+
+#include <base/types.h>
+
+struct mm_struct;
+
+#include <uapi/rtochius/sysring.h>
+
+extern bool sysring_idle_poll(void);
+extern void sysring_idle_exit(void);
+extern void sysring_release_mm(struct mm_struct *mm);
+
+#endif /* !__RTOCHIUS_SYSRING_H_ */
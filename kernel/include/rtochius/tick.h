@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Tick related global functions
+ */
+#ifndef __RTOCHIUS_TICK_H_
+#define __RTOCHIUS_TICK_H_
+
+#include <base/types.h>
+
+#include <rtochius/cpumask.h>
+
+struct tick_sched {
+	/* Absolute CNTVCT value the next tick is programmed for: */
+	u64				next_tick;
+	/* CNTVCT value at the moment the tick was stopped: */
+	u64				stop_tick;
+	int				tick_stopped;
+	int				inidle;
+
+	unsigned long			ticks_taken;
+	unsigned long			ticks_suppressed;
+	unsigned long			idle_calls;
+	unsigned long			idle_sleeps;
+};
+
+extern void __init tick_init(void);
+extern void tick_setup_cpu(unsigned int cpu);
+extern void tick_handle_periodic(void);
+
+extern void tick_get_stats(int cpu, unsigned long *taken,
+			   unsigned long *suppressed);
+extern void show_tick_stats(void);
+
+#ifdef CONFIG_NO_HZ_COMMON
+extern void tick_nohz_idle_enter(void);
+extern void tick_nohz_idle_exit(void);
+#else
+static inline void tick_nohz_idle_enter(void) { }
+static inline void tick_nohz_idle_exit(void) { }
+#endif /* !CONFIG_NO_HZ_COMMON */
+
+#ifdef CONFIG_NO_HZ_FULL
+extern bool tick_nohz_full_running;
+extern cpumask_var_t tick_nohz_full_mask;
+
+static inline bool tick_nohz_full_enabled(void)
+{
+	return tick_nohz_full_running;
+}
+
+static inline bool tick_nohz_full_cpu(int cpu)
+{
+	if (!tick_nohz_full_enabled())
+		return false;
+
+	return cpumask_test_cpu(cpu, tick_nohz_full_mask);
+}
+
+extern void tick_nohz_full_kick_cpu(int cpu);
+extern void tick_nohz_full_check(void);
+#else
+static inline bool tick_nohz_full_enabled(void) { return false; }
+static inline bool tick_nohz_full_cpu(int cpu) { return false; }
+static inline void tick_nohz_full_kick_cpu(int cpu) { }
+static inline void tick_nohz_full_check(void) { }
+#endif /* !CONFIG_NO_HZ_FULL */
+
+#endif /* !__RTOCHIUS_TICK_H_ */
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __RTOCHIUS_VMALLOC_H_
+#define __RTOCHIUS_VMALLOC_H_
+
+#include <base/types.h>
+
+#include <asm/memory.h>
+#include <asm/pgtable-types.h>
+
+struct page;
+
+/* bits in flags of vm_struct: */
+#define VM_ALLOC		0x00000001	/* vmalloc() */
+#define VM_MAP			0x00000002	/* vmap()ed pages */
+#define VM_HUGE			0x00000004	/* mapped with PMD blocks */
+
+struct vm_struct {
+	void			*addr;
+	/* Bytes mapped at addr, the guard page is not included: */
+	unsigned long		size;
+	unsigned long		flags;
+	struct page		**pages;
+	unsigned int		nr_pages;
+};
+
+extern void *vmalloc(unsigned long size);
+extern void *vzalloc(unsigned long size);
+extern void vfree(const void *addr);
+
+extern void *vmap(struct page **pages, unsigned int count, pgprot_t prot);
+extern void vunmap(const void *addr);
+
+extern struct vm_struct *find_vm_area(const void *addr);
+extern void vm_unmap_aliases(void);
+
+static inline bool is_vmalloc_addr(const void *x)
+{
+	unsigned long addr = (unsigned long)x;
+
+	return addr >= VMALLOC_START && addr < VMALLOC_END;
+}
+
+extern void vmalloc_init(void);
+
+extern void show_vmalloc_stats(void);
+
+#endif /* !__RTOCHIUS_VMALLOC_H_ */
@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef __UAPI_RTOCHIUS_CHANNEL_H_
+#define __UAPI_RTOCHIUS_CHANNEL_H_
+
+/*
+ * Shared-memory ring channels.
+ *
+ * A channel is a struct ring_hdr (see <base/ring.h>) followed by its
+ * slots, in pages which the kernel owns and maps into every address
+ * space that asks for it with channel_map. Data moves through the
+ * ring without system calls; channel_wait and channel_notify are only
+ * needed to sleep on an empty or full ring and to end such a sleep.
+ *
+ * channel_map is open to the creator and to the tasks it named with
+ * channel_share, others get -EPERM. A CHANNEL_PUBLIC ring, such as the
+ * request ring of a server, may be mapped by anyone.
+ */
+
+/* channel_create flags */
+#define CHANNEL_MP		0x1	/* several producers, RING_F_MP */
+#define CHANNEL_PUBLIC		0x2	/* any task may map the ring */
+
+/* channel_wait and channel_notify: what to wait for or signal */
+#define CHANNEL_DATA		0	/* ring no longer empty */
+#define CHANNEL_SPACE		1	/* ring no longer full */
+
+/* Limits of channel_create */
+#define CHANNEL_MAX_SLOTS	4096
+#define CHANNEL_MAX_SLOT_SIZE	4096
+#define CHANNEL_MAX_BYTES	(4UL << 20)	/* header and slots */
+
+/* Tasks a channel can be shared with besides its creator */
+#define CHANNEL_MAX_PEERS	16
+
+#endif /* !__UAPI_RTOCHIUS_CHANNEL_H_ */
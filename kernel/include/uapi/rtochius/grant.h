@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef __UAPI_RTOCHIUS_GRANT_H_
+#define __UAPI_RTOCHIUS_GRANT_H_
+
+/*
+ * Page grants.
+ *
+ * grant_create turns a range of the caller's own pages into a grant id
+ * for one receiving task, named by its pid, and the id can then be
+ * passed to it, for instance in an IPC message. The receiver maps the
+ * very same physical pages with grant_map, nothing is copied. Any other
+ * task gets -EPERM from grant_map and grant_unmap.
+ *
+ * A lent grant stays with its owner: the receiver can map it, unmap it
+ * again with grant_unmap, and the owner ends it with grant_revoke, which
+ * also takes the pages away from the receiver. A transferred grant
+ * (GRANT_TRANSFER) is unmapped from the owner right away and belongs to
+ * the receiver once mapped.
+ */
+
+/* grant_create flags */
+#define GRANT_WRITE		0x1	/* receiver may write */
+#define GRANT_TRANSFER		0x2	/* move the pages instead of lending them */
+
+#define GRANT_MAX_PAGES		1024
+
+#endif /* !__UAPI_RTOCHIUS_GRANT_H_ */
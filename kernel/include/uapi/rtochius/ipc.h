@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef __UAPI_RTOCHIUS_IPC_H_
+#define __UAPI_RTOCHIUS_IPC_H_
+
+/*
+ * Synchronous IPC messages travel in registers:
+ *
+ *   x0		endpoint id on entry, sender pid or -errno on return
+ *   x1		message tag, see IPC_TAG()
+ *   x2 - x7	message registers MR0 - MR5
+ *
+ * Only the first IPC_TAG_LEN(tag) message registers are transferred.
+ *
+ * Only the creator of an endpoint may wait on it for callers or destroy
+ * it. ipc_call is open to the creator and to the tasks it named with
+ * ipc_endpoint_share, others get -EPERM, unless the endpoint was created
+ * IPC_ENDPOINT_PUBLIC.
+ */
+#define IPC_MSG_REGS		6
+
+#define IPC_TAG_LEN_BITS	4
+#define IPC_TAG_LEN_MASK	((1UL << IPC_TAG_LEN_BITS) - 1)
+
+#define IPC_TAG(label, len)	\
+	(((unsigned long)(label) << IPC_TAG_LEN_BITS) | ((len) & IPC_TAG_LEN_MASK))
+#define IPC_TAG_LABEL(tag)	((unsigned long)(tag) >> IPC_TAG_LEN_BITS)
+#define IPC_TAG_LEN(tag)	((unsigned long)(tag) & IPC_TAG_LEN_MASK)
+
+/* ipc_endpoint_create flags */
+#define IPC_ENDPOINT_PUBLIC	0x1	/* any task may call */
+
+/* Tasks an endpoint can be shared with besides its creator */
+#define IPC_ENDPOINT_MAX_PEERS	16
+
+#endif /* !__UAPI_RTOCHIUS_IPC_H_ */
@@ -14,4 +14,14 @@
 
 #define VM_IOREMAP  	0x00000010
 
+/* prot of mmap(), the same bits as the VM_ flags: */
+#define PROT_NONE	0x0
+#define PROT_READ	0x1
+#define PROT_WRITE	0x2
+#define PROT_EXEC	0x4
+
+/* flags of mmap(), one of them: */
+#define MAP_SHARED	0x01	/* stays shared with a duplicated address space */
+#define MAP_PRIVATE	0x02	/* copy-on-write once duplicated */
+
 #endif /* !__UAPI_RTOCHIUS_MMAP_H_ */
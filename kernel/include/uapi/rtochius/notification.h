@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef __UAPI_RTOCHIUS_NOTIFICATION_H_
+#define __UAPI_RTOCHIUS_NOTIFICATION_H_
+
+/*
+ * Notification objects.
+ *
+ * A notification is a word of NOTIFICATION_BITS pending bits. Senders
+ * OR bits in with notification_signal, or have an interrupt line do it
+ * with irq_bind. notification_wait returns every bit that became
+ * pending since the last call and clears them, so any number of signals
+ * between two waits costs the waiter a single wakeup.
+ *
+ * A bound interrupt line is masked each time it fires, until the driver
+ * acknowledges it with irq_ack. irq_unbind releases the line again. Only
+ * tasks the system started as drivers may bind lines, and not those the
+ * kernel handles itself.
+ *
+ * Only the task that created a notification may wait on it or bind
+ * interrupts to it. Besides the creator, only the tasks it named with
+ * notification_share may signal it; others get -EPERM.
+ */
+#define NOTIFICATION_BITS	32
+#define NOTIFICATION_MAX_PEERS	8
+
+/* notification_wait flags */
+#define NOTIFICATION_NONBLOCK	0x1	/* return 0 instead of sleeping */
+
+#endif /* !__UAPI_RTOCHIUS_NOTIFICATION_H_ */
@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef __UAPI_RTOCHIUS_STATS_H_
+#define __UAPI_RTOCHIUS_STATS_H_
+
+/*
+ * Kernel statistics.
+ *
+ * show_stats prints the counters of the subsystems selected by a mask
+ * of the bits below on the kernel console. The counters are per cpu and
+ * summed up at the time of the call.
+ */
+#define STATS_SCHED		(1U << 0)
+#define STATS_TICK		(1U << 1)
+#define STATS_IPC		(1U << 2)
+#define STATS_NOTIFICATION	(1U << 3)
+#define STATS_GRANT		(1U << 4)
+#define STATS_SYSRING		(1U << 5)
+#define STATS_FPSIMD		(1U << 6)
+#define STATS_SLAB		(1U << 7)
+#define STATS_PAGE_ALLOC	(1U << 8)
+#define STATS_CMA		(1U << 9)
+#define STATS_COMPACT		(1U << 10)
+#define STATS_VMALLOC		(1U << 11)
+#define STATS_PERCPU		(1U << 12)
+#define STATS_FAULT		(1U << 13)
+
+#define STATS_ALL		(~0U)
+
+#endif /* !__UAPI_RTOCHIUS_STATS_H_ */
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef __UAPI_RTOCHIUS_SYSRING_H_
+#define __UAPI_RTOCHIUS_SYSRING_H_
+
+/*
+ * Batched system call submission.
+ *
+ * A sysring is a submission queue (SQ) of system calls and a completion
+ * queue (CQ) of their results. Both are single producer <base/ring.h>
+ * rings in one shared area, which sysring_setup maps at a page aligned
+ * address picked by the caller. The process queues any number of calls
+ * and submits them all with one sysring_enter. With SYSRING_SQPOLL,
+ * idle CPUs drain the SQ themselves and sysring_enter is only needed
+ * when the kernel has set SYSRING_SQ_NEED_WAKEUP.
+ *
+ * Only calls which never block may be queued, any other opcode
+ * completes with -EINVAL.
+ */
+
+struct sysring_sqe {
+	unsigned int		opcode;		/* __NR_* */
+	unsigned int		flags;		/* must be 0 */
+	unsigned long		user_data;	/* copied to the cqe */
+	unsigned long		args[6];	/* x0 - x5 */
+};
+
+struct sysring_cqe {
+	unsigned long		user_data;
+	long			res;		/* the call's x0 */
+};
+
+/* At the start of the shared area, the rings follow at the offsets. */
+struct sysring_params {
+	unsigned int		sq_off;
+	unsigned int		cq_off;
+	unsigned int		flags;		/* SYSRING_SQ_*, set by the kernel */
+};
+
+/* sysring_setup flags */
+#define SYSRING_SQPOLL		0x1
+
+/* sysring_params flags */
+#define SYSRING_SQ_NEED_WAKEUP	0x1	/* pollers sleep, sysring_enter */
+
+#define SYSRING_MAX_ENTRIES	1024
+
+#endif /* !__UAPI_RTOCHIUS_SYSRING_H_ */
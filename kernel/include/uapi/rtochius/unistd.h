@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * System call numbers, passed in x8.
+ *
+ * This file may be included more than once, with __SYSCALL defined to
+ * generate the system call table.
+ */
+#ifndef __SYSCALL
+#define __SYSCALL(x, y)
+#endif
+
+/*
+ * The hot calls come first: everything below __NR_fast_syscalls in
+ * asm/unistd.h takes the trimmed entry path.
+ */
+#define __NR_ipc_call			0
+__SYSCALL(__NR_ipc_call, sys_ipc_call)
+#define __NR_ipc_reply_wait		1
+__SYSCALL(__NR_ipc_reply_wait, sys_ipc_reply_wait)
+#define __NR_sched_yield		2
+__SYSCALL(__NR_sched_yield, sys_sched_yield)
+
+#define __NR_ipc_endpoint_create	3
+__SYSCALL(__NR_ipc_endpoint_create, sys_ipc_endpoint_create)
+#define __NR_ipc_endpoint_destroy	4
+__SYSCALL(__NR_ipc_endpoint_destroy, sys_ipc_endpoint_destroy)
+
+#define __NR_channel_create		5
+__SYSCALL(__NR_channel_create, sys_channel_create)
+#define __NR_channel_map		6
+__SYSCALL(__NR_channel_map, sys_channel_map)
+#define __NR_channel_wait		7
+__SYSCALL(__NR_channel_wait, sys_channel_wait)
+#define __NR_channel_notify		8
+__SYSCALL(__NR_channel_notify, sys_channel_notify)
+
+#define __NR_notification_create	9
+__SYSCALL(__NR_notification_create, sys_notification_create)
+#define __NR_notification_signal	10
+__SYSCALL(__NR_notification_signal, sys_notification_signal)
+#define __NR_notification_wait		11
+__SYSCALL(__NR_notification_wait, sys_notification_wait)
+#define __NR_irq_bind			12
+__SYSCALL(__NR_irq_bind, sys_irq_bind)
+#define __NR_irq_ack			13
+__SYSCALL(__NR_irq_ack, sys_irq_ack)
+
+#define __NR_grant_create		14
+__SYSCALL(__NR_grant_create, sys_grant_create)
+#define __NR_grant_map			15
+__SYSCALL(__NR_grant_map, sys_grant_map)
+#define __NR_grant_unmap		16
+__SYSCALL(__NR_grant_unmap, sys_grant_unmap)
+#define __NR_grant_revoke		17
+__SYSCALL(__NR_grant_revoke, sys_grant_revoke)
+
+#define __NR_sysring_setup		18
+__SYSCALL(__NR_sysring_setup, sys_sysring_setup)
+#define __NR_sysring_enter		19
+__SYSCALL(__NR_sysring_enter, sys_sysring_enter)
+
+#define __NR_show_stats			20
+__SYSCALL(__NR_show_stats, sys_show_stats)
+
+#define __NR_dma_alloc			21
+__SYSCALL(__NR_dma_alloc, sys_dma_alloc)
+#define __NR_dma_free			22
+__SYSCALL(__NR_dma_free, sys_dma_free)
+
+#define __NR_compact_memory		23
+__SYSCALL(__NR_compact_memory, sys_compact_memory)
+
+#define __NR_mmap			24
+__SYSCALL(__NR_mmap, sys_mmap)
+#define __NR_munmap			25
+__SYSCALL(__NR_munmap, sys_munmap)
+
+#define __NR_irq_unbind			26
+__SYSCALL(__NR_irq_unbind, sys_irq_unbind)
+#define __NR_notification_share		27
+__SYSCALL(__NR_notification_share, sys_notification_share)
+#define __NR_channel_share		28
+__SYSCALL(__NR_channel_share, sys_channel_share)
+#define __NR_ipc_endpoint_share		29
+__SYSCALL(__NR_ipc_endpoint_share, sys_ipc_endpoint_share)
+
+#undef __NR_syscalls
+#define __NR_syscalls			30
@@ -22,7 +22,19 @@ struct task_struct init_task = {
 	.thread_info	= INIT_THREAD_INFO(init_task),
 	.state		= 0,
 	.stack		= init_stack,
+	.usage		= ATOMIC_INIT(2),
+	.flags		= PF_KTHREAD,
+	.prio		= MAX_PRIO - 20,
+	.static_prio	= MAX_PRIO - 20,
+	.policy		= SCHED_NORMAL,
+	.cpus_allowed	= CPU_MASK_ALL,
+	.nr_cpus_allowed= NR_CPUS,
+	.run_list	= LIST_HEAD_INIT(init_task.run_list),
 	.mm		= &init_mm,
+	.active_mm	= &init_mm,
 	.comm		= INIT_TASK_COMM,
+	.ipc		= {
+		.node	= LIST_HEAD_INIT(init_task.ipc.node),
+	},
 	.thread = INIT_THREAD,
 };
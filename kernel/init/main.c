@@ -17,8 +17,10 @@
 #include <rtochius/uts.h>
 #include <rtochius/slab.h>
 #include <rtochius/mm.h>
+#include <rtochius/vmalloc.h>
 #include <rtochius/sched/init.h>
 #include <rtochius/sched/task_stack.h>
+#include <rtochius/sched/task.h>
 #include <rtochius/smp.h>
 #include <rtochius/cpu.h>
 #include <rtochius/irqflags.h>
@@ -27,6 +29,7 @@
 #include <rtochius/extable.h>
 #include <rtochius/stackprotector.h>
 #include <rtochius/radix-tree.h>
+#include <rtochius/tick.h>
 
 #include <asm/mmu.h>
 
@@ -139,9 +142,36 @@ static __init void mm_init(void)
 	free_area_init_nodes();
 	mem_print_memory_info();
 	kmem_cache_init();
+	vmalloc_init();
 	pgtable_init();
 }
 
+/*
+ * Everything that needs a scheduler to run under: the secondary CPUs
+ * come up here, then the balancer gets to see them.
+ */
+static int __init kernel_init(void *unused)
+{
+	smp_prepare_cpus(nr_cpu_ids);
+	smp_init();
+	sched_init_smp();
+
+	/* There is no init program to hand over to yet. */
+	do_task_dead();
+}
+
+/*
+ * The boot task forks kernel_init and becomes the boot CPU's idle task,
+ * so this outlives the init sections.
+ */
+static noinline void rest_init(void)
+{
+	kernel_thread(kernel_init, NULL, 0);
+
+	schedule_preempt_disabled();
+	cpu_startup_entry(CPUHP_ONLINE);
+}
+
 asmlinkage __visible void __init start_kernel(void)
 {
 	set_task_stack_end_magic(&init_task);
@@ -182,7 +212,11 @@ asmlinkage __visible void __init start_kernel(void)
 		local_irq_disable();
 	radix_tree_init();
 
+	tick_init();
 	call_function_init();
 	WARN(!irqs_disabled(), "Interrupts were enabled early\n");
 
+	local_irq_enable();
+
+	rest_init();
 }
@@ -0,0 +1,35 @@
+#ifndef __LIBRTOCHIUS_CHANNEL_H_
+#define __LIBRTOCHIUS_CHANNEL_H_
+
+#include <base/types.h>
+#include <base/ring.h>
+
+#include <rtochius/channel.h>
+
+/*
+ * A channel as seen from one address space: the kernel id and where the
+ * shared ring is mapped. See <base/ring.h> for the ring protocol, the
+ * functions below add the sleeping and waking on top of it.
+ */
+struct channel {
+	int			id;
+	struct ring_hdr		*ring;
+};
+
+extern int channel_create(unsigned int nr_slots, unsigned int slot_size,
+			  unsigned int flags);
+extern int channel_share(int id, int pid);
+extern int channel_attach(struct channel *ch, int id);
+
+extern void *channel_send_begin(struct channel *ch, u32 *idx);
+extern void channel_send_commit(struct channel *ch, u32 idx);
+
+extern void *channel_recv(struct channel *ch);
+extern void channel_recv_done(struct channel *ch);
+
+static inline void *channel_try_recv(struct channel *ch)
+{
+	return ring_consume_peek(ch->ring);
+}
+
+#endif /* !__LIBRTOCHIUS_CHANNEL_H_ */
@@ -0,0 +1,15 @@
+#ifndef __LIBRTOCHIUS_COMPACTION_H_
+#define __LIBRTOCHIUS_COMPACTION_H_
+
+#include <syscall.h>
+
+/*
+ * Compact every zone of the system. Returns the number of pages moved
+ * or a negative error.
+ */
+static inline long compact_memory(void)
+{
+	return __syscall0(__NR_compact_memory);
+}
+
+#endif /* !__LIBRTOCHIUS_COMPACTION_H_ */
@@ -0,0 +1,22 @@
+#ifndef __LIBRTOCHIUS_DMA_H_
+#define __LIBRTOCHIUS_DMA_H_
+
+#include <syscall.h>
+
+/*
+ * Map @nr_pages of zeroed, physically contiguous memory at the page
+ * aligned @addr. Returns the physical address for the device or a
+ * negative error, -EDQUOT once the task's buffers would exceed the
+ * kernel's per-task limit.
+ */
+static inline long dma_alloc(void *addr, unsigned long nr_pages)
+{
+	return __syscall2(__NR_dma_alloc, nr_pages, (long)addr);
+}
+
+static inline int dma_free(void *addr)
+{
+	return __syscall1(__NR_dma_free, (long)addr);
+}
+
+#endif /* !__LIBRTOCHIUS_DMA_H_ */
@@ -0,0 +1,34 @@
+#ifndef __LIBRTOCHIUS_GRANT_H_
+#define __LIBRTOCHIUS_GRANT_H_
+
+#include <rtochius/grant.h>
+
+#include <syscall.h>
+
+/*
+ * Grant @nr_pages of our memory at @addr to the task @receiver, see
+ * <rtochius/grant.h>.
+ */
+static inline int grant_create(void *addr, unsigned long nr_pages,
+			       unsigned int flags, int receiver)
+{
+	return __syscall4(__NR_grant_create, (long)addr, nr_pages, flags,
+			  receiver);
+}
+
+static inline int grant_map(int id, void *addr)
+{
+	return __syscall2(__NR_grant_map, id, (long)addr);
+}
+
+static inline int grant_unmap(int id)
+{
+	return __syscall1(__NR_grant_unmap, id);
+}
+
+static inline int grant_revoke(int id)
+{
+	return __syscall1(__NR_grant_revoke, id);
+}
+
+#endif /* !__LIBRTOCHIUS_GRANT_H_ */
@@ -0,0 +1,25 @@
+#ifndef __LIBRTOCHIUS_MMAP_H_
+#define __LIBRTOCHIUS_MMAP_H_
+
+#include <base/types.h>
+
+#include <rtochius/mmap.h>
+
+#include <syscall.h>
+
+/*
+ * Map @len bytes of anonymous memory at the page aligned @addr. @prot is
+ * a mask of PROT_*, @flags MAP_PRIVATE or MAP_SHARED. The pages are
+ * allocated on first access and read as zeroes.
+ */
+static inline int mmap(void *addr, size_t len, int prot, int flags)
+{
+	return __syscall4(__NR_mmap, (long)addr, len, prot, flags);
+}
+
+static inline int munmap(void *addr, size_t len)
+{
+	return __syscall2(__NR_munmap, (long)addr, len);
+}
+
+#endif /* !__LIBRTOCHIUS_MMAP_H_ */
@@ -0,0 +1,59 @@
+#ifndef __LIBRTOCHIUS_NOTIFICATION_H_
+#define __LIBRTOCHIUS_NOTIFICATION_H_
+
+#include <base/types.h>
+
+#include <rtochius/notification.h>
+
+#include <syscall.h>
+
+static inline int notification_create(void)
+{
+	return __syscall0(__NR_notification_create);
+}
+
+/* Let the task @pid signal notification @id as well. */
+static inline int notification_share(int id, int pid)
+{
+	return __syscall2(__NR_notification_share, id, pid);
+}
+
+static inline int notification_signal(int id, u32 bits)
+{
+	return __syscall2(__NR_notification_signal, id, bits);
+}
+
+/*
+ * Returns every pending bit, sleeping until there is at least one,
+ * or a negative error.
+ */
+static inline long notification_wait(int id)
+{
+	return __syscall2(__NR_notification_wait, id, 0);
+}
+
+/* Like notification_wait(), but returns 0 when nothing is pending. */
+static inline long notification_poll(int id)
+{
+	return __syscall2(__NR_notification_wait, id, NOTIFICATION_NONBLOCK);
+}
+
+/* Forward interrupt @irq to @bit of notification @id. */
+static inline int irq_bind(unsigned int irq, int id, unsigned int bit)
+{
+	return __syscall3(__NR_irq_bind, irq, id, bit);
+}
+
+/* Unmask @irq once its device has been serviced. */
+static inline int irq_ack(unsigned int irq)
+{
+	return __syscall1(__NR_irq_ack, irq);
+}
+
+/* Stop forwarding @irq and release the line. */
+static inline int irq_unbind(unsigned int irq)
+{
+	return __syscall1(__NR_irq_unbind, irq);
+}
+
+#endif /* !__LIBRTOCHIUS_NOTIFICATION_H_ */
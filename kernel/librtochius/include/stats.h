@@ -0,0 +1,14 @@
+#ifndef __LIBRTOCHIUS_STATS_H_
+#define __LIBRTOCHIUS_STATS_H_
+
+#include <rtochius/stats.h>
+
+#include <syscall.h>
+
+/* Print the kernel counters selected by @mask (STATS_*) on the console. */
+static inline int show_stats(unsigned int mask)
+{
+	return __syscall1(__NR_show_stats, mask);
+}
+
+#endif /* !__LIBRTOCHIUS_STATS_H_ */
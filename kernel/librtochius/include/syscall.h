@@ -0,0 +1,8 @@
+#ifndef __LIBRTOCHIUS_SYSCALL_H_
+#define __LIBRTOCHIUS_SYSCALL_H_
+
+#include <rtochius/unistd.h>
+
+#include <syscall_arch.h>
+
+#endif /* !__LIBRTOCHIUS_SYSCALL_H_ */
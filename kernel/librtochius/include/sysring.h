@@ -0,0 +1,49 @@
+#ifndef __LIBRTOCHIUS_SYSRING_H_
+#define __LIBRTOCHIUS_SYSRING_H_
+
+#include <base/types.h>
+#include <base/ring.h>
+
+#include <rtochius/sysring.h>
+
+/*
+ * A batched system call ring. Calls are queued with sysring_get_sqe()
+ * and sysring_queue(), sysring_submit() hands everything queued so far
+ * to the kernel and results are picked up with sysring_peek_cqe() and
+ * sysring_cqe_done(). One thread at a time may queue calls.
+ */
+struct sysring {
+	int			id;
+	unsigned int		flags;
+	struct sysring_params	*params;
+	struct ring_hdr		*sq;
+	struct ring_hdr		*cq;
+};
+
+extern int sysring_init(struct sysring *sr, unsigned int sq_entries,
+			unsigned int cq_entries, unsigned int flags);
+extern int sysring_submit(struct sysring *sr);
+
+/* A free sqe, or NULL if the SQ is full and wants a sysring_submit(). */
+static inline struct sysring_sqe *sysring_get_sqe(struct sysring *sr,
+						  u32 *idx)
+{
+	return ring_produce_begin(sr->sq, idx);
+}
+
+static inline void sysring_queue(struct sysring *sr, u32 idx)
+{
+	ring_produce_commit(sr->sq, idx);
+}
+
+static inline struct sysring_cqe *sysring_peek_cqe(struct sysring *sr)
+{
+	return ring_consume_peek(sr->cq);
+}
+
+static inline void sysring_cqe_done(struct sysring *sr)
+{
+	ring_consume_release(sr->cq);
+}
+
+#endif /* !__LIBRTOCHIUS_SYSRING_H_ */
@@ -0,0 +1,85 @@
+#include <base/types.h>
+#include <base/errno.h>
+
+#include <channel.h>
+#include <syscall.h>
+
+/*
+ * Rings are mapped one after the other from here on, each in a window
+ * big enough for the largest ring channel_create() accepts.
+ */
+#define CHANNEL_MAP_BASE	0x100000000UL
+#define CHANNEL_MAP_STRIDE	CHANNEL_MAX_BYTES
+
+static unsigned long channel_map_next = CHANNEL_MAP_BASE;
+
+int channel_create(unsigned int nr_slots, unsigned int slot_size,
+		   unsigned int flags)
+{
+	return __syscall3(__NR_channel_create, nr_slots, slot_size, flags);
+}
+
+/* Let the task @pid attach channel @id as well. */
+int channel_share(int id, int pid)
+{
+	return __syscall2(__NR_channel_share, id, pid);
+}
+
+int channel_attach(struct channel *ch, int id)
+{
+	unsigned long addr = channel_map_next;
+	long ret;
+
+	ret = __syscall2(__NR_channel_map, id, addr);
+	if (ret < 0)
+		return ret;
+
+	channel_map_next += CHANNEL_MAP_STRIDE;
+	ch->id = id;
+	ch->ring = (struct ring_hdr *)addr;
+
+	return 0;
+}
+
+/*
+ * Reserve a slot to send, sleeping while the ring is full.
+ */
+void *channel_send_begin(struct channel *ch, u32 *idx)
+{
+	void *slot;
+
+	while (!(slot = ring_produce_begin(ch->ring, idx))) {
+		if (ring_prepare_wait_space(ch->ring))
+			__syscall2(__NR_channel_wait, ch->id, CHANNEL_SPACE);
+	}
+
+	return slot;
+}
+
+void channel_send_commit(struct channel *ch, u32 idx)
+{
+	if (ring_produce_commit(ch->ring, idx))
+		__syscall2(__NR_channel_notify, ch->id, CHANNEL_DATA);
+}
+
+/*
+ * The oldest slot, sleeping while the ring is empty. Give it back with
+ * channel_recv_done() once it has been dealt with.
+ */
+void *channel_recv(struct channel *ch)
+{
+	void *slot;
+
+	while (!(slot = ring_consume_peek(ch->ring))) {
+		if (ring_prepare_wait_data(ch->ring))
+			__syscall2(__NR_channel_wait, ch->id, CHANNEL_DATA);
+	}
+
+	return slot;
+}
+
+void channel_recv_done(struct channel *ch)
+{
+	if (ring_consume_release(ch->ring))
+		__syscall2(__NR_channel_notify, ch->id, CHANNEL_SPACE);
+}
@@ -0,0 +1,59 @@
+#include <base/types.h>
+#include <base/errno.h>
+#include <base/compiler.h>
+
+#include <sysring.h>
+#include <syscall.h>
+
+/*
+ * Rings are mapped one after the other from here on, below the channel
+ * windows, each in a window big enough for the largest ring pair.
+ */
+#define SYSRING_MAP_BASE	0xc0000000UL
+#define SYSRING_MAP_STRIDE	0x40000UL
+
+static unsigned long sysring_map_next = SYSRING_MAP_BASE;
+
+int sysring_init(struct sysring *sr, unsigned int sq_entries,
+		 unsigned int cq_entries, unsigned int flags)
+{
+	unsigned long addr = sysring_map_next;
+	long id;
+
+	id = __syscall4(__NR_sysring_setup, sq_entries, cq_entries, flags,
+			addr);
+	if (id < 0)
+		return id;
+
+	sysring_map_next += SYSRING_MAP_STRIDE;
+	sr->id = id;
+	sr->flags = flags;
+	sr->params = (struct sysring_params *)addr;
+	sr->sq = (struct ring_hdr *)(addr + sr->params->sq_off);
+	sr->cq = (struct ring_hdr *)(addr + sr->params->cq_off);
+
+	return 0;
+}
+
+/*
+ * Get everything queued so far going. Without a poller this is one
+ * sysring_enter for the whole batch; with SYSRING_SQPOLL it only enters
+ * the kernel when no CPU is polling any more.
+ *
+ * Returns the number of calls the kernel took, 0 if a poller will.
+ */
+int sysring_submit(struct sysring *sr)
+{
+	if (ring_empty(sr->sq))
+		return 0;
+
+	/*
+	 * sysring_queue() ends in a full barrier, so either the poller
+	 * sees the new entries or we see it has gone to sleep.
+	 */
+	if ((sr->flags & SYSRING_SQPOLL) &&
+	    !(READ_ONCE(sr->params->flags) & SYSRING_SQ_NEED_WAKEUP))
+		return 0;
+
+	return __syscall1(__NR_sysring_enter, sr->id);
+}
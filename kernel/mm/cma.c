@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Contiguous Memory Allocator
+ *
+ * A CMA area is a range of memory declared reusable in the device tree.
+ * Its pages are handed to the buddy allocator as ZONE_MOVABLE memory
+ * and serve __GFP_MOVABLE allocations like any other, until a large
+ * physically contiguous buffer is wanted: cma_alloc() then evacuates the
+ * per-cpu caches of the zone and takes a free range of the area out of
+ * the buddy lists with alloc_contig_range().
+ *
+ * User pages in the range are migrated out of it on demand. A range that
+ * holds a page which is neither free nor movable, such as a pinned one,
+ * is busy and cma_alloc() moves on to the next one.
+ */
+#define pr_fmt(fmt) "cma: " fmt
+
+#include <base/compiler.h>
+#include <base/common.h>
+#include <base/errno.h>
+#include <base/bitmap.h>
+#include <base/list.h>
+#include <base/sizes.h>
+
+#include <rtochius/cma.h>
+#include <rtochius/sched.h>
+#include <rtochius/mm.h>
+#include <rtochius/gfp.h>
+#include <rtochius/memory.h>
+#include <rtochius/slab.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/syscalls.h>
+#include <rtochius/param.h>
+#include <rtochius/printf.h>
+
+#include <asm/ptrace.h>
+
+struct cma {
+	unsigned long		base_pfn;
+	unsigned long		count;
+	/* One bit per page, set while the page is handed out: */
+	unsigned long		*bitmap;
+	spinlock_t		lock;
+	const char		*name;
+
+	unsigned long		nr_allocs;
+	unsigned long		nr_pages;
+	/* Candidate ranges skipped because a page was in use: */
+	unsigned long		nr_busy;
+	unsigned long		nr_fails;
+};
+
+static struct cma cma_areas[MAX_CMA_AREAS];
+static unsigned int cma_area_count;
+
+struct cma *dma_contiguous_default_area;
+
+/**
+ * cma_declare_contiguous - turn a reserved range into a CMA area
+ * @base: physical base of the range, reserved in memblock
+ * @size: size of the range
+ * @name: name of the area
+ * @res_cma: returns the area
+ *
+ * Called while the reserved-memory nodes are set up. The range is
+ * released from memblock and flagged MEMBLOCK_MOVABLE, so that it ends
+ * up in ZONE_MOVABLE once the buddy allocator takes over.
+ */
+int __init cma_declare_contiguous(phys_addr_t base, phys_addr_t size,
+				  const char *name, struct cma **res_cma)
+{
+	struct cma *cma;
+	phys_addr_t end = base + size;
+	int err;
+
+	if (cma_area_count == ARRAY_SIZE(cma_areas)) {
+		pr_err("Not enough slots for CMA reserved regions!\n");
+		return -ENOSPC;
+	}
+
+	base = PAGE_ALIGN(base);
+	end &= PAGE_MASK;
+	if (base >= end)
+		return -EINVAL;
+
+	err = memblock_free(&memblock_kernel, base, end - base);
+	if (!err)
+		err = memblock_mark_movable(&memblock_kernel, base, end - base);
+	if (err)
+		return err;
+
+	cma = &cma_areas[cma_area_count++];
+	cma->base_pfn = PFN_DOWN(base);
+	cma->count = PFN_DOWN(end - base);
+	cma->name = name;
+	spin_lock_init(&cma->lock);
+
+	*res_cma = cma;
+
+	pr_info("Reserved %lu MiB at %pa for %s\n",
+		(unsigned long)(end - base) / SZ_1M, &base, name);
+
+	return 0;
+}
+
+static int __init cma_init_reserved_areas(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < cma_area_count; i++) {
+		struct cma *cma = &cma_areas[i];
+
+		cma->bitmap = kzalloc(BITS_TO_LONGS(cma->count) * sizeof(long),
+				      GFP_KERNEL);
+		if (!cma->bitmap) {
+			pr_err("%s: no memory for the bitmap\n", cma->name);
+			cma->count = 0;
+		}
+	}
+
+	return 0;
+}
+core_initcall(cma_init_reserved_areas);
+
+static void cma_clear_bitmap(struct cma *cma, unsigned long bitmap_no,
+			     unsigned long count)
+{
+	spin_lock(&cma->lock);
+	bitmap_clear(cma->bitmap, bitmap_no, count);
+	spin_unlock(&cma->lock);
+}
+
+/**
+ * cma_alloc - allocate pages from a CMA area
+ * @cma: the area
+ * @count: number of pages
+ * @align: alignment of the first pfn, as an order
+ *
+ * Returns the first of @count physically contiguous order-0 pages,
+ * each with its own reference, or NULL. May migrate user pages, so the
+ * caller must not hold a spinlock.
+ */
+struct page *cma_alloc(struct cma *cma, unsigned long count, unsigned int align)
+{
+	unsigned long mask, offset, start = 0;
+	unsigned long bitmap_no, pfn;
+	struct page *page = NULL;
+	int ret = -ENOMEM;
+
+	if (!cma || !cma->count || !count)
+		return NULL;
+
+	mask = (1UL << align) - 1;
+	offset = cma->base_pfn & mask;
+
+	for (;;) {
+		spin_lock(&cma->lock);
+		bitmap_no = bitmap_find_next_zero_area_off(cma->bitmap,
+				cma->count, start, count, mask, offset);
+		if (bitmap_no >= cma->count) {
+			spin_unlock(&cma->lock);
+			break;
+		}
+		bitmap_set(cma->bitmap, bitmap_no, count);
+		spin_unlock(&cma->lock);
+
+		pfn = cma->base_pfn + bitmap_no;
+		ret = alloc_contig_range(pfn, pfn + count);
+		if (!ret) {
+			page = pfn_to_page(pfn);
+			break;
+		}
+
+		cma_clear_bitmap(cma, bitmap_no, count);
+		if (ret != -EBUSY)
+			break;
+
+		spin_lock(&cma->lock);
+		cma->nr_busy++;
+		spin_unlock(&cma->lock);
+
+		/* Try again, from the next aligned pfn. */
+		start = bitmap_no + mask + 1;
+	}
+
+	spin_lock(&cma->lock);
+	if (page) {
+		cma->nr_allocs++;
+		cma->nr_pages += count;
+	} else {
+		cma->nr_fails++;
+	}
+	spin_unlock(&cma->lock);
+
+	if (!page)
+		pr_debug("%s: failed to allocate %lu pages: %d\n",
+			 cma->name, count, ret);
+
+	return page;
+}
+
+/**
+ * cma_release - give pages back to a CMA area
+ * @cma: the area
+ * @pages: the first page, as returned by cma_alloc()
+ * @count: number of pages
+ *
+ * Returns false if the pages do not belong to the area.
+ */
+bool cma_release(struct cma *cma, struct page *pages, unsigned long count)
+{
+	unsigned long pfn;
+
+	if (!cma || !pages)
+		return false;
+
+	pfn = page_to_pfn(pages);
+	if (pfn < cma->base_pfn || pfn + count > cma->base_pfn + cma->count)
+		return false;
+
+	free_contig_range(pfn, count);
+	cma_clear_bitmap(cma, pfn - cma->base_pfn, count);
+
+	spin_lock(&cma->lock);
+	cma->nr_pages -= count;
+	spin_unlock(&cma->lock);
+
+	return true;
+}
+
+/*
+ * DMA buffers of user space drivers, found again by their mapping. A
+ * buffer is on the list from the moment its pages are accounted to the
+ * owner, but dma_free and teardown only see it once it is mapped.
+ */
+struct dma_buffer {
+	struct list_head	node;
+	struct mm_struct	*mm;
+	pid_t			owner;
+	bool			mapped;
+	unsigned long		addr;
+	struct page		*pages;
+	unsigned long		nr_pages;
+};
+
+static LIST_HEAD(dma_buffers);
+static DEFINE_SPINLOCK(dma_buffers_lock);
+
+/* The DMA memory a task may hold at once, in pages: */
+#define DMA_MAX_PAGES		(SZ_64M >> PAGE_SHIFT)
+
+/* Called with dma_buffers_lock held. */
+static unsigned long dma_owner_pages(pid_t owner)
+{
+	struct dma_buffer *buf;
+	unsigned long nr = 0;
+
+	list_for_each_entry(buf, &dma_buffers, node) {
+		if (buf->owner == owner)
+			nr += buf->nr_pages;
+	}
+
+	return nr;
+}
+
+static void dma_buffer_destroy(struct dma_buffer *buf)
+{
+	unmap_user_pages(buf->mm, buf->addr, buf->nr_pages);
+	cma_release(dma_contiguous_default_area, buf->pages, buf->nr_pages);
+	kfree(buf);
+}
+
+/*
+ * sys_dma_alloc - map x0 physically contiguous pages at the page aligned
+ * user address x1.
+ *
+ * The buffer comes zeroed from the default CMA area and is aligned to
+ * its own size, up to MAX_ORDER - 1. A task holds at most DMA_MAX_PAGES
+ * in all its buffers together, beyond that the call fails with -EDQUOT.
+ * Returns the physical address for the device, or a negative error.
+ */
+asmlinkage long sys_dma_alloc(struct pt_regs *regs)
+{
+	unsigned long nr_pages = regs->regs[0];
+	unsigned long addr = regs->regs[1];
+	struct mm_struct *mm = current->mm;
+	struct dma_buffer *buf;
+	unsigned long i;
+	int err;
+
+	if (!mm || !nr_pages || nr_pages > DMA_MAX_PAGES ||
+	    !PAGE_ALIGNED(addr) || addr >= TASK_SIZE ||
+	    (nr_pages << PAGE_SHIFT) > TASK_SIZE - addr)
+		return -EINVAL;
+
+	if (!dma_contiguous_default_area)
+		return -ENODEV;
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	buf->mm = mm;
+	buf->owner = task_pid_nr(current);
+	buf->addr = addr;
+	buf->nr_pages = nr_pages;
+
+	/* Account the pages before they are allocated, against racing calls. */
+	spin_lock(&dma_buffers_lock);
+	if (dma_owner_pages(buf->owner) + nr_pages > DMA_MAX_PAGES) {
+		spin_unlock(&dma_buffers_lock);
+		kfree(buf);
+		return -EDQUOT;
+	}
+	list_add(&buf->node, &dma_buffers);
+	spin_unlock(&dma_buffers_lock);
+
+	buf->pages = cma_alloc(dma_contiguous_default_area, nr_pages,
+			       min_t(unsigned int, get_order(nr_pages << PAGE_SHIFT),
+				     MAX_ORDER - 1));
+	if (!buf->pages) {
+		err = -ENOMEM;
+		goto out_unaccount;
+	}
+
+	for (i = 0; i < nr_pages; i++)
+		clear_page(page_address(buf->pages + i));
+
+	err = map_user_pages(mm, addr, buf->pages, nr_pages, PAGE_SHARED);
+	if (err) {
+		cma_release(dma_contiguous_default_area, buf->pages, nr_pages);
+		goto out_unaccount;
+	}
+
+	spin_lock(&dma_buffers_lock);
+	buf->mapped = true;
+	spin_unlock(&dma_buffers_lock);
+
+	return page_to_phys(buf->pages);
+
+out_unaccount:
+	spin_lock(&dma_buffers_lock);
+	list_del(&buf->node);
+	spin_unlock(&dma_buffers_lock);
+	kfree(buf);
+
+	return err;
+}
+
+/*
+ * sys_dma_free - unmap and free the buffer the caller's dma_alloc mapped
+ * at x0.
+ */
+asmlinkage long sys_dma_free(struct pt_regs *regs)
+{
+	unsigned long addr = regs->regs[0];
+	struct mm_struct *mm = current->mm;
+	pid_t owner = task_pid_nr(current);
+	struct dma_buffer *buf;
+
+	spin_lock(&dma_buffers_lock);
+	list_for_each_entry(buf, &dma_buffers, node) {
+		if (buf->mapped && buf->mm == mm && buf->addr == addr &&
+		    buf->owner == owner) {
+			list_del(&buf->node);
+			goto found;
+		}
+	}
+	spin_unlock(&dma_buffers_lock);
+
+	return -EINVAL;
+
+found:
+	spin_unlock(&dma_buffers_lock);
+
+	dma_buffer_destroy(buf);
+
+	return 0;
+}
+
+/**
+ * dma_release_mm - free the DMA buffers mapped in an address space
+ * @mm: the address space being torn down
+ *
+ * Called from exit_mmap(), the buffers go back to the CMA area along with
+ * the rest of the address space.
+ */
+void dma_release_mm(struct mm_struct *mm)
+{
+	struct dma_buffer *buf, *next;
+	LIST_HEAD(dead);
+
+	spin_lock(&dma_buffers_lock);
+	list_for_each_entry_safe(buf, next, &dma_buffers, node) {
+		if (buf->mapped && buf->mm == mm)
+			list_move(&buf->node, &dead);
+	}
+	spin_unlock(&dma_buffers_lock);
+
+	list_for_each_entry_safe(buf, next, &dead, node)
+		dma_buffer_destroy(buf);
+}
+
+void show_cma_stats(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < cma_area_count; i++) {
+		struct cma *cma = &cma_areas[i];
+
+		pr_info("%s: %lu pages at pfn %#lx, %lu in use, allocs %lu busy %lu fails %lu\n",
+			cma->name, cma->count, cma->base_pfn, cma->nr_pages,
+			cma->nr_allocs, cma->nr_busy, cma->nr_fails);
+	}
+}
@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Memory compaction
+ *
+ * A high-order allocation can fail with plenty of memory free, when the
+ * free pages are scattered over small blocks. Compaction moves movable
+ * pages out of the way: a migrate scanner walks the zone upwards from
+ * its start and isolates movable pages, a free scanner walks downwards
+ * from its end and isolates free pages, and every movable page is copied
+ * to a free one with migrate_user_page(). Once the scanners meet, the
+ * free memory has been gathered at the start of the zone where it can
+ * merge into large blocks.
+ *
+ * Only pages flagged movable with set_page_movable() are moved, others
+ * pin their block.
+ */
+#define pr_fmt(fmt) "compaction: " fmt
+
+#include <base/compiler.h>
+#include <base/common.h>
+#include <base/list.h>
+
+#include <rtochius/compaction.h>
+#include <rtochius/mm.h>
+#include <rtochius/gfp.h>
+#include <rtochius/percpu.h>
+#include <rtochius/syscalls.h>
+#include <rtochius/printf.h>
+
+#include <asm/ptrace.h>
+
+#include "internal.h"
+
+/* Pages isolated by the migrate scanner in one go: */
+#define COMPACT_CLUSTER_MAX	32
+/* The scanners step through the zone in blocks of the largest order: */
+#define COMPACT_BLOCK_PAGES	(1UL << (MAX_ORDER - 1))
+
+struct compact_control {
+	struct zone		*zone;
+	int			order;
+
+	/* The next pfn the migrate scanner looks at: */
+	unsigned long		migrate_pfn;
+	/* The lowest pfn the free scanner is done with: */
+	unsigned long		free_pfn;
+
+	struct list_head	migratepages;
+	unsigned long		nr_migratepages;
+	struct list_head	freepages;
+	unsigned long		nr_freepages;
+
+	unsigned long		nr_migrated;
+	unsigned long		nr_failed;
+};
+
+struct compact_stats {
+	/* Compactions run for a failed high-order allocation: */
+	unsigned long		stalls;
+	/* ... and how many of them made the allocation possible: */
+	unsigned long		success;
+	/* Compactions of a whole zone, asked for by user space: */
+	unsigned long		runs;
+	unsigned long		migrated;
+	unsigned long		failed;
+};
+
+static DEFINE_PER_CPU(struct compact_stats, compact_stats);
+
+static bool compact_finished(struct compact_control *cc)
+{
+	unsigned int order;
+
+	if (cc->order == COMPACT_ORDER_ALL)
+		return false;
+
+	for (order = cc->order; order < MAX_ORDER; order++)
+		if (READ_ONCE(cc->zone->free_area[order].nr_free))
+			return true;
+
+	return false;
+}
+
+/*
+ * Isolate up to COMPACT_CLUSTER_MAX movable pages from the block the
+ * migrate scanner is in, without crossing the free scanner.
+ */
+static void isolate_migratepages(struct compact_control *cc)
+{
+	unsigned long pfn = cc->migrate_pfn;
+	unsigned long end_pfn = min(ALIGN(pfn + 1, COMPACT_BLOCK_PAGES),
+				    cc->free_pfn);
+	struct page *page;
+
+	for (; pfn < end_pfn; pfn++) {
+		if (cc->nr_migratepages == COMPACT_CLUSTER_MAX)
+			break;
+
+		if (!pfn_valid_within(pfn))
+			continue;
+
+		page = pfn_to_page(pfn);
+		if (page_zone(page) != cc->zone || !PageMovable(page))
+			continue;
+
+		/* A free page has no reference to take. */
+		if (!get_page_unless_zero(page))
+			continue;
+
+		/*
+		 * The page may have been freed and reused meanwhile, or be
+		 * isolated by another compaction. Clearing the flag makes
+		 * the page ours and pairs with set_page_movable().
+		 */
+		if (!TestClearPageMovable(page)) {
+			put_page(page);
+			continue;
+		}
+
+		list_add_tail(&page->lru, &cc->migratepages);
+		cc->nr_migratepages++;
+	}
+
+	cc->migrate_pfn = pfn;
+}
+
+/* Isolate the free pages of the next block down from the free scanner. */
+static void isolate_freepages(struct compact_control *cc)
+{
+	unsigned long start_pfn;
+
+	start_pfn = max(ALIGN_DOWN(cc->free_pfn - 1, COMPACT_BLOCK_PAGES),
+			cc->migrate_pfn);
+	cc->nr_freepages += isolate_free_pages(cc->zone, start_pfn,
+					       cc->free_pfn, &cc->freepages);
+	cc->free_pfn = start_pfn;
+}
+
+static void migrate_pages(struct compact_control *cc)
+{
+	struct page *page, *next, *newpage;
+
+	list_for_each_entry_safe(page, next, &cc->migratepages, lru) {
+		if (list_empty(&cc->freepages))
+			break;
+
+		newpage = list_first_entry(&cc->freepages, struct page, lru);
+		list_del(&newpage->lru);
+		list_del(&page->lru);
+		cc->nr_migratepages--;
+
+		if (migrate_user_page(page, newpage)) {
+			list_add(&newpage->lru, &cc->freepages);
+			SetPageMovable(page);
+			cc->nr_failed++;
+		} else {
+			cc->nr_freepages--;
+			cc->nr_migrated++;
+		}
+
+		/* Frees the old page if it moved. */
+		put_page(page);
+	}
+}
+
+static void putback_movable_pages(struct compact_control *cc)
+{
+	struct page *page, *next;
+
+	list_for_each_entry_safe(page, next, &cc->migratepages, lru) {
+		list_del(&page->lru);
+		SetPageMovable(page);
+		put_page(page);
+	}
+	cc->nr_migratepages = 0;
+}
+
+static void release_freepages(struct compact_control *cc)
+{
+	struct page *page, *next;
+
+	list_for_each_entry_safe(page, next, &cc->freepages, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+	cc->nr_freepages = 0;
+}
+
+/**
+ * compact_zone - gather the free memory of a zone into large blocks
+ * @zone: the zone to compact
+ * @order: stop as soon as a free block of this order exists, or
+ *	   COMPACT_ORDER_ALL to go through the whole zone
+ *
+ * Spins on the page table lock of every address space it migrates pages
+ * of, so the caller must not hold a spinlock. Returns the number of pages
+ * moved.
+ */
+long compact_zone(struct zone *zone, int order)
+{
+	struct compact_control cc = {
+		.zone		= zone,
+		.order		= order,
+		.migrate_pfn	= zone->zone_start_pfn,
+		.free_pfn	= zone_end_pfn(zone),
+		.migratepages	= LIST_HEAD_INIT(cc.migratepages),
+		.freepages	= LIST_HEAD_INIT(cc.freepages),
+	};
+
+	if (!zone->spanned_pages)
+		return 0;
+
+	if (order == COMPACT_ORDER_ALL)
+		this_cpu_inc(compact_stats.runs);
+	else
+		this_cpu_inc(compact_stats.stalls);
+
+	/* Deferred and per-cpu cached pages are free pages too. */
+	deferred_init_zone(zone);
+	drain_all_pages(zone);
+
+	while (cc.migrate_pfn < cc.free_pfn && !compact_finished(&cc)) {
+		isolate_migratepages(&cc);
+		if (!cc.nr_migratepages)
+			continue;
+
+		while (cc.nr_freepages < cc.nr_migratepages &&
+		       cc.free_pfn > cc.migrate_pfn)
+			isolate_freepages(&cc);
+
+		migrate_pages(&cc);
+
+		/* Let the pages just freed merge into larger blocks. */
+		drain_all_pages(zone);
+	}
+
+	putback_movable_pages(&cc);
+	release_freepages(&cc);
+	drain_all_pages(zone);
+
+	this_cpu_add(compact_stats.migrated, cc.nr_migrated);
+	this_cpu_add(compact_stats.failed, cc.nr_failed);
+	if (order != COMPACT_ORDER_ALL && compact_finished(&cc))
+		this_cpu_inc(compact_stats.success);
+
+	return cc.nr_migrated;
+}
+
+/*
+ * sys_compact_memory - compact every zone.
+ *
+ * Returns the number of pages moved.
+ */
+asmlinkage long sys_compact_memory(struct pt_regs *regs)
+{
+	enum zone_type i;
+	long nr_migrated = 0;
+
+	for (i = 0; i < MAX_NR_ZONES; i++)
+		nr_migrated += compact_zone(NODE_DATA()->node_zones + i,
+					    COMPACT_ORDER_ALL);
+
+	return nr_migrated;
+}
+
+void show_compaction_stats(void)
+{
+	char buf[MAX_ORDER * 6];
+	unsigned int order;
+	enum zone_type i;
+	int cpu, len;
+
+	for_each_online_cpu(cpu) {
+		struct compact_stats *st = per_cpu_ptr(&compact_stats, cpu);
+
+		pr_info("CPU%d: stalls %lu success %lu runs %lu migrated %lu failed %lu\n",
+			cpu, st->stalls, st->success, st->runs,
+			st->migrated, st->failed);
+	}
+
+	/* -1000 for orders that are available, towards 1000 if fragmented: */
+	for (i = 0; i < MAX_NR_ZONES; i++) {
+		struct zone *zone = NODE_DATA()->node_zones + i;
+
+		if (!zone->spanned_pages)
+			continue;
+
+		len = 0;
+		for (order = 1; order < MAX_ORDER; order++)
+			len += snprintf(buf + len, sizeof(buf) - len, " %5d",
+					fragmentation_index(zone, order));
+
+		pr_info("%s: fragmentation index%s\n", zone->name, buf);
+	}
+}
@@ -10,6 +10,8 @@
 #endif
 
 struct mm_struct init_mm = {
+    .mm_rb		= RB_ROOT,
+    .mmap_lock	= __RW_LOCK_UNLOCKED(init_mm.mmap_lock),
     .pgd		= swapper_pg_dir,
     .page_table_lock = __SPIN_LOCK_UNLOCKED(init_mm.page_table_lock),
     INIT_MM_CONTEXT(init_mm)
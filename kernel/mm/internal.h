@@ -47,4 +47,13 @@ struct alloc_context {
 	enum zone_type zoneidx;
 };
 
+extern int sysctl_extfrag_threshold;
+
+extern void drain_all_pages(struct zone *zone);
+extern void deferred_init_zone(struct zone *zone);
+extern unsigned long isolate_free_pages(struct zone *zone,
+		unsigned long start_pfn, unsigned long end_pfn,
+		struct list_head *freelist);
+extern int fragmentation_index(struct zone *zone, unsigned int order);
+
 #endif /* !__MM_INTERNAL_H_ */
@@ -1,6 +1,21 @@
+#define pr_fmt(fmt) "fault: " fmt
+
+#include <base/compiler.h>
+#include <base/common.h>
+#include <base/errno.h>
+#include <base/log2.h>
+#include <base/sizes.h>
+
 #include <rtochius/mm.h>
+#include <rtochius/mmap.h>
+#include <rtochius/gfp.h>
+#include <rtochius/percpu.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/param.h>
+#include <rtochius/printf.h>
 
 #include <asm/cacheflush.h>
+#include <asm/pgalloc.h>
 #include <asm/tlbflush.h>
 
 /*** Page table manipulation functions ***/
@@ -79,6 +94,20 @@ static void vunmap_page_range(unsigned long addr, unsigned long end)
 	} while (pgd++, addr = next, addr != end);
 }
 
+/**
+ * unmap_kernel_range_noflush - unmap kernel VM area
+ * @addr: start of the VM area to unmap
+ * @size: size of the VM area to unmap
+ *
+ * Same as unmap_kernel_range() but the caller is responsible for
+ * flushing the TLB before the range is handed out again, which lets
+ * vmalloc batch the flushes of many areas.
+ */
+void unmap_kernel_range_noflush(unsigned long addr, unsigned long size)
+{
+	vunmap_page_range(addr, addr + size);
+}
+
 /**
  * unmap_kernel_range - unmap kernel VM area and flush cache and TLB
  * @addr: start of the VM area to unmap
@@ -96,6 +125,210 @@ void unmap_kernel_range(unsigned long addr, unsigned long size)
 	flush_tlb_kernel_range(addr, end);
 }
 
+/*
+ * Allocate page upper directory.
+ * We've already handled the fast-path in-line.
+ */
+#ifndef __PAGETABLE_PUD_FOLDED
+int __pud_alloc(struct mm_struct *mm, p4d_t *p4d, unsigned long address)
+{
+	pud_t *new = pud_alloc_one(mm, address);
+	if (!new)
+		return -ENOMEM;
+
+	smp_wmb(); /* See comment in __pte_alloc */
+
+	spin_lock(&mm->page_table_lock);
+#ifndef __ARCH_HAS_5LEVEL_HACK
+	if (!p4d_present(*p4d)) {
+		mm_inc_nr_puds(mm);
+		p4d_populate(mm, p4d, new);
+	} else	/* Another has populated it */
+		pud_free(mm, new);
+#else
+	if (!pgd_present(*p4d)) {
+		mm_inc_nr_puds(mm);
+		pgd_populate(mm, p4d, new);
+	} else	/* Another has populated it */
+		pud_free(mm, new);
+#endif /* __ARCH_HAS_5LEVEL_HACK */
+	spin_unlock(&mm->page_table_lock);
+	return 0;
+}
+#endif /* __PAGETABLE_PUD_FOLDED */
+
+#ifndef __PAGETABLE_PMD_FOLDED
+/*
+ * Allocate page middle directory.
+ * We've already handled the fast-path in-line.
+ */
+int __pmd_alloc(struct mm_struct *mm, pud_t *pud, unsigned long address)
+{
+	spinlock_t *ptl;
+	pmd_t *new = pmd_alloc_one(mm, address);
+	if (!new)
+		return -ENOMEM;
+
+	smp_wmb(); /* See comment in __pte_alloc */
+
+	ptl = pud_lock(mm, pud);
+	if (!pud_present(*pud)) {
+		mm_inc_nr_pmds(mm);
+		pud_populate(mm, pud, new);
+	} else	/* Another has populated it */
+		pmd_free(mm, new);
+	spin_unlock(ptl);
+	return 0;
+}
+#endif /* __PAGETABLE_PMD_FOLDED */
+
+int __pte_alloc(struct mm_struct *mm, pmd_t *pmd, unsigned long address)
+{
+	spinlock_t *ptl;
+	pgtable_t new = pte_alloc_one(mm);
+	if (!new)
+		return -ENOMEM;
+
+	/*
+	 * Ensure all pte setup (eg. pte page lock and page clearing) are
+	 * visible before the pte is made visible to other CPUs by being
+	 * put into page tables.
+	 *
+	 * The other side of the story is the pointer chasing in the page
+	 * table walking code (when walking the page table without locking;
+	 * ie. most of the time). Fortunately, these data accesses consist
+	 * of a chain of data-dependent loads, meaning most CPUs (alpha
+	 * being the notable exception) will already guarantee loads are
+	 * seen in-order. See the alpha page table accessors for the
+	 * smp_read_barrier_depends() barriers in page table walking code.
+	 */
+	smp_wmb(); /* Could be smp_wmb__xxx(before|after)_spin_lock */
+
+	ptl = pmd_lock(mm, pmd);
+	if (likely(pmd_none(*pmd))) {	/* Has another populated it ? */
+		mm_inc_nr_ptes(mm);
+		pmd_populate(mm, pmd, new);
+		new = NULL;
+	}
+	spin_unlock(ptl);
+	if (new)
+		pte_free(mm, new);
+	return 0;
+}
+
+int __pte_alloc_kernel(pmd_t *pmd, unsigned long address)
+{
+	pte_t *new = pte_alloc_one_kernel(&init_mm);
+	if (!new)
+		return -ENOMEM;
+
+	smp_wmb(); /* See comment in __pte_alloc */
+
+	spin_lock(&init_mm.page_table_lock);
+	if (likely(pmd_none(*pmd))) {	/* Has another populated it ? */
+		pmd_populate_kernel(&init_mm, pmd, new);
+		new = NULL;
+	}
+	spin_unlock(&init_mm.page_table_lock);
+	if (new)
+		pte_free_kernel(&init_mm, new);
+	return 0;
+}
+
+static int apply_to_pte_range(struct mm_struct *mm, pmd_t *pmd,
+				     unsigned long addr, unsigned long end,
+				     pte_fn_t fn, void *data)
+{
+	pte_t *pte;
+	int err;
+	pgtable_t token;
+	spinlock_t *ptl = NULL;
+
+	pte = (mm == &init_mm) ?
+		pte_alloc_kernel(pmd, addr) :
+		pte_alloc_map_lock(mm, pmd, addr, &ptl);
+	if (!pte)
+		return -ENOMEM;
+
+	BUG_ON(pmd_huge(*pmd));
+
+	arch_enter_lazy_mmu_mode();
+
+	token = pmd_pgtable(*pmd);
+
+	do {
+		err = fn(pte++, token, addr, data);
+		if (err)
+			break;
+	} while (addr += PAGE_SIZE, addr != end);
+
+	arch_leave_lazy_mmu_mode();
+
+	if (mm != &init_mm)
+		pte_unmap_unlock(pte-1, ptl);
+	return err;
+}
+
+static int apply_to_pmd_range(struct mm_struct *mm, pud_t *pud,
+				     unsigned long addr, unsigned long end,
+				     pte_fn_t fn, void *data)
+{
+	pmd_t *pmd;
+	unsigned long next;
+	int err;
+
+	pmd = pmd_alloc(mm, pud, addr);
+	if (!pmd)
+		return -ENOMEM;
+	do {
+		next = pmd_addr_end(addr, end);
+		err = apply_to_pte_range(mm, pmd, addr, next, fn, data);
+		if (err)
+			break;
+	} while (pmd++, addr = next, addr != end);
+	return err;
+}
+
+static int apply_to_pud_range(struct mm_struct *mm, p4d_t *p4d,
+				     unsigned long addr, unsigned long end,
+				     pte_fn_t fn, void *data)
+{
+	pud_t *pud;
+	unsigned long next;
+	int err;
+
+	pud = pud_alloc(mm, p4d, addr);
+	if (!pud)
+		return -ENOMEM;
+	do {
+		next = pud_addr_end(addr, end);
+		err = apply_to_pmd_range(mm, pud, addr, next, fn, data);
+		if (err)
+			break;
+	} while (pud++, addr = next, addr != end);
+	return err;
+}
+
+static int apply_to_p4d_range(struct mm_struct *mm, pgd_t *pgd,
+				     unsigned long addr, unsigned long end,
+				     pte_fn_t fn, void *data)
+{
+	p4d_t *p4d;
+	unsigned long next;
+	int err;
+
+	p4d = p4d_alloc(mm, pgd, addr);
+	if (!p4d)
+		return -ENOMEM;
+	do {
+		next = p4d_addr_end(addr, end);
+		err = apply_to_pud_range(mm, p4d, addr, next, fn, data);
+		if (err)
+			break;
+	} while (p4d++, addr = next, addr != end);
+	return err;
+}
+
 /*
  * Scan a region of virtual memory, filling in page tables as necessary
  * and calling a provided function on each leaf page table.
@@ -103,5 +336,758 @@ void unmap_kernel_range(unsigned long addr, unsigned long size)
 int apply_to_page_range(struct mm_struct *mm, unsigned long addr,
 			unsigned long size, pte_fn_t fn, void *data)
 {
+	pgd_t *pgd;
+	unsigned long next;
+	unsigned long end = addr + size;
+	int err;
+
+	if (WARN_ON(addr >= end))
+		return -EINVAL;
+
+	pgd = pgd_offset(mm, addr);
+	do {
+		next = pgd_addr_end(addr, end);
+		err = apply_to_p4d_range(mm, pgd, addr, next, fn, data);
+		if (err)
+			break;
+	} while (pgd++, addr = next, addr != end);
+
+	return err;
+}
+
+struct map_user_pages_data {
+	struct mm_struct	*mm;
+	struct page		*page;
+	pgprot_t		prot;
+	unsigned long		mapped;
+};
+
+static int map_user_pages_pte(pte_t *pte, pgtable_t token, unsigned long addr,
+			      void *data)
+{
+	struct map_user_pages_data *d = data;
+	struct page *page = d->page + d->mapped;
+
+	if (!pte_none(*pte))
+		return -EEXIST;
+
+	get_page(page);
+	set_pte_at(d->mm, addr, pte, pte_mkspecial(mk_pte(page, d->prot)));
+	d->mapped++;
+
+	return 0;
+}
+
+/**
+ * map_user_pages - map physically contiguous pages into a user address space
+ * @mm: the address space to map into
+ * @addr: page aligned user virtual address
+ * @page: the first page
+ * @nr_pages: number of pages
+ * @prot: page protection, must include PTE_USER
+ *
+ * Every mapped page gets a reference. The range must not be mapped yet,
+ * otherwise nothing is mapped and -EEXIST is returned. Returns -ENOMEM if
+ * a page table can't be allocated.
+ */
+int map_user_pages(struct mm_struct *mm, unsigned long addr,
+		   struct page *page, unsigned long nr_pages, pgprot_t prot)
+{
+	struct map_user_pages_data d = {
+		.mm	= mm,
+		.page	= page,
+		.prot	= prot,
+	};
+	unsigned long size = nr_pages << PAGE_SHIFT;
+	int err;
+
+	if (!PAGE_ALIGNED(addr) || !nr_pages ||
+	    addr >= TASK_SIZE || size > TASK_SIZE - addr)
+		return -EINVAL;
+
+	err = apply_to_page_range(mm, addr, size, map_user_pages_pte, &d);
+	if (err && d.mapped)
+		unmap_user_pages(mm, addr, d.mapped);
+
+	return err;
+}
+
+static int unmap_user_pages_pte(pte_t *pte, pgtable_t token,
+				unsigned long addr, void *data)
+{
+	struct mm_struct *mm = data;
+	pte_t ptent = *pte;
+
+	if (pte_none(ptent))
+		return 0;
+
+	pte_clear(mm, addr, pte);
+	if (pte_present(ptent))
+		put_page(pte_page(ptent));
+
+	return 0;
+}
+
+/**
+ * unmap_user_pages - tear down a user range and drop its page references
+ * @mm: the address space
+ * @addr: page aligned user virtual address
+ * @nr_pages: number of pages
+ *
+ * Counterpart of map_user_pages() and create_user_mapping(), holes in
+ * the range are skipped.
+ */
+void unmap_user_pages(struct mm_struct *mm, unsigned long addr,
+		      unsigned long nr_pages)
+{
+	struct vm_area_struct vma = { .vm_mm = mm };
+
+	apply_to_page_range(mm, addr, nr_pages << PAGE_SHIFT,
+			    unmap_user_pages_pte, mm);
+	flush_tlb_range(&vma, addr, addr + (nr_pages << PAGE_SHIFT));
+}
+
+/*
+ * The PMD entry pointing to the PTE table for a user address, or NULL if
+ * there is no such table. Nothing is allocated.
+ */
+static pmd_t *user_pmd_offset(struct mm_struct *mm, unsigned long addr)
+{
+	pgd_t *pgd;
+	p4d_t *p4d;
+	pud_t *pud;
+	pmd_t *pmd;
+
+	pgd = pgd_offset(mm, addr);
+	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
+		return NULL;
+
+	p4d = p4d_offset(pgd, addr);
+	if (p4d_none(*p4d) || unlikely(p4d_bad(*p4d)))
+		return NULL;
+
+	pud = pud_offset(p4d, addr);
+	if (pud_none(*pud) || unlikely(pud_bad(*pud)))
+		return NULL;
+
+	pmd = pmd_offset(pud, addr);
+	if (pmd_none(*pmd) || unlikely(pmd_bad(*pmd)))
+		return NULL;
+
+	return pmd;
+}
+
+/*
+ * Same as user_pmd_offset(), allocating the missing tables down to and
+ * including the PTE table. Returns NULL if out of memory.
+ */
+static pmd_t *user_pmd_alloc(struct mm_struct *mm, unsigned long addr)
+{
+	pgd_t *pgd;
+	p4d_t *p4d;
+	pud_t *pud;
+	pmd_t *pmd;
+
+	pgd = pgd_offset(mm, addr);
+	p4d = p4d_alloc(mm, pgd, addr);
+	if (!p4d)
+		return NULL;
+
+	pud = pud_alloc(mm, p4d, addr);
+	if (!pud)
+		return NULL;
+
+	pmd = pmd_alloc(mm, pud, addr);
+	if (!pmd || pte_alloc(mm, pmd, addr))
+		return NULL;
+
+	return pmd;
+}
+
+/*
+ * The PTE slot for a user address, or NULL if no page table covers it.
+ * Nothing is allocated.
+ */
+static pte_t *user_pte_offset(struct mm_struct *mm, unsigned long addr)
+{
+	pmd_t *pmd = user_pmd_offset(mm, addr);
+
+	return pmd ? pte_offset_map(pmd, addr) : NULL;
+}
+
+/**
+ * pin_user_page - take a reference on the page mapped at a user address
+ * @mm: the address space
+ * @addr: user virtual address
+ * @write: the mapping must be writable
+ *
+ * The lookup and the reference are done under mm->page_table_lock, which
+ * migrate_user_page() holds too, so the page can't be moved between the
+ * two. The extra reference already makes any later migration fail; the
+ * page is also made unmovable so that compaction stops picking it.
+ *
+ * Returns the page, or NULL if nothing suitable is mapped at @addr.
+ */
+struct page *pin_user_page(struct mm_struct *mm, unsigned long addr,
+			   bool write)
+{
+	struct page *page = NULL;
+	pte_t *ptep, pte;
+
+	spin_lock(&mm->page_table_lock);
+	ptep = user_pte_offset(mm, addr);
+	if (!ptep)
+		goto out_unlock;
+
+	pte = READ_ONCE(*ptep);
+	pte_unmap(ptep);
+	if (!pte_valid_user(pte) || (write && !pte_write(pte)))
+		goto out_unlock;
+
+	page = pte_page(pte);
+	get_page(page);
+	ClearPageMovable(page);
+
+out_unlock:
+	spin_unlock(&mm->page_table_lock);
+
+	return page;
+}
+
+/**
+ * migrate_user_page - move a movable page to another physical page
+ * @page: the movable page, with a reference held by the caller
+ * @newpage: a free order-0 page with a single reference
+ *
+ * The mapping is replaced by a migration entry while the contents are
+ * copied, so an access from another CPU faults and waits for the new
+ * page in handle_mm_fault(). On success the reference of the
+ * mapping moves to @newpage and @page is left with the caller's one.
+ *
+ * Returns -EAGAIN if @page is not mapped where page->mapping and
+ * page->index say any more, or if someone else holds a reference.
+ */
+int migrate_user_page(struct page *page, struct page *newpage)
+{
+	struct mm_struct *mm = page->mapping;
+	unsigned long addr = page->index;
+	struct vm_area_struct vma = { .vm_mm = mm };
+	pte_t *ptep, pte;
+	int ret = -EAGAIN;
+
+	if (!mm)
+		return -EAGAIN;
+
+	spin_lock(&mm->page_table_lock);
+	ptep = user_pte_offset(mm, addr);
+	if (!ptep)
+		goto out_unlock;
+
+	pte = READ_ONCE(*ptep);
+	if (!pte_valid(pte) || pte_page(pte) != page)
+		goto out_unlock;
+
+	/* The mapping and the caller, nobody else: */
+	if (page_ref_count(page) != 2)
+		goto out_unlock;
+
+	/* Atomically, the hardware may still be setting AF or dirty. */
+	pte = __pte(xchg_relaxed(&pte_val(*ptep),
+				 pte_val(pte_mkmigration(pte))));
+	flush_tlb_page(&vma, addr);
+
+	copy_page(page_address(newpage), page_address(page));
+
+	set_page_movable(newpage, mm, addr);
+	set_pte_at(mm, addr, ptep,
+		   mk_pte(newpage, __pgprot(pte_val(pte) & ~PTE_ADDR_MASK)));
+
+	ClearPageMovable(page);
+	page->mapping = NULL;
+	put_page(page);
+	ret = 0;
+
+out_unlock:
+	if (ptep)
+		pte_unmap(ptep);
+	spin_unlock(&mm->page_table_lock);
+
+	return ret;
+}
+
+/*** User page faults ***/
+
+/*
+ * Pages zapped from a user range, held until the TLB no longer maps
+ * them.
+ */
+#define ZAP_BATCH	32
+
+struct zap_batch {
+	struct vm_area_struct	*vma;
+	/* Start of the range not flushed from the TLB yet: */
+	unsigned long		start;
+	unsigned int		nr;
+	struct page		*pages[ZAP_BATCH];
+};
+
+static void zap_batch_flush(struct zap_batch *zb, unsigned long end)
+{
+	if (zb->start != end)
+		flush_tlb_range(zb->vma, zb->start, end);
+	while (zb->nr)
+		put_page(zb->pages[--zb->nr]);
+	zb->start = end;
+}
+
+static void zap_pte_range(struct zap_batch *zb, pmd_t *pmd,
+			  unsigned long addr, unsigned long end)
+{
+	struct mm_struct *mm = zb->vma->vm_mm;
+	pte_t *ptep, *pte, ptent;
+
+	ptep = pte = pte_offset_map(pmd, addr);
+	do {
+		ptent = READ_ONCE(*pte);
+		if (pte_none(ptent))
+			continue;
+
+		/* Pages map_user_pages() put there are left alone. */
+		if (pte_special(ptent) && !is_zero_pfn(pte_pfn(ptent)))
+			continue;
+
+		ptent = ptep_get_and_clear(mm, addr, pte);
+		if (is_zero_pfn(pte_pfn(ptent)))
+			continue;
+
+		zb->pages[zb->nr++] = pte_page(ptent);
+		if (zb->nr == ZAP_BATCH)
+			zap_batch_flush(zb, addr + PAGE_SIZE);
+	} while (pte++, addr += PAGE_SIZE, addr != end);
+	pte_unmap(ptep);
+}
+
+/**
+ * zap_user_range - unmap the pages a VMA faulted in
+ * @vma: the VMA
+ * @start: page aligned start, inside @vma
+ * @end: page aligned end, inside @vma
+ *
+ * Drops the reference of every anonymous page mapped in the range once
+ * no TLB maps it any more. The page tables stay.
+ */
+void zap_user_range(struct vm_area_struct *vma, unsigned long start,
+		    unsigned long end)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	struct zap_batch zb = { .vma = vma, .start = start };
+	unsigned long addr, next;
+	pmd_t *pmd;
+
+	spin_lock(&mm->page_table_lock);
+	for (addr = start; addr != end; addr = next) {
+		next = pmd_addr_end(addr, end);
+		pmd = user_pmd_offset(mm, addr);
+		if (pmd)
+			zap_pte_range(&zb, pmd, addr, next);
+	}
+	zap_batch_flush(&zb, end);
+	spin_unlock(&mm->page_table_lock);
+}
+
+static void copy_one_pte(struct mm_struct *dst_mm, struct mm_struct *src_mm,
+			 pte_t *dst_pte, pte_t *src_pte, unsigned long addr,
+			 bool cow)
+{
+	pte_t pte = READ_ONCE(*src_pte);
+
+	if (pte_none(pte))
+		return;
+
+	if (is_zero_pfn(pte_pfn(pte))) {
+		set_pte_at(dst_mm, addr, dst_pte, pte);
+		return;
+	}
+
+	/* Pages map_user_pages() put there are not inherited. */
+	if (pte_special(pte))
+		return;
+
+	get_page(pte_page(pte));
+
+	/*
+	 * Both address spaces share the page read-only from now on, the
+	 * first one to write gets a copy in do_wp_page().
+	 */
+	if (cow && pte_write(pte)) {
+		ptep_set_wrprotect(src_mm, addr, src_pte);
+		pte = READ_ONCE(*src_pte);
+	}
+
+	set_pte_at(dst_mm, addr, dst_pte, pte);
+}
+
+/**
+ * copy_page_range - share the pages of a VMA with a copy of it
+ * @dst_vma: the new VMA, in an address space nobody runs in yet
+ * @src_vma: the VMA to copy
+ *
+ * The pages of a private writable VMA become copy-on-write in both
+ * address spaces, those of a shared one stay writable in both. The
+ * caller flushes the TLB of the source address space afterwards.
+ *
+ * Returns 0 or -ENOMEM.
+ */
+int copy_page_range(struct vm_area_struct *dst_vma,
+		    struct vm_area_struct *src_vma)
+{
+	struct mm_struct *dst_mm = dst_vma->vm_mm;
+	struct mm_struct *src_mm = src_vma->vm_mm;
+	bool cow = !(src_vma->vm_flags & VM_SHARED) &&
+		   (src_vma->vm_flags & VM_WRITE);
+	unsigned long addr, next;
+	pmd_t *src_pmd, *dst_pmd;
+	pte_t *src_ptep, *dst_ptep;
+	unsigned int i;
+
+	for (addr = src_vma->vm_start; addr != src_vma->vm_end; addr = next) {
+		next = pmd_addr_end(addr, src_vma->vm_end);
+		src_pmd = user_pmd_offset(src_mm, addr);
+		if (!src_pmd)
+			continue;
+
+		dst_pmd = user_pmd_alloc(dst_mm, addr);
+		if (!dst_pmd)
+			return -ENOMEM;
+
+		/* Also keeps migrations of the source pages out. */
+		spin_lock(&src_mm->page_table_lock);
+		src_ptep = pte_offset_map(src_pmd, addr);
+		dst_ptep = pte_offset_map(dst_pmd, addr);
+		for (i = 0; i < (next - addr) >> PAGE_SHIFT; i++)
+			copy_one_pte(dst_mm, src_mm, dst_ptep + i, src_ptep + i,
+				     addr + (i << PAGE_SHIFT), cow);
+		pte_unmap(dst_ptep);
+		pte_unmap(src_ptep);
+		spin_unlock(&src_mm->page_table_lock);
+	}
+
+	return 0;
+}
+
+/*
+ * Fault-around: a fault on an empty PTE also fills the empty PTEs of
+ * the naturally aligned window of fault_around_pages around it, so a
+ * task working through fresh memory takes one fault per window instead
+ * of one per page. Read faults map the zero page there, which costs
+ * nothing but the PTEs, write faults map zeroed pages of their own.
+ */
+#define FAULT_AROUND_MAX_PAGES	64
+
+static unsigned long fault_around_pages __read_mostly = SZ_64K >> PAGE_SHIFT;
+
+static int __init setup_fault_around_bytes(char *p)
+{
+	unsigned long bytes;
+
+	if (!p || kstrtoul(p, 0, &bytes))
+		return -EINVAL;
+
+	/* Less than two pages turns fault-around off. */
+	bytes = min(bytes, FAULT_AROUND_MAX_PAGES * PAGE_SIZE);
+	fault_around_pages = bytes < PAGE_SIZE ? 1 :
+			     rounddown_pow_of_two(bytes >> PAGE_SHIFT);
+	return 0;
+}
+early_param("fault_around_bytes", setup_fault_around_bytes);
+
+unsigned long zero_pfn __read_mostly;
+
+static int __init init_zero_pfn(void)
+{
+	zero_pfn = page_to_pfn(ZERO_PAGE(0));
+	return 0;
+}
+early_initcall(init_zero_pfn);
+
+struct fault_stats {
+	unsigned long		faults;
+	/* Faults on an empty PTE, given the zero page or a new page: */
+	unsigned long		zero;
+	unsigned long		anon;
+	/* Empty PTEs filled by fault-around on top of those: */
+	unsigned long		around;
+	/* Write faults on a read-only page, copied or taken over: */
+	unsigned long		cow_copy;
+	unsigned long		cow_reuse;
+	/* Faults that only had to set the access flag, or nothing: */
+	unsigned long		spurious;
+	/* Faults the VMA does not allow, or out of memory: */
+	unsigned long		errors;
+};
+
+static DEFINE_PER_CPU(struct fault_stats, fault_stats);
+
+static bool access_error(struct vm_area_struct *vma, unsigned int flags)
+{
+	if (flags & FAULT_FLAG_WRITE)
+		return !(vma->vm_flags & VM_WRITE);
+	if (flags & FAULT_FLAG_INSTRUCTION)
+		return !(vma->vm_flags & VM_EXEC);
+	return !(vma->vm_flags & (VM_READ | VM_WRITE));
+}
+
+/*
+ * Map @page, or the zero page if NULL, at the empty PTE of @addr. Called
+ * with the page table lock held.
+ */
+static void set_anon_pte(struct vm_area_struct *vma, unsigned long addr,
+			 pte_t *ptep, struct page *page)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	pte_t entry;
+
+	if (!page) {
+		entry = pfn_pte(my_zero_pfn(addr), vma->vm_page_prot);
+		entry = pte_wrprotect(pte_mkspecial(entry));
+	} else {
+		entry = mk_pte(page, vma->vm_page_prot);
+		if (vma->vm_flags & VM_WRITE)
+			entry = pte_mkwrite(pte_mkdirty(entry));
+		/* A page of a shared VMA may be mapped more than once. */
+		if (!(vma->vm_flags & VM_SHARED))
+			set_page_movable(page, mm, addr);
+	}
+
+	set_pte_at(mm, addr, ptep, entry);
+}
+
+static int do_anonymous_page(struct vm_area_struct *vma, unsigned long addr,
+			     pmd_t *pmd, unsigned int flags)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	struct page *pages[FAULT_AROUND_MAX_PAGES] = { NULL };
+	unsigned long size = fault_around_pages << PAGE_SHIFT;
+	unsigned long start, end, a, nr = 0, used = 0, around = 0;
+	pte_t *ptep, *pte;
+	bool zero;
+
+	/*
+	 * Reads of a private VMA share the zero page until written. A
+	 * shared VMA needs real pages right away, or a copy of the address
+	 * space would not see the writes.
+	 */
+	zero = !(flags & FAULT_FLAG_WRITE) && !(vma->vm_flags & VM_SHARED);
+
+	/* A window is never larger than a PTE table. */
+	start = max(ALIGN_DOWN(addr, size), vma->vm_start);
+	end = min(ALIGN_DOWN(addr, size) + size, vma->vm_end);
+	ptep = pte_offset_map(pmd, start);
+
+	if (!zero) {
+		for (a = start, pte = ptep; a != end; a += PAGE_SIZE, pte++)
+			if (pte_none(READ_ONCE(*pte)))
+				nr++;
+
+		nr = alloc_pages_bulk(GFP_USER | __GFP_MOVABLE | __GFP_ZERO,
+				      max(nr, 1UL), pages);
+		if (!nr) {
+			pte_unmap(ptep);
+			return -ENOMEM;
+		}
+	}
+
+	spin_lock(&mm->page_table_lock);
+
+	/* Another fault or a migration got there first, retry. */
+	pte = ptep + ((addr - start) >> PAGE_SHIFT);
+	if (!pte_none(*pte))
+		goto unlock;
+
+	/* The faulting address first, the neighbours get what is left. */
+	set_anon_pte(vma, addr, pte, zero ? NULL : pages[used++]);
+	if (zero)
+		this_cpu_inc(fault_stats.zero);
+	else
+		this_cpu_inc(fault_stats.anon);
+
+	for (a = start, pte = ptep; a != end; a += PAGE_SIZE, pte++) {
+		if (a == addr || !pte_none(*pte))
+			continue;
+		if (!zero && used == nr)
+			break;
+		set_anon_pte(vma, a, pte, zero ? NULL : pages[used++]);
+		around++;
+	}
+	this_cpu_add(fault_stats.around, around);
+
+unlock:
+	spin_unlock(&mm->page_table_lock);
+	pte_unmap(ptep);
+
+	while (used < nr)
+		__free_page(pages[used++]);
+
+	return 0;
+}
+
+/*
+ * A write to a read-only PTE of a writable VMA: the zero page, or a page
+ * copy_page_range() shares with another address space.
+ */
+static int do_wp_page(struct vm_area_struct *vma, unsigned long addr,
+		      pte_t *ptep, pte_t orig)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	struct page *old = NULL, *new;
+	pte_t entry;
+
+	if (!is_zero_pfn(pte_pfn(orig))) {
+		/* Not a page of ours, see zap_pte_range(). */
+		if (pte_special(orig))
+			return -EFAULT;
+		old = pte_page(orig);
+	}
+
+	spin_lock(&mm->page_table_lock);
+	if (!pte_same(READ_ONCE(*ptep), orig))
+		goto unlock;
+
+	/*
+	 * With the mapping's the only reference left, nobody else sees the
+	 * page any more and it can be taken over instead of copied. Pages
+	 * of a shared VMA are always written in place.
+	 */
+	if (old && ((vma->vm_flags & VM_SHARED) || page_ref_count(old) == 1)) {
+		entry = pte_mkyoung(pte_mkdirty(pte_mkwrite(orig)));
+		ptep_set_access_flags(vma, addr, ptep, entry, 1);
+		if (!(vma->vm_flags & VM_SHARED))
+			set_page_movable(old, mm, addr);
+		this_cpu_inc(fault_stats.cow_reuse);
+		goto unlock;
+	}
+
+	/* Keeps the page while it is copied without the lock. */
+	if (old)
+		get_page(old);
+	spin_unlock(&mm->page_table_lock);
+
+	new = alloc_page(GFP_USER | __GFP_MOVABLE | (old ? 0 : __GFP_ZERO));
+	if (!new) {
+		if (old)
+			put_page(old);
+		return -ENOMEM;
+	}
+
+	if (old)
+		copy_page(page_address(new), page_address(old));
+
+	spin_lock(&mm->page_table_lock);
+	if (pte_same(READ_ONCE(*ptep), orig)) {
+		/* Break before make, the output address changes. */
+		pte_clear(mm, addr, ptep);
+		flush_tlb_page(vma, addr);
+		set_anon_pte(vma, addr, ptep, new);
+		new = NULL;
+
+		/* The reference of the old mapping. */
+		if (old)
+			put_page(old);
+		this_cpu_inc(fault_stats.cow_copy);
+	}
+	spin_unlock(&mm->page_table_lock);
+
+	if (new)
+		__free_page(new);
+	if (old)
+		put_page(old);
+
+	return 0;
+
+unlock:
+	spin_unlock(&mm->page_table_lock);
 	return 0;
 }
+
+/**
+ * handle_mm_fault - resolve a fault on a user address
+ * @vma: the VMA covering @addr, with the mmap_lock of its address space
+ *	 held for reading
+ * @addr: the faulting user address
+ * @flags: FAULT_FLAG_*
+ *
+ * Returns 0 once the access can be retried, -EFAULT if @vma does not
+ * allow it, or -ENOMEM.
+ */
+int handle_mm_fault(struct vm_area_struct *vma, unsigned long addr,
+		    unsigned int flags)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	pmd_t *pmd;
+	pte_t *ptep, pte, entry;
+	int ret = 0;
+
+	this_cpu_inc(fault_stats.faults);
+
+	if (access_error(vma, flags)) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	addr &= PAGE_MASK;
+	pmd = user_pmd_alloc(mm, addr);
+	if (!pmd) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ptep = pte_offset_map(pmd, addr);
+	pte = READ_ONCE(*ptep);
+
+	if (pte_none(pte)) {
+		ret = do_anonymous_page(vma, addr, pmd, flags);
+	} else if (!pte_present(pte)) {
+		/*
+		 * A migration entry. The migration holds the page table
+		 * lock until the new page is mapped, so getting the lock is
+		 * all the waiting there is.
+		 */
+		spin_lock(&mm->page_table_lock);
+		spin_unlock(&mm->page_table_lock);
+	} else if ((flags & FAULT_FLAG_WRITE) && !pte_write(pte)) {
+		ret = do_wp_page(vma, addr, ptep, pte);
+	} else {
+		/* The access flag, dirty state or a stale TLB entry. */
+		spin_lock(&mm->page_table_lock);
+		if (pte_same(READ_ONCE(*ptep), pte)) {
+			entry = pte_mkyoung(pte);
+			if (flags & FAULT_FLAG_WRITE)
+				entry = pte_mkdirty(entry);
+			ptep_set_access_flags(vma, addr, ptep, entry,
+					      flags & FAULT_FLAG_WRITE);
+		}
+		spin_unlock(&mm->page_table_lock);
+		this_cpu_inc(fault_stats.spurious);
+	}
+	pte_unmap(ptep);
+
+out:
+	if (ret)
+		this_cpu_inc(fault_stats.errors);
+	return ret;
+}
+
+void show_fault_stats(void)
+{
+	int cpu;
+
+	pr_info("fault-around %lu pages\n", fault_around_pages);
+
+	for_each_online_cpu(cpu) {
+		struct fault_stats *st = per_cpu_ptr(&fault_stats, cpu);
+
+		pr_info("CPU%d: faults %lu zero %lu anon %lu around %lu cow_copy %lu cow_reuse %lu spurious %lu errors %lu\n",
+			cpu, st->faults, st->zero, st->anon, st->around,
+			st->cow_copy, st->cow_reuse, st->spurious, st->errors);
+	}
+}
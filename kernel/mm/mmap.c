@@ -1,10 +1,22 @@
 #include <rtochius/mmap.h>
+#include <rtochius/mm.h>
+#include <rtochius/cma.h>
+#include <rtochius/sched.h>
+#include <rtochius/slab.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/syscalls.h>
+#include <rtochius/sysring.h>
 
 #include <uapi/rtochius/mmap.h>
 
 #include <asm/pgtable-prot.h>
+#include <asm/ptrace.h>
+#include <asm/tlbflush.h>
 
 #include <base/cache.h>
+#include <base/common.h>
+#include <base/errno.h>
+#include <base/rbtree.h>
 
 /* description of effects of mapping type and prot in current implementation.
  * this is due to the limited x86 page protection hardware.  The expected
@@ -36,3 +48,262 @@ pgprot_t vm_get_page_prot(unsigned long vm_flags)
 	return __pgprot(pgprot_val(protection_map[vm_flags &
 				(VM_READ|VM_WRITE|VM_EXEC|VM_SHARED)]));
 }
+
+/*
+ * Anonymous memory is mapped by VMAs, kept in the mm_rb tree of their
+ * address space and protected by its mmap_lock. mmap() only records the
+ * VMA, the pages come in on the first access from handle_mm_fault().
+ */
+
+/**
+ * find_vma - the first VMA ending above an address
+ * @mm: the address space, with mmap_lock held
+ * @addr: user virtual address
+ *
+ * Returns NULL if there is none. The VMA may start above @addr.
+ */
+struct vm_area_struct *find_vma(struct mm_struct *mm, unsigned long addr)
+{
+	struct rb_node *node = mm->mm_rb.rb_node;
+	struct vm_area_struct *vma = NULL;
+
+	while (node) {
+		struct vm_area_struct *tmp;
+
+		tmp = rb_entry(node, struct vm_area_struct, vm_rb);
+		if (tmp->vm_end > addr) {
+			vma = tmp;
+			if (tmp->vm_start <= addr)
+				break;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	return vma;
+}
+
+static struct vm_area_struct *vma_next(struct vm_area_struct *vma)
+{
+	struct rb_node *node = rb_next(&vma->vm_rb);
+
+	return node ? rb_entry(node, struct vm_area_struct, vm_rb) : NULL;
+}
+
+/* The caller made sure @vma does not overlap another one. */
+static void vma_link(struct mm_struct *mm, struct vm_area_struct *vma)
+{
+	struct rb_node **p = &mm->mm_rb.rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*p) {
+		parent = *p;
+		if (vma->vm_start <
+		    rb_entry(parent, struct vm_area_struct, vm_rb)->vm_start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&vma->vm_rb, parent, p);
+	rb_insert_color(&vma->vm_rb, &mm->mm_rb);
+}
+
+static void vma_unlink(struct mm_struct *mm, struct vm_area_struct *vma)
+{
+	rb_erase(&vma->vm_rb, &mm->mm_rb);
+	kfree(vma);
+}
+
+/*
+ * Unmap [start, end) from every VMA it covers. Cutting a hole into the
+ * middle of a VMA needs a second one, @spare; returns true if it was
+ * used. Called with mmap_lock held for writing.
+ */
+static bool do_munmap(struct mm_struct *mm, unsigned long start,
+		      unsigned long end, struct vm_area_struct *spare)
+{
+	struct vm_area_struct *vma, *next;
+	bool used = false;
+
+	for (vma = find_vma(mm, start); vma && vma->vm_start < end; vma = next) {
+		unsigned long zstart = max(start, vma->vm_start);
+		unsigned long zend = min(end, vma->vm_end);
+
+		next = vma_next(vma);
+		zap_user_range(vma, zstart, zend);
+
+		if (zstart == vma->vm_start && zend == vma->vm_end) {
+			vma_unlink(mm, vma);
+		} else if (zstart == vma->vm_start) {
+			vma->vm_start = zend;
+		} else if (zend == vma->vm_end) {
+			vma->vm_end = zstart;
+		} else {
+			*spare = *vma;
+			spare->vm_start = zend;
+			vma->vm_end = zstart;
+			vma_link(mm, spare);
+			used = true;
+		}
+	}
+
+	return used;
+}
+
+/**
+ * dup_mmap - copy the VMAs of an address space into a new one
+ * @mm: the new address space from mm_alloc(), not in use yet
+ * @oldmm: the address space to copy
+ *
+ * Private writable memory becomes copy-on-write in both address spaces,
+ * shared memory stays shared. On failure @mm is left without VMAs.
+ *
+ * Returns 0 or -ENOMEM.
+ */
+int dup_mmap(struct mm_struct *mm, struct mm_struct *oldmm)
+{
+	struct vm_area_struct *mpnt, *tmp;
+	struct rb_node *node;
+	int err = 0;
+
+	/* Keeps the faults of @oldmm from taking over the shared pages. */
+	write_lock(&oldmm->mmap_lock);
+	for (node = rb_first(&oldmm->mm_rb); node; node = rb_next(node)) {
+		mpnt = rb_entry(node, struct vm_area_struct, vm_rb);
+
+		tmp = kmalloc(sizeof(*tmp), GFP_KERNEL);
+		if (!tmp) {
+			err = -ENOMEM;
+			break;
+		}
+
+		*tmp = *mpnt;
+		tmp->vm_mm = mm;
+		vma_link(mm, tmp);
+
+		err = copy_page_range(tmp, mpnt);
+		if (err)
+			break;
+	}
+	/* The write protected PTEs of @oldmm. */
+	flush_tlb_mm(oldmm);
+	write_unlock(&oldmm->mmap_lock);
+
+	if (err)
+		exit_mmap(mm);
+
+	return err;
+}
+
+/**
+ * exit_mmap - unmap every VMA, DMA buffer and sysring of an address space
+ * @mm: the address space
+ */
+void exit_mmap(struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+	struct rb_node *node;
+
+	write_lock(&mm->mmap_lock);
+	while ((node = rb_first(&mm->mm_rb))) {
+		vma = rb_entry(node, struct vm_area_struct, vm_rb);
+		zap_user_range(vma, vma->vm_start, vma->vm_end);
+		vma_unlink(mm, vma);
+	}
+	write_unlock(&mm->mmap_lock);
+
+	/* They live outside any VMA. */
+	dma_release_mm(mm);
+	sysring_release_mm(mm);
+}
+
+/**
+ * sys_mmap - map x1 bytes of anonymous memory at the page aligned user
+ * address x0.
+ *
+ * x2 is a mask of PROT_READ, PROT_WRITE and PROT_EXEC, x3 one of
+ * MAP_PRIVATE and MAP_SHARED. Nothing is allocated until the memory is
+ * touched, and then it reads as zeroes. Returns 0, or -EEXIST if the
+ * range overlaps an earlier mmap().
+ */
+asmlinkage long sys_mmap(struct pt_regs *regs)
+{
+	unsigned long addr = regs->regs[0];
+	unsigned long len = PAGE_ALIGN(regs->regs[1]);
+	unsigned long prot = regs->regs[2];
+	unsigned long flags = regs->regs[3];
+	struct mm_struct *mm = current->mm;
+	struct vm_area_struct *vma, *next;
+	unsigned long vm_flags;
+
+	if (!mm || !len || !PAGE_ALIGNED(addr) ||
+	    addr >= TASK_SIZE || len > TASK_SIZE - addr)
+		return -EINVAL;
+
+	if (prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC))
+		return -EINVAL;
+
+	switch (flags) {
+	case MAP_PRIVATE:
+		vm_flags = prot;
+		break;
+	case MAP_SHARED:
+		vm_flags = prot | VM_SHARED;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	vma = kzalloc(sizeof(*vma), GFP_KERNEL);
+	if (!vma)
+		return -ENOMEM;
+
+	vma->vm_start = addr;
+	vma->vm_end = addr + len;
+	vma->vm_mm = mm;
+	vma->vm_flags = vm_flags;
+	vma->vm_page_prot = vm_get_page_prot(vm_flags);
+
+	write_lock(&mm->mmap_lock);
+	next = find_vma(mm, addr);
+	if (next && next->vm_start < addr + len) {
+		write_unlock(&mm->mmap_lock);
+		kfree(vma);
+		return -EEXIST;
+	}
+	vma_link(mm, vma);
+	write_unlock(&mm->mmap_lock);
+
+	return 0;
+}
+
+/**
+ * sys_munmap - unmap the x1 bytes at the page aligned user address x0
+ * and free the memory they faulted in.
+ *
+ * Holes and parts of VMAs are fine.
+ */
+asmlinkage long sys_munmap(struct pt_regs *regs)
+{
+	unsigned long addr = regs->regs[0];
+	unsigned long len = PAGE_ALIGN(regs->regs[1]);
+	struct mm_struct *mm = current->mm;
+	struct vm_area_struct *spare;
+
+	if (!mm || !len || !PAGE_ALIGNED(addr) ||
+	    addr >= TASK_SIZE || len > TASK_SIZE - addr)
+		return -EINVAL;
+
+	spare = kmalloc(sizeof(*spare), GFP_KERNEL);
+	if (!spare)
+		return -ENOMEM;
+
+	write_lock(&mm->mmap_lock);
+	if (!do_munmap(mm, addr, addr + len, spare))
+		kfree(spare);
+	write_unlock(&mm->mmap_lock);
+
+	return 0;
+}
@@ -16,6 +16,8 @@
 
 #include <base/pfn.h>
 #include <base/common.h>
+#include <base/math64.h>
+#include <base/sizes.h>
 
 #include <rtochius/sched.h>
 #include <rtochius/cpumask.h>
@@ -25,9 +27,13 @@
 #include <rtochius/percpu.h>
 #include <rtochius/jiffies.h>
 #include <rtochius/prefetch.h>
+#include <rtochius/param.h>
+#include <rtochius/printf.h>
+#include <rtochius/compaction.h>
 
 #include <asm/sections.h>
 #include <asm/current.h>
+#include <asm/arch_timer.h>
 
 #include "internal.h"
 
@@ -39,7 +45,32 @@ static char * const zone_names[MAX_NR_ZONES] = {
 	"Movable",
 };
 
+/*
+ * Pre-zeroing: idle CPUs clear free order-0 pages ahead of time and keep
+ * them on a per-cpu zero pool, so that __GFP_ZERO allocations do not
+ * have to memset on the spot.
+ */
+struct prezero_stats {
+	/* Pages cleared from the idle loop: */
+	unsigned long		zeroed;
+	/* Order-0 __GFP_ZERO allocations served from the pool or not: */
+	unsigned long		hits;
+	unsigned long		misses;
+};
+
+static DEFINE_PER_CPU(struct prezero_stats, prezero_stats);
+
+static int prezero_disabled;
+
+static int __init setup_noprezero(char *str)
+{
+	prezero_disabled = 1;
+	return 0;
+}
+early_param("noprezero", setup_noprezero);
+
 static void __free_pages_ok(struct page *page, unsigned int order);
+static inline void free_the_page(struct page *page, unsigned int order);
 
 static void bad_page(struct page *page, const char *reason,
 		unsigned long bad_flags)
@@ -82,7 +113,7 @@ out:
 
 void free_compound_page(struct page *page)
 {
-	__free_pages_ok(page, compound_order(page));
+	free_the_page(page, compound_order(page));
 }
 
 static void prep_compound_page(struct page *page, unsigned int order)
@@ -319,72 +350,52 @@ static __always_inline bool free_pages_prepare(struct page *page,
 	return true;
 }
 
-static inline bool free_pcp_prepare(struct page *page)
+static inline bool free_pcp_prepare(struct page *page, unsigned int order)
 {
-	return free_pages_prepare(page, 0, true);
+	return free_pages_prepare(page, order, true);
 }
 
-static inline void prefetch_buddy(struct page *page)
+static inline void prefetch_buddy(struct page *page, unsigned int order)
 {
 	unsigned long pfn = page_to_pfn(page);
-	unsigned long buddy_pfn = __find_buddy_pfn(pfn, 0);
+	unsigned long buddy_pfn = __find_buddy_pfn(pfn, order);
 	struct page *buddy = page + (buddy_pfn - pfn);
 
 	prefetch(buddy);
 }
 
 /*
- * Frees a number of pages from the PCP lists
- * Assumes all pages on list are in same zone, and of same order.
- * count is the number of pages to free.
- *
- * If the zone was previously in an "all pages pinned" state then look to
- * see if this freeing clears that state.
- *
- * And clear the zone's pages_scanned counter, to hold off the "all pages are
- * pinned" detection logic.
+ * Frees a number of blocks from a PCP list
+ * All blocks on the list are in the same zone and of the given order.
+ * count is the number of blocks to free.
  */
 static void free_pcppages_bulk(struct zone *zone, int count,
-					struct per_cpu_pages *pcp)
+			struct per_cpu_pages *pcp, unsigned int order)
 {
-	int batch_free = 0;
 	int prefetch_nr = 0;
+	struct list_head *list = &pcp->lists;
 	struct page *page, *tmp;
 	LIST_HEAD(head);
 
-	while (count) {
-		struct list_head *list;
+	while (count-- && !list_empty(list)) {
+		page = list_last_entry(list, struct page, lru);
+		/* must delete to avoid corrupting pcp list */
+		list_del(&page->lru);
+		pcp->count--;
+
+		list_add_tail(&page->lru, &head);
 
 		/*
-		 * Remove pages from lists in a round-robin fashion. A
-		 * batch_free count is maintained that is incremented when an
-		 * empty list is encountered.  This is so more pages are freed
-		 * off fuller lists instead of spinning excessively around empty
-		 * lists
+		 * We are going to put the page back to the global
+		 * pool, prefetch its buddy to speed up later access
+		 * under zone->lock. It is believed the overhead of
+		 * an additional test and calculating buddy_pfn here
+		 * can be offset by reduced memory latency later. To
+		 * avoid excessive prefetching due to large count, only
+		 * prefetch buddy for the first pcp->batch nr of pages.
 		 */
-		batch_free++;
-		list = &pcp->lists;
-
-		do {
-			page = list_last_entry(list, struct page, lru);
-			/* must delete to avoid corrupting pcp list */
-			list_del(&page->lru);
-			pcp->count--;
-
-			list_add_tail(&page->lru, &head);
-
-			/*
-			 * We are going to put the page back to the global
-			 * pool, prefetch its buddy to speed up later access
-			 * under zone->lock. It is believed the overhead of
-			 * an additional test and calculating buddy_pfn here
-			 * can be offset by reduced memory latency later. To
-			 * avoid excessive prefetching due to large count, only
-			 * prefetch buddy for the first pcp->batch nr of pages.
-			 */
-			if (prefetch_nr++ < pcp->batch)
-				prefetch_buddy(page);
-		} while (--count && --batch_free && !list_empty(list));
+		if (prefetch_nr++ < pcp->batch)
+			prefetch_buddy(page, order);
 	}
 
 	spin_lock(&zone->lock);
@@ -393,7 +404,7 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	 * page->lru.next will not point to original list.
 	 */
 	list_for_each_entry_safe(page, tmp, &head, lru)
-		__free_one_page(page, page_to_pfn(page), zone, 0);
+		__free_one_page(page, page_to_pfn(page), zone, order);
 	spin_unlock(&zone->lock);
 }
 
@@ -458,7 +469,7 @@ static void __free_pages_ok(struct page *page, unsigned int order)
 	local_irq_restore(flags);
 }
 
-static void __init __free_pages_boot_core(struct page *page, unsigned int order)
+static void __free_pages_core(struct page *page, unsigned int order)
 {
 	unsigned int nr_pages = 1 << order;
 	struct page *p = page;
@@ -473,7 +484,6 @@ static void __init __free_pages_boot_core(struct page *page, unsigned int order)
 	__ClearPageReserved(p);
 	set_page_count(p, 0);
 
-	atomic_long_add(nr_pages, &page_zone(page)->managed_pages);
 	set_page_refcounted(page);
 	__free_pages(page, order);
 }
@@ -481,7 +491,8 @@ static void __init __free_pages_boot_core(struct page *page, unsigned int order)
 void __init memblock_free_pages(struct page *page, unsigned long pfn,
 							unsigned int order)
 {
-	return __free_pages_boot_core(page, order);
+	atomic_long_add(1UL << order, &page_zone(page)->managed_pages);
+	__free_pages_core(page, order);
 }
 
 static void __init __free_pages_memory(unsigned long start, unsigned long end)
@@ -500,6 +511,228 @@ static void __init __free_pages_memory(unsigned long start, unsigned long end)
 	}
 }
 
+/*
+ * Deferred memmap init
+ *
+ * Initialising one struct page per page of RAM on the boot CPU alone is
+ * a good part of the boot time of a large machine. Only the first
+ * DEFERRED_BOOT_PAGES of every zone are initialised and freed at boot.
+ * The struct pages of the rest stay as vmemmap_init() zeroed them,
+ * which the buddy allocator never takes for free pages, and every idle
+ * CPU then initialises and frees chunks of them, so the secondaries do
+ * the bulk of the work in parallel. An allocation that finds its zone
+ * empty grows it a chunk at a time on the spot.
+ */
+#define DEFERRED_BOOT_PAGES	(SZ_128M >> PAGE_SHIFT)
+#define DEFERRED_CHUNK_PAGES	MAX_ORDER_NR_PAGES
+#define NR_DEFERRED_RANGES	32
+
+struct deferred_range {
+	/* The first pfn nobody has claimed yet: */
+	unsigned long		next_pfn;
+	unsigned long		end_pfn;
+	enum zone_type		zone;
+};
+
+static struct deferred_range deferred_ranges[NR_DEFERRED_RANGES];
+static unsigned int nr_deferred_ranges;
+static DEFINE_SPINLOCK(deferred_lock);
+
+/* Deferred pages not in the buddy lists yet, claimed or not: */
+static atomic_long_t deferred_pages_left;
+static unsigned long deferred_pages_total;
+
+/* For the report once the last chunk is freed: */
+static u64 deferred_start_cycles;
+static atomic_long_t deferred_busy_cycles;
+static cpumask_t deferred_cpus;
+
+static int deferred_init_disabled;
+
+static int __init setup_nodeferinit(char *str)
+{
+	deferred_init_disabled = 1;
+	return 0;
+}
+early_param("nodeferinit", setup_nodeferinit);
+
+static inline u64 cycles_to_us(u64 cycles)
+{
+	return div_u64(cycles * 1000000, arch_timer_get_cntfrq());
+}
+
+/*
+ * Initialise the struct pages of a free range of @zid for as long as the
+ * boot budget of the zone lasts, and defer the rest of the range.
+ */
+static void __init memmap_init_range(unsigned long start_pfn,
+		unsigned long end_pfn, enum zone_type zid, unsigned long *budget)
+{
+	struct zone *zone = NODE_DATA()->node_zones + zid;
+	unsigned long pfn, boot_end_pfn = end_pfn;
+	struct deferred_range *dr;
+
+	if (start_pfn >= end_pfn)
+		return;
+
+	if (!deferred_init_disabled && end_pfn - start_pfn > *budget &&
+	    nr_deferred_ranges < NR_DEFERRED_RANGES) {
+		/* Aligned, so no buddy block straddles the boundary. */
+		boot_end_pfn = min(ALIGN(start_pfn + *budget, MAX_ORDER_NR_PAGES),
+				   end_pfn);
+	}
+
+	if (boot_end_pfn < end_pfn) {
+		dr = &deferred_ranges[nr_deferred_ranges++];
+		dr->next_pfn = boot_end_pfn;
+		dr->end_pfn = end_pfn;
+		dr->zone = zid;
+
+		/* Managed already, free once initialised. */
+		atomic_long_add(end_pfn - boot_end_pfn, &zone->managed_pages);
+		atomic_long_add(end_pfn - boot_end_pfn, &zone->deferred_pages);
+		atomic_long_add(end_pfn - boot_end_pfn, &deferred_pages_left);
+		deferred_pages_total += end_pfn - boot_end_pfn;
+	}
+
+	*budget -= min(*budget, boot_end_pfn - start_pfn);
+
+	for (pfn = start_pfn; pfn < boot_end_pfn; pfn++)
+		__init_single_page(pfn_to_page(pfn), pfn, zid);
+}
+
+/* Where the part of a free range that memblock_free_all() frees ends. */
+static unsigned long __init deferred_boot_end_pfn(unsigned long start_pfn,
+						  unsigned long end_pfn)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_deferred_ranges; i++) {
+		unsigned long pfn = deferred_ranges[i].next_pfn;
+
+		if (pfn >= start_pfn && pfn < end_pfn)
+			return pfn;
+	}
+
+	return end_pfn;
+}
+
+/*
+ * Claim the next chunk of deferred pages, of @zone or of any zone if
+ * NULL. Returns false if there is none left.
+ */
+static bool deferred_claim_chunk(struct zone *zone, unsigned long *start_pfn,
+				 unsigned long *end_pfn, enum zone_type *zid)
+{
+	struct zone *zones = NODE_DATA()->node_zones;
+	struct deferred_range *dr;
+	unsigned long flags;
+	bool found = false;
+	unsigned int i;
+
+	spin_lock_irqsave(&deferred_lock, flags);
+	for (i = 0; i < nr_deferred_ranges; i++) {
+		dr = &deferred_ranges[i];
+
+		if (dr->next_pfn == dr->end_pfn)
+			continue;
+		if (zone && zones + dr->zone != zone)
+			continue;
+
+		*zid = dr->zone;
+		*start_pfn = dr->next_pfn;
+		*end_pfn = min(ALIGN(dr->next_pfn + 1, DEFERRED_CHUNK_PAGES),
+			       dr->end_pfn);
+		dr->next_pfn = *end_pfn;
+		found = true;
+		break;
+	}
+	spin_unlock_irqrestore(&deferred_lock, flags);
+
+	return found;
+}
+
+static void deferred_free_range(unsigned long start_pfn, unsigned long end_pfn)
+{
+	unsigned int order;
+
+	while (start_pfn < end_pfn) {
+		order = min(MAX_ORDER - 1UL, __ffs(start_pfn));
+
+		while (start_pfn + (1UL << order) > end_pfn)
+			order--;
+
+		__free_pages_core(pfn_to_page(start_pfn), order);
+		start_pfn += 1UL << order;
+	}
+}
+
+/*
+ * Initialise and free one chunk of deferred pages, of @zone or of any
+ * zone if NULL. Returns false if there was nothing left to do.
+ */
+static bool deferred_init_chunk(struct zone *zone)
+{
+	unsigned long start_pfn, end_pfn, pfn, nr_pages;
+	enum zone_type zid;
+	u64 start, now;
+
+	if (likely(!atomic_long_read(&deferred_pages_left)))
+		return false;
+
+	/* deferred_init_zone() spins on chunks in flight, finish fast. */
+	preempt_disable();
+	if (!deferred_claim_chunk(zone, &start_pfn, &end_pfn, &zid)) {
+		preempt_enable();
+		return false;
+	}
+
+	start = arch_counter_get_cntvct();
+
+	for (pfn = start_pfn; pfn < end_pfn; pfn++)
+		__init_single_page(pfn_to_page(pfn), pfn, zid);
+	deferred_free_range(start_pfn, end_pfn);
+
+	now = arch_counter_get_cntvct();
+	atomic_long_add(now - start, &deferred_busy_cycles);
+	cpumask_set_cpu(smp_processor_id(), &deferred_cpus);
+
+	nr_pages = end_pfn - start_pfn;
+	atomic_long_sub(nr_pages, &NODE_DATA()->node_zones[zid].deferred_pages);
+	if (atomic_long_sub_and_test(nr_pages, &deferred_pages_left))
+		pr_info("memmap: %lu deferred pages initialised in %llu us, %llu us of CPU time on %u CPUs\n",
+			deferred_pages_total,
+			cycles_to_us(now - deferred_start_cycles),
+			cycles_to_us(atomic_long_read(&deferred_busy_cycles)),
+			cpumask_weight(&deferred_cpus));
+	preempt_enable();
+
+	return true;
+}
+
+/**
+ * deferred_init_idle - initialise deferred struct pages from the idle loop
+ *
+ * Returns true if a chunk was done, false if there is nothing left.
+ */
+bool deferred_init_idle(void)
+{
+	return deferred_init_chunk(NULL);
+}
+
+/*
+ * Finish the deferred init of @zone, including the chunks other CPUs
+ * are working on, for walkers of the memmap that need every page.
+ */
+void deferred_init_zone(struct zone *zone)
+{
+	while (deferred_init_chunk(zone))
+		;
+
+	while (atomic_long_read(&zone->deferred_pages))
+		cpu_relax();
+}
+
 unsigned long __init memblock_free_all(void)
 {
 	u64 i;
@@ -515,6 +748,7 @@ unsigned long __init memblock_free_all(void)
 		start_pfn = PFN_UP(start);
 		end_pfn = PFN_DOWN(end);
 
+		end_pfn = deferred_boot_end_pfn(start_pfn, end_pfn);
 		if (start_pfn >= end_pfn)
 			continue;
 
@@ -527,6 +761,7 @@ unsigned long __init memblock_free_all(void)
 		start_pfn = PFN_UP(start);
 		end_pfn = PFN_DOWN(end);
 
+		end_pfn = deferred_boot_end_pfn(start_pfn, end_pfn);
 		if (start_pfn >= end_pfn)
 			continue;
 		
@@ -539,6 +774,7 @@ unsigned long __init memblock_free_all(void)
 		start_pfn = PFN_UP(start);
 		end_pfn = PFN_DOWN(end);
 
+		end_pfn = deferred_boot_end_pfn(start_pfn, end_pfn);
 		if (start_pfn >= end_pfn)
 			continue;
 
@@ -616,11 +852,6 @@ static inline int check_new_page(struct page *page)
 	return 1;
 }
 
-static bool check_new_pcp(struct page *page)
-{
-	return check_new_page(page);
-}
-
 static bool check_new_pages(struct page *page, unsigned int order)
 {
 	int i;
@@ -634,6 +865,11 @@ static bool check_new_pages(struct page *page, unsigned int order)
 	return false;
 }
 
+static bool check_new_pcp(struct page *page, unsigned int order)
+{
+	return check_new_pages(page, order);
+}
+
 static inline void post_alloc_hook(struct page *page, unsigned int order,
 				gfp_t gfp_mask)
 {
@@ -729,67 +965,86 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 	return alloced;
 }
 
-static bool free_unref_page_prepare(struct page *page, unsigned long pfn)
+static bool free_unref_page_prepare(struct page *page, unsigned long pfn,
+			unsigned int order)
 {
-	if (!free_pcp_prepare(page))
+	if (!free_pcp_prepare(page, order))
 		return false;
 
 	return true;
 }
 
-static void free_unref_page_commit(struct page *page, unsigned long pfn)
+static void free_unref_page_commit(struct page *page, unsigned long pfn,
+			unsigned int order)
 {
 	struct zone *zone = page_zone(page);
+	struct per_cpu_pageset *pset;
 	struct per_cpu_pages *pcp;
 
-	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	pset = this_cpu_ptr(zone->pageset);
+	pcp = &pset->pcp[order];
+	spin_lock(&pset->lock);
 	list_add(&page->lru, &pcp->lists);
 	pcp->count++;
 	if (pcp->count >= pcp->high) {
 		unsigned long batch = READ_ONCE(pcp->batch);
-		free_pcppages_bulk(zone, batch, pcp);
+		free_pcppages_bulk(zone, batch, pcp, order);
 	}
+	spin_unlock(&pset->lock);
 }
 
 static int drain_pages_zone(int cpu, struct zone *zone)
 {
 	int has_page = 0;
+	unsigned int order;
 	unsigned long flags;
 	struct per_cpu_pageset *pset;
 	struct per_cpu_pages *pcp;
 
 	local_irq_save(flags);
 	pset = per_cpu_ptr(zone->pageset, cpu);
+	/* @cpu may be allocating, freeing or pre-zeroing right now. */
+	spin_lock(&pset->lock);
+
+	/* Zeroed pages are still free pages of order 0. */
+	if (pset->zero_count) {
+		list_splice_init(&pset->zero_list, &pset->pcp[0].lists);
+		pset->pcp[0].count += pset->zero_count;
+		pset->zero_count = 0;
+	}
 
-	pcp = &pset->pcp;
-	if (pcp->count) {
-		has_page = 1;
-		free_pcppages_bulk(zone, pcp->count, pcp);
+	for (order = 0; order < NR_PCP_ORDERS; order++) {
+		pcp = &pset->pcp[order];
+		if (pcp->count) {
+			has_page = 1;
+			free_pcppages_bulk(zone, pcp->count, pcp, order);
+		}
 	}
+	spin_unlock(&pset->lock);
 	local_irq_restore(flags);
 
 	return has_page;
 }
 
 /*
- * Free a 0-order page
+ * Free a block of order up to PAGE_ALLOC_COSTLY_ORDER
  */
-void free_unref_page(struct page *page)
+void free_unref_page(struct page *page, unsigned int order)
 {
 	unsigned long flags;
 	unsigned long pfn = page_to_pfn(page);
 
-	if (!free_unref_page_prepare(page, pfn))
+	if (!free_unref_page_prepare(page, pfn, order))
 		return;
 
 	local_irq_save(flags);
-	free_unref_page_commit(page, pfn);
+	free_unref_page_commit(page, pfn, order);
 	local_irq_restore(flags);
 }
 
-/* Remove page from the per-cpu list, caller must protect the list */
+/* Remove page from the per-cpu list, caller must hold the pageset lock */
 static struct page *__rmqueue_pcplist(struct zone *zone,
-			gfp_t gfp_mask,
+			unsigned int order, gfp_t gfp_mask,
 			struct per_cpu_pages *pcp,
 			struct list_head *list)
 {
@@ -797,7 +1052,7 @@ static struct page *__rmqueue_pcplist(struct zone *zone,
 
 	do {
 		if (list_empty(list)) {
-			pcp->count += rmqueue_bulk(zone, 0,
+			pcp->count += rmqueue_bulk(zone, order,
 					pcp->batch, list, gfp_mask);
 			if (unlikely(list_empty(list)))
 				return NULL;
@@ -806,7 +1061,7 @@ static struct page *__rmqueue_pcplist(struct zone *zone,
 		page = list_first_entry(list, struct page, lru);
 		list_del(&page->lru);
 		pcp->count--;
-	} while (check_new_pcp(page));
+	} while (check_new_pcp(page, order));
 
 	return page;
 }
@@ -815,21 +1070,100 @@ static struct page *__rmqueue_pcplist(struct zone *zone,
 static struct page *rmqueue_pcplist(struct zone *zone,
 			unsigned int order, gfp_t gfp_mask)
 {
+	struct per_cpu_pageset *pset;
 	struct per_cpu_pages *pcp;
 	struct list_head *list;
 	struct page *page;
 	unsigned long flags;
 
 	local_irq_save(flags);
-	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	pset = this_cpu_ptr(zone->pageset);
+	pcp = &pset->pcp[order];
 	list = &pcp->lists;
-	page = __rmqueue_pcplist(zone, gfp_mask, pcp, list);
+	spin_lock(&pset->lock);
+	page = __rmqueue_pcplist(zone, order, gfp_mask, pcp, list);
+	spin_unlock(&pset->lock);
+	local_irq_restore(flags);
+	return page;
+}
+
+/* Take a page from the local zero pool, if it has any */
+static struct page *rmqueue_zeroed(struct zone *zone)
+{
+	struct per_cpu_pageset *pset;
+	struct page *page = NULL;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	pset = this_cpu_ptr(zone->pageset);
+	spin_lock(&pset->lock);
+	if (pset->zero_count) {
+		page = list_first_entry(&pset->zero_list, struct page, lru);
+		list_del(&page->lru);
+		pset->zero_count--;
+	}
+	spin_unlock(&pset->lock);
 	local_irq_restore(flags);
 	return page;
 }
 
+/**
+ * prezero_idle - clear a free page for the zero pool
+ *
+ * Called from the idle loop with interrupts enabled. Moves one page from
+ * the order-0 pcp list of the first zone whose zero pool is below
+ * zero_high to the pool, clearing it with interrupts enabled.
+ *
+ * Returns false if every pool is full and the CPU may go to sleep.
+ */
+bool prezero_idle(void)
+{
+	struct per_cpu_pageset *pset = NULL;
+	struct per_cpu_pages *pcp;
+	struct page *page = NULL;
+	struct zone *zone;
+	enum zone_type i;
+
+	if (prezero_disabled)
+		return false;
+
+	for (i = 0; i < MAX_NR_ZONES && !page; i++) {
+		zone = NODE_DATA()->node_zones + i;
+		if (!zone_managed_pages(zone))
+			continue;
+
+		local_irq_disable();
+		pset = this_cpu_ptr(zone->pageset);
+		spin_lock(&pset->lock);
+		if (pset->zero_count < pset->zero_high) {
+			pcp = &pset->pcp[0];
+			page = __rmqueue_pcplist(zone, 0, GFP_KERNEL,
+						 pcp, &pcp->lists);
+		}
+		spin_unlock(&pset->lock);
+		local_irq_enable();
+	}
+
+	if (!page)
+		return false;
+
+	clear_page(page_address(page));
+
+	/* The idle task never migrates, pset is still ours. */
+	local_irq_disable();
+	spin_lock(&pset->lock);
+	list_add(&page->lru, &pset->zero_list);
+	pset->zero_count++;
+	spin_unlock(&pset->lock);
+	local_irq_enable();
+
+	this_cpu_inc(prezero_stats.zeroed);
+	return true;
+}
+
 /*
- * Allocate a page from the given zone. Use pcplists for order-0 allocations.
+ * Allocate a page from the given zone. Use pcplists for orders up to
+ * PAGE_ALLOC_COSTLY_ORDER.
  */
 static inline
 struct page *rmqueue(struct zone *zone, unsigned int order, gfp_t gfp_mask)
@@ -837,7 +1171,7 @@ struct page *rmqueue(struct zone *zone, unsigned int order, gfp_t gfp_mask)
 	unsigned long flags;
 	struct page *page;
 
-	if (likely(order == 0)) {
+	if (likely(order <= PAGE_ALLOC_COSTLY_ORDER)) {
 		page = rmqueue_pcplist(zone, order, gfp_mask);
 		goto out;
 	}
@@ -872,6 +1206,16 @@ get_page_from_freelist(gfp_t gfp_mask, unsigned int order, const struct alloc_co
 	struct page *page;
 	struct zone *zone = NODE_DATA()->node_zones + ac->zoneidx;
 
+	if (!order && (gfp_mask & __GFP_ZERO)) {
+		page = rmqueue_zeroed(zone);
+		if (page) {
+			this_cpu_inc(prezero_stats.hits);
+			prep_new_page(page, 0, gfp_mask & ~__GFP_ZERO);
+			return page;
+		}
+		this_cpu_inc(prezero_stats.misses);
+	}
+
 retry:
 	page = rmqueue(zone, order, gfp_mask);
 	if (likely(page)) {
@@ -880,6 +1224,15 @@ retry:
 		return page;
 	}
 
+	/* Out of everything else, a zeroed page is still a free page. */
+	if (!order) {
+		page = rmqueue_zeroed(zone);
+		if (page) {
+			prep_new_page(page, 0, gfp_mask & ~__GFP_ZERO);
+			return page;
+		}
+	}
+
 	for_each_online_cpu(cpu) {
 		if (cpu == smp_processor_id())
 			continue;
@@ -906,6 +1259,7 @@ static inline bool prepare_alloc_pages(gfp_t gfp_mask, unsigned int order,
 struct page *__alloc_pages(gfp_t gfp_mask, unsigned int order)
 {
 	struct page *page;
+	struct zone *zone;
 	struct alloc_context ac = { };
 
 	if (unlikely(order >= MAX_ORDER)) {
@@ -918,10 +1272,138 @@ struct page *__alloc_pages(gfp_t gfp_mask, unsigned int order)
 
 	/* First allocation attempt */
 	page = get_page_from_freelist(gfp_mask, order, &ac);
+	if (likely(page))
+		return page;
+
+	/* The zone may still have pages waiting for deferred init. */
+	zone = NODE_DATA()->node_zones + ac.zoneidx;
+	while (deferred_init_chunk(zone)) {
+		page = get_page_from_freelist(gfp_mask, order, &ac);
+		if (page)
+			return page;
+	}
+
+	if (!order)
+		return NULL;
+
+	/*
+	 * Enough memory may be free, just not in one piece. Compact the
+	 * zone if fragmentation is to blame rather than a shortage, and the
+	 * caller said it may take page table locks.
+	 */
+	if (!(gfp_mask & __GFP_COMPACT) || in_interrupt() || irqs_disabled())
+		return NULL;
+
+	if (fragmentation_index(zone, order) <= sysctl_extfrag_threshold)
+		return NULL;
+
+	if (compact_zone(zone, order) > 0)
+		page = get_page_from_freelist(gfp_mask, order, &ac);
 
 	return page;
 }
 
+/**
+ * __alloc_pages_bulk - allocate a number of order-0 pages to a list or array
+ * @gfp_mask: GFP flags for the allocation
+ * @nr_pages: the number of pages wanted on the list or in the array
+ * @page_list: optional list to add the allocated pages to
+ * @page_array: optional array to fill in
+ *
+ * All pages are taken from the local pcp list with interrupts disabled
+ * once, and a list that runs dry is refilled with everything still
+ * missing in a single zone->lock hold instead of batch by batch.
+ *
+ * If @page_array is given, only its NULL entries are filled in, so a
+ * caller can retry with the same array after a partial success.
+ *
+ * Returns the number of pages on the list or in the array, which may be
+ * less than @nr_pages when the zone runs out of memory.
+ */
+unsigned long __alloc_pages_bulk(gfp_t gfp_mask, unsigned long nr_pages,
+			struct list_head *page_list, struct page **page_array)
+{
+	struct zone *zone = NODE_DATA()->node_zones + gfp_zone(gfp_mask);
+	unsigned long i, nr_populated = 0, nr_wanted = 0, nr_account = 0;
+	struct per_cpu_pageset *pset;
+	struct per_cpu_pages *pcp;
+	struct list_head *list;
+	struct page *page;
+	unsigned long flags;
+	LIST_HEAD(new_pages);
+
+	if (page_array) {
+		for (i = 0; i < nr_pages; i++)
+			if (!page_array[i])
+				nr_wanted++;
+		nr_populated = nr_pages - nr_wanted;
+	} else {
+		nr_wanted = nr_pages;
+	}
+
+	if (unlikely(!nr_wanted))
+		return nr_populated;
+
+	local_irq_save(flags);
+	pset = this_cpu_ptr(zone->pageset);
+	pcp = &pset->pcp[0];
+	list = &pcp->lists;
+	spin_lock(&pset->lock);
+
+	while (nr_account < nr_wanted) {
+		if (list_empty(list))
+			pcp->count += rmqueue_bulk(zone, 0,
+					max_t(unsigned long, pcp->batch,
+					      nr_wanted - nr_account),
+					list, gfp_mask);
+
+		page = __rmqueue_pcplist(zone, 0, gfp_mask, pcp, list);
+		if (unlikely(!page))
+			break;
+
+		list_add_tail(&page->lru, &new_pages);
+		nr_account++;
+	}
+
+	/* Whatever a large refill left over goes back to the buddy lists. */
+	if (pcp->count >= pcp->high)
+		free_pcppages_bulk(zone, pcp->count - pcp->high + pcp->batch,
+				   pcp, 0);
+	spin_unlock(&pset->lock);
+	local_irq_restore(flags);
+
+	/*
+	 * Nothing at all on the local CPU, take the regular path which
+	 * also drains the other CPUs' lists.
+	 */
+	if (unlikely(!nr_account)) {
+		page = __alloc_pages(gfp_mask, 0);
+		if (!page)
+			return nr_populated;
+		list_add_tail(&page->lru, &new_pages);
+		nr_account = 1;
+	} else {
+		list_for_each_entry(page, &new_pages, lru)
+			prep_new_page(page, 0, gfp_mask);
+	}
+
+	nr_populated += nr_account;
+	if (page_list) {
+		list_splice_tail(&new_pages, page_list);
+		return nr_populated;
+	}
+
+	for (i = 0; i < nr_pages && !list_empty(&new_pages); i++) {
+		if (page_array[i])
+			continue;
+		page = list_first_entry(&new_pages, struct page, lru);
+		list_del(&page->lru);
+		page_array[i] = page;
+	}
+
+	return nr_populated;
+}
+
 unsigned long __get_free_pages(gfp_t gfp_mask, unsigned int order)
 {
 	struct page *page;
@@ -934,8 +1416,8 @@ unsigned long __get_free_pages(gfp_t gfp_mask, unsigned int order)
 
 static inline void free_the_page(struct page *page, unsigned int order)
 {
-	if (order == 0)		/* Via pcp? */
-		free_unref_page(page);
+	if (order <= PAGE_ALLOC_COSTLY_ORDER)	/* Via pcp? */
+		free_unref_page(page, order);
 	else
 		__free_pages_ok(page, order);
 }
@@ -954,6 +1436,307 @@ void free_pages(unsigned long addr, unsigned int order)
 	}
 }
 
+/*
+ * split_page takes a higher-order page, compound or not, and splits it into
+ * n (1<<order) sub-pages: page[0..n]
+ * Each sub-page must be freed individually.
+ */
+void split_page(struct page *page, unsigned int order)
+{
+	int i;
+
+	BUG_ON(page_ref_count(page) != 1);
+
+	if (PageHead(page)) {
+		set_compound_order(page, 0);
+		__ClearPageHead(page);
+	}
+
+	for (i = 1; i < (1 << order); i++) {
+		clear_compound_head(page + i);
+		set_page_refcounted(page + i);
+	}
+}
+
+/*
+ * The free buddy block @pfn is part of, if it is free. Called with
+ * zone->lock held.
+ */
+static struct page *free_buddy_head(struct zone *zone, unsigned long pfn,
+				    unsigned int *order)
+{
+	unsigned int o;
+
+	for (o = 0; o < MAX_ORDER; o++) {
+		unsigned long head_pfn = pfn & ~((1UL << o) - 1);
+		struct page *head;
+
+		if (!pfn_valid_within(head_pfn))
+			break;
+
+		head = pfn_to_page(head_pfn);
+		if (PageBuddy(head) && page_order(head) >= o &&
+		    page_zone(head) == zone) {
+			*order = page_order(head);
+			return head;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Give [start_pfn, end_pfn) back to the buddy lists in the largest
+ * aligned blocks that fit. Called with zone->lock held.
+ */
+static void __free_pfn_range(struct zone *zone, unsigned long start_pfn,
+			     unsigned long end_pfn)
+{
+	while (start_pfn < end_pfn) {
+		unsigned int order = min_t(unsigned int, MAX_ORDER - 1,
+					   __ffs(start_pfn));
+
+		while (start_pfn + (1UL << order) > end_pfn)
+			order--;
+
+		__free_one_page(pfn_to_page(start_pfn), start_pfn, zone, order);
+		start_pfn += 1UL << order;
+	}
+}
+
+/*
+ * Move the user pages of [start_pfn, end_pfn) to pages outside of it, so
+ * they leave free pages behind. Nothing is moved unless every page of the
+ * range is free or movable already. Spins on page table locks, the caller
+ * must not hold a spinlock.
+ *
+ * Returns -EBUSY if some page is neither, or could not be moved.
+ */
+static int evacuate_contig_range(struct zone *zone, unsigned long start_pfn,
+				 unsigned long end_pfn)
+{
+	struct page *page, *newpage;
+	unsigned long pfn, flags;
+	unsigned int order;
+	int err;
+
+	spin_lock_irqsave(&zone->lock, flags);
+	for (pfn = start_pfn; pfn < end_pfn; pfn++) {
+		if (free_buddy_head(zone, pfn, &order))
+			continue;
+		if (!PageMovable(pfn_to_page(pfn))) {
+			spin_unlock_irqrestore(&zone->lock, flags);
+			return -EBUSY;
+		}
+	}
+	spin_unlock_irqrestore(&zone->lock, flags);
+
+	for (pfn = start_pfn; pfn < end_pfn; pfn++) {
+		page = pfn_to_page(pfn);
+		if (!PageMovable(page) || !get_page_unless_zero(page))
+			continue;
+
+		/* Same as compaction: clearing the flag isolates the page. */
+		if (!TestClearPageMovable(page)) {
+			put_page(page);
+			continue;
+		}
+
+		/* Outside ZONE_MOVABLE, so never back into a CMA area. */
+		newpage = alloc_page(GFP_KERNEL | __GFP_NOWARN);
+		err = newpage ? migrate_user_page(page, newpage) : -ENOMEM;
+		if (err) {
+			if (newpage)
+				__free_page(newpage);
+			SetPageMovable(page);
+			put_page(page);
+			return -EBUSY;
+		}
+
+		/* Frees the old page. */
+		put_page(page);
+	}
+
+	return 0;
+}
+
+/**
+ * alloc_contig_range - take a range of free pages out of the buddy lists
+ * @start_pfn: first pfn of the range
+ * @end_pfn: one past the last pfn of the range
+ *
+ * The range must be within one zone. The per-cpu lists and zero pools of
+ * the zone are evacuated first, so pages cached there count as free, and
+ * movable user pages are migrated out of the range. Free blocks that
+ * straddle the range are split and the parts outside go straight back.
+ *
+ * On success every page of the range is a separate order-0 page with a
+ * reference count of one, to be given back with free_contig_range().
+ * Returns -EBUSY if some page of the range is in use and can't be moved.
+ * Must not be called with a spinlock held.
+ */
+int alloc_contig_range(unsigned long start_pfn, unsigned long end_pfn)
+{
+	struct zone *zone = page_zone(pfn_to_page(start_pfn));
+	unsigned long pfn, flags;
+	unsigned int order;
+	struct page *head;
+	int err;
+
+	deferred_init_zone(zone);
+	drain_all_pages(zone);
+
+	err = evacuate_contig_range(zone, start_pfn, end_pfn);
+	if (err)
+		return err;
+	/* The pages left behind went to this CPU's pcp lists. */
+	drain_all_pages(zone);
+
+	spin_lock_irqsave(&zone->lock, flags);
+
+	for (pfn = start_pfn; pfn < end_pfn; ) {
+		head = free_buddy_head(zone, pfn, &order);
+		if (!head) {
+			spin_unlock_irqrestore(&zone->lock, flags);
+			return -EBUSY;
+		}
+		pfn = page_to_pfn(head) + (1UL << order);
+	}
+
+	for (pfn = start_pfn; pfn < end_pfn; ) {
+		unsigned long head_pfn, head_end;
+
+		head = free_buddy_head(zone, pfn, &order);
+		head_pfn = page_to_pfn(head);
+		head_end = head_pfn + (1UL << order);
+
+		list_del(&head->lru);
+		zone->free_area[order].nr_free--;
+		rmv_page_order(head);
+
+		if (head_pfn < start_pfn)
+			__free_pfn_range(zone, head_pfn, start_pfn);
+		if (head_end > end_pfn)
+			__free_pfn_range(zone, end_pfn, head_end);
+
+		pfn = head_end;
+	}
+
+	spin_unlock_irqrestore(&zone->lock, flags);
+
+	for (pfn = start_pfn; pfn < end_pfn; pfn++)
+		post_alloc_hook(pfn_to_page(pfn), 0, 0);
+
+	return 0;
+}
+
+void free_contig_range(unsigned long pfn, unsigned long nr_pages)
+{
+	for (; nr_pages--; pfn++)
+		__free_page(pfn_to_page(pfn));
+}
+
+/*
+ * Evacuate the per-cpu lists and zero pools of every CPU for @zone, so
+ * all its free pages are on the buddy lists.
+ */
+void drain_all_pages(struct zone *zone)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		drain_pages_zone(cpu, zone);
+}
+
+/**
+ * isolate_free_pages - take the free blocks of a pfn range for migration
+ * @zone: the zone of the range
+ * @start_pfn: first pfn of the range
+ * @end_pfn: one past the last pfn of the range
+ * @freelist: list to add the isolated pages to
+ *
+ * Only buddy blocks lying entirely within the range are taken. They are
+ * split into order-0 pages with a reference count of one each.
+ *
+ * Returns the number of pages added to @freelist.
+ */
+unsigned long isolate_free_pages(struct zone *zone, unsigned long start_pfn,
+				 unsigned long end_pfn, struct list_head *freelist)
+{
+	unsigned long pfn, flags, nr_isolated = 0;
+	unsigned int order, i;
+	struct page *page;
+
+	spin_lock_irqsave(&zone->lock, flags);
+
+	for (pfn = start_pfn; pfn < end_pfn; pfn++) {
+		if (!pfn_valid_within(pfn))
+			continue;
+
+		page = pfn_to_page(pfn);
+		if (!PageBuddy(page) || page_zone(page) != zone)
+			continue;
+
+		order = page_order(page);
+		if (pfn + (1UL << order) > end_pfn)
+			break;
+
+		list_del(&page->lru);
+		zone->free_area[order].nr_free--;
+		rmv_page_order(page);
+
+		for (i = 0; i < (1U << order); i++) {
+			post_alloc_hook(page + i, 0, 0);
+			list_add_tail(&page[i].lru, freelist);
+		}
+
+		nr_isolated += 1UL << order;
+		pfn += (1UL << order) - 1;
+	}
+
+	spin_unlock_irqrestore(&zone->lock, flags);
+
+	return nr_isolated;
+}
+
+/*
+ * Index of 0 means the allocation would fail due to lack of memory,
+ * values towards 1000 mean failure is due to fragmentation. A
+ * fragmentation_index() above this threshold is worth compacting for.
+ */
+int sysctl_extfrag_threshold = 500;
+
+/**
+ * fragmentation_index - why an allocation of @order would fail
+ * @zone: the zone
+ * @order: the order of the allocation
+ *
+ * Returns -1000 if a free block of @order or larger exists, a value
+ * towards 0 if the zone is short of free memory and a value towards
+ * 1000 if enough memory is free but scattered over small blocks.
+ */
+int fragmentation_index(struct zone *zone, unsigned int order)
+{
+	unsigned long requested = 1UL << order;
+	unsigned long free_pages = 0, free_blocks = 0;
+	unsigned int o;
+
+	for_each_order(o) {
+		unsigned long nr_free = READ_ONCE(zone->free_area[o].nr_free);
+
+		if (o >= order && nr_free)
+			return -1000;
+
+		free_blocks += nr_free;
+		free_pages += nr_free << o;
+	}
+
+	if (!free_blocks)
+		return 0;
+
+	return 1000 - (1000 + free_pages * 1000 / requested) / free_blocks;
+}
+
 static void __init zone_init_free_lists(struct zone *zone)
 {
 	unsigned long order;
@@ -966,12 +1749,14 @@ static void __init zone_init_free_lists(struct zone *zone)
 
 static void __init pageset_init(struct per_cpu_pageset *p)
 {
-	struct per_cpu_pages *pcp;
+	unsigned int order;
 
 	memset(p, 0, sizeof(*p));
 
-	pcp = &p->pcp;
-	INIT_LIST_HEAD(&pcp->lists);
+	spin_lock_init(&p->lock);
+	for (order = 0; order < NR_PCP_ORDERS; order++)
+		INIT_LIST_HEAD(&p->pcp[order].lists);
+	INIT_LIST_HEAD(&p->zero_list);
 }
 
 /*
@@ -1001,10 +1786,25 @@ static void __init pageset_update(struct per_cpu_pages *pcp, unsigned long high,
 	pcp->batch = batch;
 }
 
-/* a companion to pageset_set_high() */
+/*
+ * a companion to pageset_set_high()
+ *
+ * @batch is in pages. Every order moves about the same number of pages
+ * per refill or drain, so the higher orders cache fewer but larger
+ * blocks and no list can pin more than 6 * batch pages of the zone.
+ */
 static void __init pageset_set_batch(struct per_cpu_pageset *p, unsigned long batch)
 {
-	pageset_update(&p->pcp, 6 * batch, max(1UL, 1 * batch));
+	unsigned int order;
+
+	for (order = 0; order < NR_PCP_ORDERS; order++) {
+		unsigned long b = max(1UL, batch >> order);
+
+		pageset_update(&p->pcp[order], 6 * b, b);
+	}
+
+	/* The zero pool holds one refill worth of order-0 pages. */
+	p->zero_high = max(1UL, batch);
 }
 
 static int __init zone_batchsize(struct zone *zone)
@@ -1069,7 +1869,8 @@ static void __init free_area_init_node(phys_addr_t node_start_pfn)
 	phys_addr_t start_pfn, end_pfn;
 	enum zone_type j;
 	struct zone *zone;
-	phys_addr_t min_pfn = ULONG_MAX;
+	phys_addr_t min_pfn = ULONG_MAX, max_pfn = 0;
+	unsigned long budget;
 	pg_data_t *pgdat = NODE_DATA();
 	struct page *page;
 
@@ -1094,66 +1895,65 @@ static void __init free_area_init_node(phys_addr_t node_start_pfn)
 		zone->zone_pgdat = pgdat;
 		zone->name = zone_names[j];
 		atomic_long_set(&zone->managed_pages, 0);
+		atomic_long_set(&zone->deferred_pages, 0);
 		spin_lock_init(&zone->lock);
 		zone_init_free_lists(zone);
 	}
 
 	zone = pgdat->node_zones + ZONE_DMA;
 	zone->zone_start_pfn = 0;
+	budget = DEFERRED_BOOT_PAGES;
 	for_each_free_mem_range(&memblock_kernel, i, MEMBLOCK_DMA,
 					&start_pfn, &end_pfn) {
-		phys_addr_t pfn;
-
 		start_pfn = PFN_UP(start_pfn);
 		end_pfn = PFN_DOWN(end_pfn);
 
 		min_pfn = min(min_pfn, start_pfn);
-		for (pfn = start_pfn; pfn < end_pfn; pfn++) {
-			page = pfn_to_page(pfn);
-			__init_single_page(page, pfn, ZONE_DMA);
-		}
+		max_pfn = max(max_pfn, end_pfn);
+		memmap_init_range(start_pfn, end_pfn, ZONE_DMA, &budget);
 	}
-	if (min_pfn != ULONG_MAX)
+	if (min_pfn != ULONG_MAX) {
 		zone->zone_start_pfn = min_pfn;
+		zone->spanned_pages = max_pfn - min_pfn;
+	}
 	zone->initialized = 1;
 
 	zone = pgdat->node_zones + ZONE_MOVABLE;
 	min_pfn = ULONG_MAX;
+	max_pfn = 0;
+	budget = DEFERRED_BOOT_PAGES;
 	for_each_free_mem_range(&memblock_kernel, i, MEMBLOCK_MOVABLE,
 					&start_pfn, &end_pfn) {
-		phys_addr_t pfn;
-
 		start_pfn = PFN_UP(start_pfn);
 		end_pfn = PFN_DOWN(end_pfn);
 
 		min_pfn = min(min_pfn, start_pfn);
-		for (pfn = start_pfn; pfn < end_pfn; pfn++) {
-			page = pfn_to_page(pfn);
-			__init_single_page(page, pfn, ZONE_MOVABLE);
-		}
+		max_pfn = max(max_pfn, end_pfn);
+		memmap_init_range(start_pfn, end_pfn, ZONE_MOVABLE, &budget);
 	}
-	if (min_pfn != ULONG_MAX)
+	if (min_pfn != ULONG_MAX) {
 		zone->zone_start_pfn = min_pfn;
+		zone->spanned_pages = max_pfn - min_pfn;
+	}
 	zone->initialized = 1;
 
 	zone = pgdat->node_zones + ZONE_NORMAL;
 	min_pfn = ULONG_MAX;
+	max_pfn = 0;
+	budget = DEFERRED_BOOT_PAGES;
 	for_each_free_mem_range(&memblock_kernel, i, MEMBLOCK_NONE,
 					&start_pfn, &end_pfn) {
-		phys_addr_t pfn;
-
 		start_pfn = PFN_UP(start_pfn);
 		end_pfn = PFN_DOWN(end_pfn);
 
 		min_pfn = min(min_pfn, start_pfn);
-
-		for (pfn = start_pfn; pfn < end_pfn; pfn++) {
-			page = pfn_to_page(pfn);
-			__init_single_page(page, pfn, ZONE_NORMAL);
-		}
+		max_pfn = max(max_pfn, end_pfn);
+		memmap_init_range(start_pfn, end_pfn, ZONE_NORMAL, &budget);
 	}
-	if (min_pfn != ULONG_MAX)
+	if (min_pfn != ULONG_MAX) {
 		zone->zone_start_pfn = min_pfn;
+		zone->spanned_pages = max_pfn - min_pfn;
+	}
 	zone->initialized = 1;
 
 	for_each_reserved_mem_region(&memblock_kernel, i, &start_pfn, &end_pfn) {
@@ -1193,7 +1993,7 @@ void __init free_area_init_nodes(void)
 	phys_addr_t start_pfn, end_pfn;
 	int i, has_zone;
 	struct zone *zone;
-	u64 j;
+	u64 j, start;
 
 	total_physpages = 0;
 	/* Print out the early node map */
@@ -1254,9 +2054,14 @@ void __init free_area_init_nodes(void)
 	if (!has_zone)
 		pr_info("  %-8s empty\n", zone_names[ZONE_MOVABLE]);
 
-	free_area_init_node(find_min_pfn_for_mem());
+	start = arch_counter_get_cntvct();
 
+	free_area_init_node(find_min_pfn_for_mem());
 	memblock_free_all();
+
+	deferred_start_cycles = arch_counter_get_cntvct();
+	pr_info("memmap: boot CPU initialised its share in %llu us, %lu pages deferred\n",
+		cycles_to_us(deferred_start_cycles - start), deferred_pages_total);
 }
 
 static inline void free_reserved_page(struct page *page)
@@ -1376,13 +2181,25 @@ unsigned long nr_free_pages(void)
 	return nr_free;
 }
 
+static unsigned long pageset_nr_pages(struct per_cpu_pageset *p)
+{
+	unsigned int order;
+	unsigned long nr_pages = 0;
+
+	for (order = 0; order < NR_PCP_ORDERS; order++)
+		nr_pages += (unsigned long)READ_ONCE(p->pcp[order].count) << order;
+	nr_pages += READ_ONCE(p->zero_count);
+
+	return nr_pages;
+}
+
 unsigned long nr_zone_percpu_cache_pages(struct zone *zone)
 {
 	int cpu;
 	unsigned long total_pages = 0;
 
 	for_each_possible_cpu(cpu)
-		total_pages += per_cpu_ptr(zone->pageset, cpu)->pcp.count;
+		total_pages += pageset_nr_pages(per_cpu_ptr(zone->pageset, cpu));
 
 	return total_pages;
 }
@@ -1395,8 +2212,21 @@ unsigned long nr_percpu_cache_pages(int cpu)
 
 	for (i = 0; i < MAX_NR_ZONES; i++) {
 		zone = NODE_DATA()->node_zones + i;
-		total_pages += per_cpu_ptr(zone->pageset, cpu)->pcp.count;
+		total_pages += pageset_nr_pages(per_cpu_ptr(zone->pageset, cpu));
 	}
 
 	return total_pages;
 }
+
+void show_page_alloc_stats(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct prezero_stats *st = per_cpu_ptr(&prezero_stats, cpu);
+
+		pr_info("CPU%d: pcp pages %lu prezeroed %lu zero pool hits %lu misses %lu\n",
+			cpu, nr_percpu_cache_pages(cpu), st->zeroed,
+			st->hits, st->misses);
+	}
+}
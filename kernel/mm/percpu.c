@@ -1,4 +1,3 @@
-
 /*
  * Generic SMP percpu area setup.
  *
@@ -10,34 +9,408 @@
  * generally a good idea TLB-wise because percpu area can piggy back
  * on the physical linear memory mapping which uses large page
  * mappings on applicable archs.
+ *
+ * Dynamic allocation
+ *
+ * Percpu memory comes in chunks. A chunk holds one unit per possible
+ * cpu, all of pcpu_unit_size bytes and laid out back to back, so an
+ * object lives at the same offset in every unit and a single percpu
+ * pointer, offset by __per_cpu_offset[cpu], reaches every copy.
+ *
+ * The first chunk is the one set up at boot in the linear map: the
+ * static .data..percpu section sits at the start of each unit and the
+ * rest is left for alloc_percpu(), which is enough for everything done
+ * before vmalloc is up. Further chunks are vmalloc()ed with the same
+ * layout.
+ *
+ * Each chunk has a bitmap with one bit per PCPU_MIN_ALLOC_SIZE bytes of
+ * a unit for the space in use, and a bound map marking where the
+ * allocations start and end so that free_percpu() knows their size.
  */
 #define pr_fmt(fmt) "percpu: " fmt
 
 #include <base/init.h>
+#include <base/common.h>
+#include <base/bitmap.h>
+#include <base/list.h>
+#include <base/log2.h>
 
 #include <rtochius/cpumask.h>
 #include <rtochius/percpu.h>
 #include <rtochius/threads.h>
 #include <rtochius/memory.h>
+#include <rtochius/slab.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/vmalloc.h>
+#include <rtochius/printf.h>
 
 #include <asm/cache.h>
 #include <asm/sections.h>
 
+/* Granularity of the allocation bitmaps: */
+#define PCPU_MIN_ALLOC_SIZE	4
+
 unsigned long __per_cpu_offset[NR_CPUS] __read_mostly;
 
+struct pcpu_chunk {
+	struct list_head	list;
+	void			*base_addr;	/* unit 0 */
+
+	int			free_bytes;
+	/* Upper bound of the largest free area: */
+	int			contig_hint;
+	/* No free bit below this one: */
+	int			first_free;
+	int			nr_alloc;
+
+	unsigned long		*alloc_map;
+	unsigned long		*bound_map;
+};
+
+static void *pcpu_base_addr __read_mostly;
+static size_t pcpu_unit_size __read_mostly;
+static int pcpu_unit_bits __read_mostly;
+static unsigned int pcpu_nr_units __read_mostly;
+
+static struct pcpu_chunk pcpu_first_chunk;
+
+/* Protects the chunk list and the chunks' maps: */
+static DEFINE_SPINLOCK(pcpu_lock);
+static LIST_HEAD(pcpu_chunks);
+static int pcpu_nr_chunks;
+static int pcpu_nr_empty_chunks;
+
+static unsigned long pcpu_nr_allocs;
+static unsigned long pcpu_nr_frees;
+static unsigned long pcpu_nr_fails;
+
+/*
+ * Percpu pointers are unit 0 addresses offset back to the static
+ * section, for __per_cpu_offset[] to apply to them.
+ */
+static void __percpu *pcpu_addr_to_ptr(void *addr)
+{
+	return (void __percpu *)((unsigned long)addr -
+				 (unsigned long)pcpu_base_addr +
+				 (unsigned long)__per_cpu_load);
+}
+
+static void *pcpu_ptr_to_addr(void __percpu *ptr)
+{
+	return (void *)((unsigned long)ptr + (unsigned long)pcpu_base_addr -
+			(unsigned long)__per_cpu_load);
+}
+
+static struct pcpu_chunk *pcpu_addr_to_chunk(void *addr)
+{
+	struct pcpu_chunk *chunk;
+
+	list_for_each_entry(chunk, &pcpu_chunks, list)
+		if (addr >= chunk->base_addr &&
+		    addr < chunk->base_addr + pcpu_unit_size)
+			return chunk;
+
+	return NULL;
+}
+
+static void pcpu_mark_alloc(struct pcpu_chunk *chunk, int bit_off, int bits)
+{
+	bitmap_set(chunk->alloc_map, bit_off, bits);
+	set_bit(bit_off, chunk->bound_map);
+	bitmap_clear(chunk->bound_map, bit_off + 1, bits - 1);
+	set_bit(bit_off + bits, chunk->bound_map);
+
+	chunk->free_bytes -= bits * PCPU_MIN_ALLOC_SIZE;
+	chunk->nr_alloc++;
+
+	if (bit_off == chunk->first_free)
+		chunk->first_free = find_next_zero_bit(chunk->alloc_map,
+						       pcpu_unit_bits,
+						       bit_off + bits);
+}
+
+/*
+ * Find room for @bits bits aligned to @align_mask + 1 in @chunk. Returns
+ * the first bit, or -1. An unaligned request that does not fit lowers
+ * the contig hint, so the next one this size or larger skips the chunk
+ * right away.
+ */
+static int pcpu_alloc_area(struct pcpu_chunk *chunk, int bits,
+			   unsigned long align_mask)
+{
+	unsigned long bit_off;
+
+	if (min(chunk->free_bytes, chunk->contig_hint) <
+	    bits * PCPU_MIN_ALLOC_SIZE)
+		return -1;
+
+	bit_off = bitmap_find_next_zero_area(chunk->alloc_map, pcpu_unit_bits,
+					     chunk->first_free, bits,
+					     align_mask);
+	if (bit_off >= pcpu_unit_bits) {
+		if (!align_mask)
+			chunk->contig_hint = (bits - 1) * PCPU_MIN_ALLOC_SIZE;
+		return -1;
+	}
+
+	pcpu_mark_alloc(chunk, bit_off, bits);
+
+	return bit_off;
+}
+
+static void pcpu_free_area(struct pcpu_chunk *chunk, int bit_off)
+{
+	int bits, end;
+
+	end = find_next_bit(chunk->bound_map, pcpu_unit_bits + 1, bit_off + 1);
+	bits = end - bit_off;
+
+	/*
+	 * The start bit stays set in bound_map: it is also the end bit of
+	 * the area below, if there is one.
+	 */
+	bitmap_clear(chunk->alloc_map, bit_off, bits);
+
+	chunk->free_bytes += bits * PCPU_MIN_ALLOC_SIZE;
+	chunk->contig_hint = chunk->free_bytes;
+	chunk->first_free = min(chunk->first_free, bit_off);
+	chunk->nr_alloc--;
+}
+
+static void pcpu_destroy_chunk(struct pcpu_chunk *chunk)
+{
+	if (!chunk)
+		return;
+
+	vfree(chunk->base_addr);
+	kfree(chunk->bound_map);
+	kfree(chunk->alloc_map);
+	kfree(chunk);
+}
+
+static struct pcpu_chunk *pcpu_create_chunk(void)
+{
+	struct pcpu_chunk *chunk;
+
+	/* The first chunk has to do until then. */
+	if (!slab_is_available())
+		return NULL;
+
+	chunk = kzalloc(sizeof(*chunk), GFP_KERNEL);
+	if (!chunk)
+		return NULL;
+
+	chunk->alloc_map = kzalloc(BITS_TO_LONGS(pcpu_unit_bits) *
+				   sizeof(long), GFP_KERNEL);
+	chunk->bound_map = kzalloc(BITS_TO_LONGS(pcpu_unit_bits + 1) *
+				   sizeof(long), GFP_KERNEL);
+	chunk->base_addr = vzalloc(pcpu_nr_units * pcpu_unit_size);
+	if (!chunk->alloc_map || !chunk->bound_map || !chunk->base_addr) {
+		pcpu_destroy_chunk(chunk);
+		return NULL;
+	}
+
+	INIT_LIST_HEAD(&chunk->list);
+	chunk->free_bytes = pcpu_unit_size;
+	chunk->contig_hint = pcpu_unit_size;
+
+	return chunk;
+}
+
+/**
+ * __alloc_percpu - allocate dynamic percpu area
+ * @size: size of area to allocate in bytes
+ * @align: alignment of area (max PAGE_SIZE)
+ *
+ * Allocate zero-filled percpu area of @size bytes aligned at @align.
+ * Returns the percpu pointer on success, NULL on failure.
+ */
+void __percpu *__alloc_percpu(size_t size, size_t align)
+{
+	unsigned long align_mask, flags;
+	struct pcpu_chunk *chunk, *new = NULL;
+	int bits, bit_off = -1;
+	void __percpu *ptr;
+	unsigned int cpu;
+
+	if (align < PCPU_MIN_ALLOC_SIZE)
+		align = PCPU_MIN_ALLOC_SIZE;
+
+	if (unlikely(!size || size > pcpu_unit_size || align > PAGE_SIZE ||
+		     !is_power_of_2(align))) {
+		WARN(true, "illegal size (%zu) or align (%zu) for percpu allocation\n",
+		     size, align);
+		return NULL;
+	}
+
+	bits = DIV_ROUND_UP(size, PCPU_MIN_ALLOC_SIZE);
+	align_mask = align / PCPU_MIN_ALLOC_SIZE - 1;
+
+	for (;;) {
+		spin_lock_irqsave(&pcpu_lock, flags);
+
+		if (new) {
+			list_add_tail(&new->list, &pcpu_chunks);
+			pcpu_nr_chunks++;
+			pcpu_nr_empty_chunks++;
+			new = NULL;
+		}
+
+		list_for_each_entry(chunk, &pcpu_chunks, list) {
+			bool empty = !chunk->nr_alloc;
+
+			bit_off = pcpu_alloc_area(chunk, bits, align_mask);
+			if (bit_off >= 0) {
+				if (empty)
+					pcpu_nr_empty_chunks--;
+				break;
+			}
+		}
+
+		if (bit_off >= 0)
+			pcpu_nr_allocs++;
+		spin_unlock_irqrestore(&pcpu_lock, flags);
+
+		if (bit_off >= 0)
+			break;
+
+		/* Everything is full, grow and try again. */
+		new = pcpu_create_chunk();
+		if (!new) {
+			spin_lock_irqsave(&pcpu_lock, flags);
+			pcpu_nr_fails++;
+			spin_unlock_irqrestore(&pcpu_lock, flags);
+			break;
+		}
+	}
+
+	if (bit_off < 0) {
+		pr_warn("allocation failed, size=%zu align=%zu\n", size, align);
+		return NULL;
+	}
+
+	ptr = pcpu_addr_to_ptr(chunk->base_addr +
+			       bit_off * PCPU_MIN_ALLOC_SIZE);
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(ptr, cpu), 0, size);
+
+	return ptr;
+}
+
+/**
+ * free_percpu - free percpu area
+ * @ptr: pointer to area to free
+ *
+ * Free percpu area @ptr. A chunk left empty is given back unless it is
+ * the first one or the only empty one.
+ */
+void free_percpu(void __percpu *ptr)
+{
+	struct pcpu_chunk *chunk, *dead = NULL;
+	unsigned long flags;
+	void *addr;
+
+	if (!ptr)
+		return;
+
+	addr = pcpu_ptr_to_addr(ptr);
+
+	spin_lock_irqsave(&pcpu_lock, flags);
+
+	chunk = pcpu_addr_to_chunk(addr);
+	if (WARN(!chunk, "freeing unknown percpu area %p\n", ptr)) {
+		spin_unlock_irqrestore(&pcpu_lock, flags);
+		return;
+	}
+
+	pcpu_free_area(chunk, (addr - chunk->base_addr) / PCPU_MIN_ALLOC_SIZE);
+	pcpu_nr_frees++;
+
+	if (!chunk->nr_alloc) {
+		if (chunk != &pcpu_first_chunk && pcpu_nr_empty_chunks) {
+			list_del(&chunk->list);
+			pcpu_nr_chunks--;
+			dead = chunk;
+		} else {
+			pcpu_nr_empty_chunks++;
+		}
+	}
+
+	spin_unlock_irqrestore(&pcpu_lock, flags);
+
+	pcpu_destroy_chunk(dead);
+}
+
 void __init setup_per_cpu_areas(void)
 {
-	void *alloc_ptr;
-	unsigned long delta = __per_cpu_end - __per_cpu_load;
+	size_t static_size = __per_cpu_end - __per_cpu_load;
+	struct pcpu_chunk *chunk = &pcpu_first_chunk;
+	int static_bits;
 	unsigned int cpu;
-	unsigned long offset;
+	void *unit;
+
+	pcpu_unit_size = PAGE_ALIGN(static_size + PERCPU_DYNAMIC_RESERVE);
+	pcpu_unit_size = max_t(size_t, pcpu_unit_size, PCPU_MIN_UNIT_SIZE);
+	pcpu_unit_bits = pcpu_unit_size / PCPU_MIN_ALLOC_SIZE;
+	pcpu_nr_units = nr_cpu_ids;
+
+	pcpu_base_addr = memblock_alloc_virt(&memblock_kernel,
+					     pcpu_nr_units * pcpu_unit_size,
+					     PAGE_SIZE);
+	if (!pcpu_base_addr)
+		panic("percpu alloc failed!\n");
 
 	for_each_possible_cpu(cpu) {
-		alloc_ptr = memblock_alloc_virt(&memblock_kernel, delta, SMP_CACHE_BYTES);
-		if (!alloc_ptr)
-			panic("percpu alloc failed!\n");
-		offset = (unsigned long)alloc_ptr - (unsigned long)__per_cpu_load;
-		memcpy(alloc_ptr, __per_cpu_load, delta);
-		__per_cpu_offset[cpu] = offset;
+		unit = pcpu_base_addr + cpu * pcpu_unit_size;
+		memcpy(unit, __per_cpu_load, static_size);
+		__per_cpu_offset[cpu] = (unsigned long)unit -
+					(unsigned long)__per_cpu_load;
 	}
+
+	chunk->alloc_map = memblock_calloc_virt(&memblock_kernel,
+				BITS_TO_LONGS(pcpu_unit_bits), sizeof(long),
+				SMP_CACHE_BYTES);
+	chunk->bound_map = memblock_calloc_virt(&memblock_kernel,
+				BITS_TO_LONGS(pcpu_unit_bits + 1), sizeof(long),
+				SMP_CACHE_BYTES);
+	if (!chunk->alloc_map || !chunk->bound_map)
+		panic("percpu alloc failed!\n");
+
+	INIT_LIST_HEAD(&chunk->list);
+	chunk->base_addr = pcpu_base_addr;
+	chunk->free_bytes = pcpu_unit_size;
+	chunk->contig_hint = pcpu_unit_size;
+
+	/* The static section is one allocation that is never freed. */
+	static_bits = DIV_ROUND_UP(static_size, PCPU_MIN_ALLOC_SIZE);
+	if (static_bits)
+		pcpu_mark_alloc(chunk, 0, static_bits);
+
+	list_add(&chunk->list, &pcpu_chunks);
+	pcpu_nr_chunks = 1;
+
+	pr_info("Embedded %zu pages/cpu s%zu d%zu u%zu\n",
+		pcpu_unit_size >> PAGE_SHIFT, static_size,
+		pcpu_unit_size - static_bits * PCPU_MIN_ALLOC_SIZE,
+		pcpu_unit_size);
+}
+
+void show_percpu_stats(void)
+{
+	struct pcpu_chunk *chunk;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pcpu_lock, flags);
+
+	pr_info("units %u of %zu bytes, chunks %d empty %d, allocs %lu frees %lu fails %lu\n",
+		pcpu_nr_units, pcpu_unit_size, pcpu_nr_chunks,
+		pcpu_nr_empty_chunks, pcpu_nr_allocs, pcpu_nr_frees,
+		pcpu_nr_fails);
+
+	list_for_each_entry(chunk, &pcpu_chunks, list)
+		pr_info("chunk %p: areas %d free %d\n", chunk->base_addr,
+			chunk->nr_alloc, chunk->free_bytes);
+
+	spin_unlock_irqrestore(&pcpu_lock, flags);
 }
@@ -5,12 +5,20 @@
  * The allocator synchronizes using per slab locks and only
  * uses a centralized lock to manage a pool of partial slabs.
  *
+ * The per cpu freelist is lockless: the fast paths pop and push objects
+ * with a cmpxchg_double() of the freelist pointer and a transaction id
+ * and only keep preemption off. Anything that changes the cpu slab
+ * behind their back - the slow paths with interrupts disabled, or an
+ * interrupt taken between the read and the cmpxchg - advances the tid,
+ * which makes the interrupted cmpxchg fail and the fast path retry.
+ *
  * (C) 2007 SGI, Christoph Lameter <clameter@sgi.com>
  */
 #define pr_fmt(fmt) "slab: " fmt
 
 #include <base/cache.h>
 #include <base/poison.h>
+#include <base/log2.h>
 
 #include <rtochius/mm.h>
 #include <rtochius/smp.h>
@@ -18,6 +26,9 @@
 #include <rtochius/slab.h>
 #include <rtochius/mutex.h>
 #include <rtochius/cpumask.h>
+#include <rtochius/preempt.h>
+#include <rtochius/percpu.h>
+#include <rtochius/param.h>
 #include <rtochius/printf.h>
 
 #define FROZEN (1 << PG_active)
@@ -68,12 +79,20 @@ static inline void ClearSlabFrozen(struct page *page)
 /*
  * Set of flags that will prevent slab merging
  */
-#define SLUB_NEVER_MERGE (SLAB_RED_ZONE | SLAB_POISON | SLAB_STORE_USER)
+#define SLUB_NEVER_MERGE (SLAB_RED_ZONE | SLAB_POISON | SLAB_STORE_USER | \
+		__NO_MAGAZINES)
 
 #define SLUB_MERGE_SAME (SLAB_CACHE_DMA)
 
 /* Internal SLUB flags */
 #define __OBJECT_POISON		0x80000000 /* Poison object */
+#define __NO_MAGAZINES		0x40000000 /* No per cpu magazines */
+
+/*
+ * Full magazines kept in a cache's depot. Beyond that, full magazines
+ * are emptied back into their slabs.
+ */
+#define SLAB_DEPOT_MAX_FULL	8
 
 static int kmem_size = sizeof(struct kmem_cache);
 
@@ -98,7 +117,34 @@ static inline struct kmem_cache_node *get_node(struct kmem_cache *s)
 
 static inline struct kmem_cache_cpu *get_cpu_slab(struct kmem_cache *s, int cpu)
 {
-	return s->cpu_slab[cpu];
+	return per_cpu_ptr(s->cpu_slab, cpu);
+}
+
+/*
+ * Transaction ids start at the cpu number and advance in steps of the
+ * cpu count, so no two cpus ever use the same tid.
+ */
+#define TID_STEP	roundup_pow_of_two(CONFIG_NR_CPUS)
+
+static inline unsigned long next_tid(unsigned long tid)
+{
+	return tid + TID_STEP;
+}
+
+static inline unsigned long init_tid(int cpu)
+{
+	return cpu;
+}
+
+static inline void stat(struct kmem_cache_cpu *c, enum stat_item si)
+{
+	c->stat[si]++;
+}
+
+static inline void stat_add(struct kmem_cache_cpu *c, enum stat_item si,
+			    unsigned long nr)
+{
+	c->stat[si] += nr;
 }
 
 static inline int check_valid_pointer(struct kmem_cache *s,
@@ -395,9 +441,207 @@ static void deactivate_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 		page->inuse--;
 	}
 	c->page = NULL;
+	c->tid = next_tid(c->tid);
 	unfreeze_slab(s, page);
 }
 
+/*
+ * Per cpu magazines
+ *
+ * Objects freed to a slab other than the cpu slab - typically objects
+ * allocated on another cpu - are not handed back to their page but
+ * pushed on a per cpu magazine, and the slow allocation path pops them
+ * off again before it looks at any page. Each cpu has a loaded magazine
+ * and a previous one; when both are exhausted a full magazine is traded
+ * for an empty one at the cache's depot, or the other way round. Objects
+ * in magazines still count as in use for their slab.
+ *
+ * So with one cpu allocating and another freeing, the freeing cpu fills
+ * magazines and the allocating cpu picks them up from the depot, taking
+ * the depot lock once per SLAB_MAG_SIZE objects and no slab lock at all.
+ *
+ * All of this runs with interrupts disabled. Magazines come from their
+ * own cache, which has none itself.
+ */
+static struct kmem_cache *slab_magazine_cache;
+
+static void __slab_free(struct kmem_cache *s, struct page *page,
+				void *head, void *tail, int cnt,
+				void *addr, unsigned int offset);
+
+static inline int has_magazines(struct kmem_cache *s)
+{
+	return slab_magazine_cache && !(s->flags & __NO_MAGAZINES);
+}
+
+static struct slab_magazine *depot_get(struct slab_depot *d, int full)
+{
+	struct slab_magazine **list = full ? &d->full : &d->empty;
+	struct slab_magazine *m;
+
+	spin_lock(&d->lock);
+	m = *list;
+	if (m) {
+		*list = m->next;
+		if (full)
+			d->nr_full--;
+		else
+			d->nr_empty--;
+	}
+	spin_unlock(&d->lock);
+
+	return m;
+}
+
+/*
+ * Returns 0 if @m is full and the depot has enough full magazines
+ * already. Empty ones are always taken.
+ */
+static int depot_put(struct slab_depot *d, struct slab_magazine *m, int full)
+{
+	int ret = 1;
+
+	spin_lock(&d->lock);
+	if (full && d->nr_full >= SLAB_DEPOT_MAX_FULL) {
+		ret = 0;
+	} else if (full) {
+		m->next = d->full;
+		d->full = m;
+		d->nr_full++;
+	} else {
+		m->next = d->empty;
+		d->empty = m;
+		d->nr_empty++;
+	}
+	spin_unlock(&d->lock);
+
+	return ret;
+}
+
+/* Give all objects of @m back to their slabs. */
+static void mag_drain(struct kmem_cache *s, struct slab_magazine *m)
+{
+	unsigned int offset = s->offset / sizeof(void *);
+	void *x;
+
+	while (m->size) {
+		x = m->objects[--m->size];
+		__slab_free(s, virt_to_head_page(x), x, x, 1,
+			    __builtin_return_address(0), offset);
+	}
+}
+
+static void *mag_alloc(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	struct slab_magazine *m = c->loaded;
+
+	if (!has_magazines(s))
+		return NULL;
+
+	if (likely(m && m->size)) {
+		stat(c, ALLOC_MAG_HIT);
+		return m->objects[--m->size];
+	}
+
+	if (c->prev && c->prev->size) {
+		swap(c->loaded, c->prev);
+		stat(c, ALLOC_MAG_HIT);
+		return c->loaded->objects[--c->loaded->size];
+	}
+
+	m = depot_get(&s->depot, 1);
+	if (!m) {
+		stat(c, ALLOC_MAG_MISS);
+		return NULL;
+	}
+
+	/* Both loaded magazines are empty here, keep one of them. */
+	if (c->prev)
+		depot_put(&s->depot, c->prev, 0);
+	c->prev = c->loaded;
+	c->loaded = m;
+
+	stat(c, ALLOC_MAG_DEPOT);
+	return m->objects[--m->size];
+}
+
+/*
+ * Returns 0 if @x could not be put on a magazine and has to go back to
+ * its slab.
+ */
+static int mag_free(struct kmem_cache *s, struct kmem_cache_cpu *c, void *x)
+{
+	struct slab_magazine *m = c->loaded;
+
+	if (!has_magazines(s))
+		return 0;
+
+	if (likely(m && m->size < SLAB_MAG_SIZE)) {
+		stat(c, FREE_MAG_HIT);
+		goto push;
+	}
+
+	if (c->prev && c->prev->size < SLAB_MAG_SIZE) {
+		swap(c->loaded, c->prev);
+		m = c->loaded;
+		stat(c, FREE_MAG_HIT);
+		goto push;
+	}
+
+	m = depot_get(&s->depot, 0);
+	if (!m) {
+		m = kmem_cache_alloc(slab_magazine_cache,
+				     GFP_KERNEL | __GFP_NOWARN);
+		if (!m) {
+			stat(c, FREE_MAG_MISS);
+			return 0;
+		}
+	}
+	m->size = 0;
+
+	/* Both loaded magazines are full, or missing. */
+	if (c->prev && !depot_put(&s->depot, c->prev, 1)) {
+		mag_drain(s, c->prev);
+		depot_put(&s->depot, c->prev, 0);
+	}
+	c->prev = c->loaded;
+	c->loaded = m;
+	stat(c, FREE_MAG_DEPOT);
+
+push:
+	m->objects[m->size++] = x;
+	return 1;
+}
+
+/* Empty and release the magazines loaded on @c. */
+static void mag_flush_cpu(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	struct slab_magazine *m;
+
+	while ((m = c->loaded)) {
+		c->loaded = c->prev;
+		c->prev = NULL;
+		mag_drain(s, m);
+		kmem_cache_free(slab_magazine_cache, m);
+	}
+}
+
+/* Empty and release the magazines in the depot. */
+static void mag_flush_depot(struct kmem_cache *s)
+{
+	struct slab_magazine *m;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	while ((m = depot_get(&s->depot, 1))) {
+		mag_drain(s, m);
+		kmem_cache_free(slab_magazine_cache, m);
+	}
+	while ((m = depot_get(&s->depot, 0)))
+		kmem_cache_free(slab_magazine_cache, m);
+	local_irq_restore(flags);
+}
+
 static inline void flush_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 {
 	slab_lock(c->page);
@@ -412,7 +656,11 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 {
 	struct kmem_cache_cpu *c = get_cpu_slab(s, cpu);
 
-	if (likely(c && c->page))
+	if (!c)
+		return;
+
+	mag_flush_cpu(s, c);
+	if (c->page)
 		flush_slab(s, c);
 }
 
@@ -432,7 +680,7 @@ static void flush_all(struct kmem_cache *s)
  * Slow path. The lockless freelist is empty or we need to perform
  * debugging duties.
  *
- * Interrupts are disabled.
+ * Called with preemption disabled, runs with interrupts disabled.
  *
  * Processing is still very fast if new objects have been freed to the
  * regular freelist. In that case we simply take over the regular freelist
@@ -450,22 +698,46 @@ static void *__slab_alloc(struct kmem_cache *s,
 {
 	void **object;
 	struct page *new;
+	unsigned long flags;
+
+	local_irq_save(flags);
+
+	/*
+	 * slab_alloc() found the lockless freelist empty with interrupts
+	 * on. One that freed to the cpu slab meanwhile may have refilled
+	 * it, and load_freelist would overwrite it.
+	 */
+	object = c->freelist;
+	if (unlikely(object)) {
+		c->freelist = object[c->offset];
+		c->tid = next_tid(c->tid);
+		local_irq_restore(flags);
+		return object;
+	}
+
+	object = mag_alloc(s, c);
+	if (object) {
+		local_irq_restore(flags);
+		return object;
+	}
 
 	if (!c->page)
 		goto new_slab;
 
 	slab_lock(c->page);
+	stat(c, ALLOC_REFILL);
 
 load_freelist:
 	object = c->page->freelist;
 	if (unlikely(!object))
 		goto another_slab;
 
-	object = c->page->freelist;
 	c->freelist = object[c->offset];
+	c->tid = next_tid(c->tid);
 	c->page->inuse = s->objects;
 	c->page->freelist = NULL;
 	slab_unlock(c->page);
+	local_irq_restore(flags);
 	return object;
 
 another_slab:
@@ -475,6 +747,7 @@ new_slab:
 	new = get_partial(s, gfpflags);
 	if (new) {
 		c->page = new;
+		stat(c, ALLOC_PARTIAL);
 		goto load_freelist;
 	}
 
@@ -482,6 +755,7 @@ new_slab:
 
 	if (new) {
 		c = get_cpu_slab(s, smp_processor_id());
+		stat(c, ALLOC_SLAB);
 		if (c->page)
 			flush_slab(s, c);
 		slab_lock(new);
@@ -489,6 +763,7 @@ new_slab:
 		c->page = new;
 		goto load_freelist;
 	}
+	local_irq_restore(flags);
 	return NULL;
 }
 
@@ -501,23 +776,45 @@ new_slab:
  * If not then __slab_alloc is called for slow processing.
  *
  * Otherwise we can simply pick the next object from the lockless free list.
+ * Preemption stays disabled so that the cmpxchg is done on the cpu slab
+ * of the cpu we run on, which only interrupts can race with.
  */
 static void __always_inline *slab_alloc(struct kmem_cache *s,
 		gfp_t gfpflags, void *addr)
 {
 	void **object;
-	unsigned long flags;
 	struct kmem_cache_cpu *c;
+	unsigned long tid;
 
-	local_irq_save(flags);
+	preempt_disable();
 	c = get_cpu_slab(s, smp_processor_id());
-	if (unlikely(!c->freelist))
+redo:
+	/*
+	 * The tid must be read before the freelist: if an interrupt
+	 * replaces the freelist in between, it also advances the tid.
+	 */
+	tid = READ_ONCE(c->tid);
+	barrier();
+
+	object = READ_ONCE(c->freelist);
+	if (unlikely(!object)) {
 		object = __slab_alloc(s, gfpflags, addr, c);
-	else {
-		object = c->freelist;
-		c->freelist = object[c->offset];
+		if (object)
+			stat(c, ALLOC_SLOWPATH);
+	} else {
+		/*
+		 * The object may have been taken by an interrupt already,
+		 * then its free pointer is garbage but the cmpxchg fails.
+		 */
+		void *next = READ_ONCE(object[c->offset]);
+
+		if (unlikely(!cmpxchg_double_local(&c->freelist, &c->tid,
+						   object, tid,
+						   next, next_tid(tid))))
+			goto redo;
+		stat(c, ALLOC_FASTPATH);
 	}
-	local_irq_restore(flags);
+	preempt_enable();
 
 	if (unlikely((gfpflags & __GFP_ZERO) && object))
 		memset(object, 0, c->objsize);
@@ -539,16 +836,17 @@ void *kmem_cache_alloc(struct kmem_cache *s, gfp_t gfpflags)
  * handling required then we can return immediately.
  */
 static void __slab_free(struct kmem_cache *s, struct page *page,
-				void *x, void *addr, unsigned int offset)
+				void *head, void *tail, int cnt,
+				void *addr, unsigned int offset)
 {
 	void *prior;
-	void **object = (void *)x;
+	void **object = tail;
 
 	slab_lock(page);
 
 	prior = object[offset] = page->freelist;
-	page->freelist = object;
-	page->inuse--;
+	page->freelist = head;
+	page->inuse -= cnt;
 
 	if (unlikely(SlabFrozen(page)))
 		goto out_unlock;
@@ -596,17 +894,33 @@ static void __always_inline slab_free(struct kmem_cache *s,
 	void **object = (void *)x;
 	unsigned long flags;
 	struct kmem_cache_cpu *c;
+	unsigned long tid;
 
-	local_irq_save(flags);
-
+	preempt_disable();
 	c = get_cpu_slab(s, smp_processor_id());
-	if (likely(page == c->page)) {
-		object[c->offset] = c->freelist;
-		c->freelist = object;
-	} else
-		__slab_free(s, page, x, addr, c->offset);
+redo:
+	/* Same ordering as in slab_alloc(), the page is checked under the tid. */
+	tid = READ_ONCE(c->tid);
+	barrier();
+
+	if (likely(page == READ_ONCE(c->page))) {
+		void **head = READ_ONCE(c->freelist);
+
+		object[c->offset] = head;
+		if (unlikely(!cmpxchg_double_local(&c->freelist, &c->tid,
+						   head, tid,
+						   object, next_tid(tid))))
+			goto redo;
+		stat(c, FREE_FASTPATH);
+	} else {
+		local_irq_save(flags);
+		stat(c, FREE_REMOTE);
+		if (!mag_free(s, c, x))
+			__slab_free(s, page, x, x, 1, addr, c->offset);
+		local_irq_restore(flags);
+	}
 
-	local_irq_restore(flags);
+	preempt_enable();
 }
 
 void kmem_cache_free(struct kmem_cache *s, void *x)
@@ -618,6 +932,151 @@ void kmem_cache_free(struct kmem_cache *s, void *x)
 	slab_free(s, page, x, __builtin_return_address(0));
 }
 
+/*
+ * Bulk allocation: the objects are all taken off the cpu freelist in one
+ * go with interrupts disabled, refilling it from the slow path whenever
+ * it runs dry.
+ *
+ * Returns @size with all of @p filled in, or 0 if the cache ran out of
+ * memory, in which case nothing is allocated.
+ */
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
+			  void **p)
+{
+	struct kmem_cache_cpu *c;
+	unsigned long irqflags;
+	void **object;
+	size_t i = 0;
+
+	local_irq_save(irqflags);
+	c = get_cpu_slab(s, smp_processor_id());
+
+	while (i < size) {
+		object = c->freelist;
+		if (unlikely(!object)) {
+			object = __slab_alloc(s, flags,
+					      __builtin_return_address(0), c);
+			if (unlikely(!object))
+				break;
+			p[i++] = object;
+			continue;
+		}
+
+		/* Detach as much of the freelist as we need at once. */
+		while (object && i < size) {
+			p[i++] = object;
+			object = object[c->offset];
+		}
+		c->freelist = object;
+		c->tid = next_tid(c->tid);
+	}
+
+	stat_add(c, ALLOC_BULK, i);
+	local_irq_restore(irqflags);
+
+	if (unlikely(i < size)) {
+		kmem_cache_free_bulk(s, i, p);
+		return 0;
+	}
+
+	if (unlikely(flags & __GFP_ZERO)) {
+		for (i = 0; i < size; i++)
+			memset(p[i], 0, c->objsize);
+	}
+
+	return size;
+}
+
+struct detached_freelist {
+	struct page *page;
+	void *head;
+	void *tail;
+	int cnt;
+};
+
+/*
+ * Link the objects at the end of @p which share the slab page of the
+ * last one into a freelist. They are taken out of @p, the scan gives up
+ * after a few objects from other pages.
+ *
+ * Returns the number of entries of @p left to look at. df->page is NULL
+ * if there was nothing left to free.
+ */
+static size_t build_detached_freelist(struct kmem_cache *s, size_t size,
+				      void **p, struct detached_freelist *df)
+{
+	unsigned int offset = s->offset / sizeof(void *);
+	int lookahead = 3;
+	void **object;
+	size_t i;
+
+	df->page = NULL;
+
+	/* Skip the entries an earlier pass took already. */
+	while (size && !p[size - 1])
+		size--;
+	if (!size)
+		return 0;
+
+	object = p[--size];
+	object[offset] = NULL;
+	df->page = virt_to_head_page(object);
+	df->head = df->tail = object;
+	df->cnt = 1;
+
+	for (i = size; i > 0; i--) {
+		object = p[i - 1];
+		if (!object)
+			continue;
+
+		if (virt_to_head_page(object) != df->page) {
+			if (!--lookahead)
+				break;
+			continue;
+		}
+
+		object[offset] = df->head;
+		df->head = object;
+		df->cnt++;
+		p[i - 1] = NULL;
+	}
+
+	return size;
+}
+
+/*
+ * Bulk free: the objects are grouped by slab page, each group goes back
+ * to the cpu freelist or, under one slab lock, to its page. @p is
+ * clobbered.
+ */
+void kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p)
+{
+	struct detached_freelist df;
+	struct kmem_cache_cpu *c;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	c = get_cpu_slab(s, smp_processor_id());
+	stat_add(c, FREE_BULK, size);
+
+	while (size) {
+		size = build_detached_freelist(s, size, p, &df);
+		if (!df.page)
+			break;
+
+		if (df.page == c->page) {
+			((void **)df.tail)[c->offset] = c->freelist;
+			c->freelist = df.head;
+			c->tid = next_tid(c->tid);
+		} else {
+			__slab_free(s, df.page, df.head, df.tail, df.cnt,
+				    __builtin_return_address(0), c->offset);
+		}
+	}
+
+	local_irq_restore(flags);
+}
+
 /* Figure out on which slab object the object resides */
 static struct page *get_object_page(const void *x)
 {
@@ -773,10 +1232,14 @@ static unsigned long calculate_alignment(unsigned long flags,
 }
 
 static void init_kmem_cache_cpu(struct kmem_cache *s,
-			struct kmem_cache_cpu *c)
+			struct kmem_cache_cpu *c, int cpu)
 {
 	c->page = NULL;
 	c->freelist = NULL;
+	c->tid = init_tid(cpu);
+	c->loaded = NULL;
+	c->prev = NULL;
+	memset(c->stat, 0, sizeof(c->stat));
 	c->offset = s->offset / sizeof(void *);
 	c->objsize = s->objsize;
 }
@@ -790,114 +1253,30 @@ static void init_kmem_cache_node(struct kmem_cache_node *n)
 }
 
 /*
- * Per cpu array for per cpu structures.
- *
- * The per cpu array places all kmem_cache_cpu structures from one processor
- * close together meaning that it becomes possible that multiple per cpu
- * structures are contained in one cacheline. This may be particularly
- * beneficial for the kmalloc caches.
- *
- * A desktop system typically has around 60-80 slabs. With 100 here we are
- * likely able to get per cpu structures for all caches from the array defined
- * here. We must be able to cover all kmalloc caches during bootstrap.
- *
- * If the per cpu array is exhausted then fall back to kmalloc
- * of individual cachelines. No sharing is possible then.
+ * The per cpu structures come from the percpu allocator, so that those
+ * of one processor sit next to each other and share cachelines, and
+ * every possible cpu gets one whether it is online yet or not.
  */
-#define NR_KMEM_CACHE_CPU 100
-
-static struct kmem_cache_cpu kmem_cache_cpu[CONFIG_NR_CPUS][NR_KMEM_CACHE_CPU];
-static struct kmem_cache_cpu *kmem_cache_cpu_free[CONFIG_NR_CPUS];
-static cpumask_t kmem_cach_cpu_free_init_once = CPU_MASK_NONE;
-
-static struct kmem_cache_cpu *alloc_kmem_cache_cpu(struct kmem_cache *s,
-							int cpu, gfp_t flags)
-{
-	struct kmem_cache_cpu *c = kmem_cache_cpu_free[cpu];
-
-	if (c)
-		kmem_cache_cpu_free[cpu] = (void *)c->freelist;
-	else {
-		/* Table overflow: So allocate ourselves */
-		c = kmalloc(
-			ALIGN(sizeof(struct kmem_cache_cpu), cache_line_size()), flags);
-		if (!c)
-			return NULL;
-	}
-
-	init_kmem_cache_cpu(s, c);
-	return c;
-}
-
-static void free_kmem_cache_cpu(struct kmem_cache_cpu *c, int cpu)
-{
-	if (c < kmem_cache_cpu[cpu] ||
-			c > kmem_cache_cpu[cpu] + NR_KMEM_CACHE_CPU) {
-		kfree(c);
-		return;
-	}
-	c->freelist = (void *)kmem_cache_cpu_free[cpu];
-	kmem_cache_cpu_free[cpu] = c;
-}
-
 static void free_kmem_cache_cpus(struct kmem_cache *s)
 {
-	int cpu;
-
-	for_each_online_cpu(cpu) {
-		struct kmem_cache_cpu *c = get_cpu_slab(s, cpu);
-
-		if (c) {
-			s->cpu_slab[cpu] = NULL;
-			free_kmem_cache_cpu(c, cpu);
-		}
-	}
+	free_percpu(s->cpu_slab);
+	s->cpu_slab = NULL;
 }
 
-static int alloc_kmem_cache_cpus(struct kmem_cache *s, gfp_t flags)
+static int alloc_kmem_cache_cpus(struct kmem_cache *s)
 {
 	int cpu;
 
-	for_each_online_cpu(cpu) {
-		struct kmem_cache_cpu *c = get_cpu_slab(s, cpu);
-
-		if (c)
-			continue;
+	s->cpu_slab = __alloc_percpu(sizeof(struct kmem_cache_cpu),
+				     2 * sizeof(void *));
+	if (!s->cpu_slab)
+		return 0;
 
-		c = alloc_kmem_cache_cpu(s, cpu, flags);
-		if (!c) {
-			free_kmem_cache_cpus(s);
-			return 0;
-		}
-		s->cpu_slab[cpu] = c;
-	}
+	for_each_possible_cpu(cpu)
+		init_kmem_cache_cpu(s, get_cpu_slab(s, cpu), cpu);
 	return 1;
 }
 
-/*
- * Initialize the per cpu array.
- */
-static void init_alloc_cpu_cpu(int cpu)
-{
-	int i;
-
-	if (cpumask_test_cpu(cpu, &kmem_cach_cpu_free_init_once))
-		return;
-
-	for (i = NR_KMEM_CACHE_CPU - 1; i >= 0; i--)
-		free_kmem_cache_cpu(&kmem_cache_cpu[cpu][i], cpu);
-
-	cpumask_set_cpu(cpu, &kmem_cach_cpu_free_init_once);
-}
-
-static void __init init_alloc_cpu(void)
-{
-	int cpu;
-
-	for_each_online_cpu(cpu)
-		init_alloc_cpu_cpu(cpu);
-}
-
 /*
  * calculate_sizes() determines the order and the distribution of data within
  * a slab object.
@@ -990,8 +1369,9 @@ static int kmem_cache_open(struct kmem_cache *s, gfp_t gfpflags,
 	s->refcount = 1;
 
 	init_kmem_cache_node(&s->local_node);
+	spin_lock_init(&s->depot.lock);
 
-	if (alloc_kmem_cache_cpus(s, gfpflags & ~GFP_DMA))
+	if (alloc_kmem_cache_cpus(s))
 		return 1;
 
 error:
@@ -1071,6 +1451,7 @@ static inline int kmem_cache_close(struct kmem_cache *s)
 	struct kmem_cache_node *n = get_node(s);
 
 	flush_all(s);
+	mag_flush_depot(s);
 
 	/* Attempt to free all objects */
 	free_kmem_cache_cpus(s);
@@ -1255,8 +1636,6 @@ void __init kmem_cache_init(void)
 	int i;
 	int caches = 0;
 
-	init_alloc_cpu();
-
 	/* Able to allocate the per node structures */
 	slab_state = PARTIAL;
 
@@ -1303,8 +1682,10 @@ void __init kmem_cache_init(void)
 		kmalloc_caches[i].name =
 			kasprintf(GFP_KERNEL, "kmalloc-%d", 1 << i);
 
-	kmem_size = offsetof(struct kmem_cache, cpu_slab) +
-				nr_cpu_ids * sizeof(struct kmem_cache_cpu *);
+	/* Magazines can be handed out from here on. */
+	slab_magazine_cache = kmem_cache_create("slab_magazine",
+			sizeof(struct slab_magazine), 0,
+			SLAB_PANIC | __NO_MAGAZINES, NULL);
 
 	pr_info("SLUB: Genslabs=%d, HWalign=%d, Order=%d-%d, MinObjects=%d,"
 		" CPUs=%d\n",
@@ -1313,6 +1694,79 @@ void __init kmem_cache_init(void)
 		nr_cpu_ids);
 }
 
+static unsigned long sum_stat(struct kmem_cache *s, enum stat_item si)
+{
+	unsigned long sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += READ_ONCE(get_cpu_slab(s, cpu)->stat[si]);
+
+	return sum;
+}
+
+static void show_cache_stats(struct kmem_cache *s)
+{
+	unsigned long st[NR_SLUB_STAT_ITEMS];
+	struct kmem_cache_node *n = get_node(s);
+	long active;
+	int si;
+
+	for (si = 0; si < NR_SLUB_STAT_ITEMS; si++)
+		st[si] = sum_stat(s, si);
+
+	active = st[ALLOC_FASTPATH] + st[ALLOC_SLOWPATH] + st[ALLOC_BULK] -
+		 st[FREE_FASTPATH] - st[FREE_REMOTE] - st[FREE_BULK];
+
+	pr_info("%s: size %d/%d order %d objects %d slabs %ld partial %lu "
+		"active %ld aliases %d\n",
+		s->name, s->objsize, s->size, s->order, s->objects,
+		atomic_long_read(&n->nr_slabs), n->nr_partial, active,
+		s->refcount - 1);
+	pr_info("  alloc fast %lu slow %lu bulk %lu refill %lu partial %lu "
+		"new_slab %lu\n",
+		st[ALLOC_FASTPATH], st[ALLOC_SLOWPATH], st[ALLOC_BULK],
+		st[ALLOC_REFILL], st[ALLOC_PARTIAL], st[ALLOC_SLAB]);
+	pr_info("  free fast %lu remote %lu bulk %lu\n",
+		st[FREE_FASTPATH], st[FREE_REMOTE], st[FREE_BULK]);
+
+	if (!has_magazines(s))
+		return;
+
+	pr_info("  magazine alloc hit %lu depot %lu miss %lu, "
+		"free hit %lu depot %lu miss %lu, depot %u/%u\n",
+		st[ALLOC_MAG_HIT], st[ALLOC_MAG_DEPOT], st[ALLOC_MAG_MISS],
+		st[FREE_MAG_HIT], st[FREE_MAG_DEPOT], st[FREE_MAG_MISS],
+		s->depot.nr_full, s->depot.nr_empty);
+}
+
+/*
+ * Dump the counters of every cache, summed over all cpus. "active" is
+ * allocations minus frees, so it is only as exact as the counters.
+ */
+void show_slab_stats(void)
+{
+	struct kmem_cache *s;
+
+	mutex_lock(&slub_lock);
+	list_for_each_entry(s, &slab_caches, list)
+		show_cache_stats(s);
+	mutex_unlock(&slub_lock);
+}
+
+/*
+ * Keep every cache separate, so that the statistics of each show up on
+ * their own.
+ */
+static int slub_nomerge;
+
+static int __init setup_slub_nomerge(char *str)
+{
+	slub_nomerge = 1;
+	return 0;
+}
+early_param("slub_nomerge", setup_slub_nomerge);
+
 /*
  * Find a mergeable slab cache
  */
@@ -1339,7 +1793,7 @@ static struct kmem_cache *find_mergeable(size_t size,
 {
 	struct kmem_cache *s;
 
-	if ((flags & SLUB_NEVER_MERGE))
+	if (slub_nomerge || (flags & SLUB_NEVER_MERGE))
 		return NULL;
 
 	if (ctor)
@@ -1395,11 +1849,13 @@ struct kmem_cache *kmem_cache_create(const char *name, size_t size,
 		 * And then we need to update the object size in the
 		 * per cpu structures
 		 */
-		for_each_online_cpu(cpu)
+		for_each_possible_cpu(cpu)
 			get_cpu_slab(s, cpu)->objsize = s->objsize;
 		s->inuse = max_t(int, s->inuse, ALIGN(size, sizeof(void *)));
 		mutex_unlock(&slub_lock);
 
+		pr_info("%s merged into %s\n", name, s->name);
+
 		return s;
 	}
 	s = kmalloc(kmem_size, GFP_KERNEL);
@@ -0,0 +1,884 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Virtually contiguous kernel memory
+ *
+ * The [VMALLOC_START, VMALLOC_END) window is carved into vmap areas.
+ * Areas in use sit in a tree sorted by address, for vfree() to find
+ * them. Free space is kept in a second address sorted tree, augmented
+ * with the size of the largest free block below every node, so the
+ * lowest block that fits a request is found in O(log n) without
+ * visiting the ones that are too small. Freed blocks are merged with
+ * their neighbours.
+ *
+ * Unmapping is lazy: a freed area has its page tables cleared but stays
+ * out of the free tree until enough of them have piled up, then the
+ * whole batch is flushed from the TLBs with one broadcast invalidation
+ * and given back. Until then nobody can map the range again, so stale
+ * TLB entries are harmless.
+ *
+ * Allocations of PMD_SIZE or more are PMD aligned and backed by
+ * order-9 blocks where possible, so they are mapped with PMD blocks
+ * rather than page tables.
+ */
+#define pr_fmt(fmt) "vmalloc: " fmt
+
+#include <base/compiler.h>
+#include <base/common.h>
+#include <base/errno.h>
+#include <base/list.h>
+#include <base/pfn.h>
+#include <base/rbtree.h>
+#include <base/rbree_augmented.h>
+#include <base/sizes.h>
+
+#include <rtochius/vmalloc.h>
+#include <rtochius/mm.h>
+#include <rtochius/gfp.h>
+#include <rtochius/slab.h>
+#include <rtochius/spinlock.h>
+#include <rtochius/cpumask.h>
+#include <rtochius/percpu.h>
+#include <rtochius/printf.h>
+
+#include <asm/sections.h>
+#include <asm/pgalloc.h>
+#include <asm/tlbflush.h>
+
+struct vmap_area {
+	unsigned long		va_start;
+	unsigned long		va_end;
+
+	struct rb_node		rb_node;	/* address sorted rbtree */
+	struct list_head	list;		/* lazy purge list */
+
+	/* Largest free block in this subtree, free tree only: */
+	unsigned long		subtree_max_size;
+	struct vm_struct	*vm;
+};
+
+struct vmalloc_stats {
+	unsigned long		allocs;
+	unsigned long		frees;
+	/* PMD blocks mapped instead of a page table: */
+	unsigned long		huge_maps;
+	/* Lazy purges, and the areas they gave back: */
+	unsigned long		purges;
+	unsigned long		purged_areas;
+};
+
+static DEFINE_PER_CPU(struct vmalloc_stats, vmalloc_stats);
+
+static struct kmem_cache *vmap_area_cachep __read_mostly;
+
+/* Protects both trees: */
+static DEFINE_SPINLOCK(vmap_area_lock);
+static struct rb_root vmap_area_root = RB_ROOT;
+static struct rb_root free_vmap_area_root = RB_ROOT;
+
+/* Areas unmapped but not flushed yet, and their pages: */
+static DEFINE_SPINLOCK(purge_vmap_area_lock);
+static LIST_HEAD(purge_vmap_area_list);
+static atomic_long_t vmap_lazy_nr;
+
+/* Serializes purges, vm_unmap_aliases() must see earlier ones done: */
+static DEFINE_SPINLOCK(vmap_purge_lock);
+
+static inline unsigned long va_size(struct vmap_area *va)
+{
+	return va->va_end - va->va_start;
+}
+
+static inline unsigned long get_subtree_max_size(struct rb_node *node)
+{
+	struct vmap_area *va;
+
+	va = rb_entry_safe(node, struct vmap_area, rb_node);
+	return va ? va->subtree_max_size : 0;
+}
+
+static inline unsigned long compute_subtree_max_size(struct vmap_area *va)
+{
+	return max3(va_size(va),
+		    get_subtree_max_size(va->rb_node.rb_left),
+		    get_subtree_max_size(va->rb_node.rb_right));
+}
+
+RB_DECLARE_CALLBACKS(static, free_vmap_area_rb_augment_cb,
+		     struct vmap_area, rb_node, unsigned long,
+		     subtree_max_size, compute_subtree_max_size)
+
+static void augment_tree_propagate(struct vmap_area *va)
+{
+	free_vmap_area_rb_augment_cb.propagate(&va->rb_node, NULL);
+}
+
+/*
+ * Address lookups in the busy tree:
+ */
+static struct vmap_area *__find_vmap_area(unsigned long addr)
+{
+	struct rb_node *n = vmap_area_root.rb_node;
+
+	while (n) {
+		struct vmap_area *va = rb_entry(n, struct vmap_area, rb_node);
+
+		if (addr < va->va_start)
+			n = n->rb_left;
+		else if (addr >= va->va_end)
+			n = n->rb_right;
+		else
+			return va;
+	}
+
+	return NULL;
+}
+
+static void insert_vmap_area(struct vmap_area *va)
+{
+	struct rb_node **p = &vmap_area_root.rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*p) {
+		struct vmap_area *tmp;
+
+		parent = *p;
+		tmp = rb_entry(parent, struct vmap_area, rb_node);
+		if (va->va_start < tmp->va_start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&va->rb_node, parent, p);
+	rb_insert_color(&va->rb_node, &vmap_area_root);
+}
+
+/*
+ * The free tree. An inserted block bumps the maximum of every node on
+ * its way down, the rotations then keep the augmented value right.
+ */
+static void insert_free_vmap_area(struct vmap_area *va)
+{
+	struct rb_node **p = &free_vmap_area_root.rb_node;
+	struct rb_node *parent = NULL;
+	unsigned long size = va_size(va);
+
+	while (*p) {
+		struct vmap_area *tmp;
+
+		parent = *p;
+		tmp = rb_entry(parent, struct vmap_area, rb_node);
+		if (tmp->subtree_max_size < size)
+			tmp->subtree_max_size = size;
+
+		if (va->va_end <= tmp->va_start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	va->subtree_max_size = size;
+	rb_link_node(&va->rb_node, parent, p);
+	rb_insert_augmented(&va->rb_node, &free_vmap_area_root,
+			    &free_vmap_area_rb_augment_cb);
+}
+
+static void erase_free_vmap_area(struct vmap_area *va)
+{
+	rb_erase_augmented(&va->rb_node, &free_vmap_area_root,
+			   &free_vmap_area_rb_augment_cb);
+}
+
+/*
+ * Give a block back to the free tree, merged with the free blocks right
+ * before and after it.
+ */
+static void merge_free_vmap_area(struct vmap_area *va)
+{
+	struct vmap_area *sibling;
+	struct rb_node *n;
+
+	insert_free_vmap_area(va);
+
+	n = rb_next(&va->rb_node);
+	sibling = rb_entry_safe(n, struct vmap_area, rb_node);
+	if (sibling && sibling->va_start == va->va_end) {
+		erase_free_vmap_area(sibling);
+		va->va_end = sibling->va_end;
+		augment_tree_propagate(va);
+		kmem_cache_free(vmap_area_cachep, sibling);
+	}
+
+	n = rb_prev(&va->rb_node);
+	sibling = rb_entry_safe(n, struct vmap_area, rb_node);
+	if (sibling && sibling->va_end == va->va_start) {
+		erase_free_vmap_area(va);
+		sibling->va_end = va->va_end;
+		augment_tree_propagate(sibling);
+		kmem_cache_free(vmap_area_cachep, va);
+	}
+}
+
+static inline bool is_within_this_va(struct vmap_area *va, unsigned long size,
+				     unsigned long align)
+{
+	unsigned long start = ALIGN(va->va_start, align);
+
+	/* Can overflow at the very top of the address space: */
+	if (start + size < start)
+		return false;
+
+	return start + size <= va->va_end;
+}
+
+/*
+ * The lowest free block that can hold @size bytes at @align. Blocks are
+ * page aligned, so a subtree whose largest block has room for
+ * size + align - PAGE_SIZE bytes holds a fit whatever the alignment of
+ * that block, and the descent never has to backtrack.
+ */
+static struct vmap_area *find_vmap_lowest_match(unsigned long size,
+						unsigned long align)
+{
+	struct rb_node *node = free_vmap_area_root.rb_node;
+	unsigned long length = size + align - PAGE_SIZE;
+
+	while (node) {
+		struct vmap_area *va = rb_entry(node, struct vmap_area, rb_node);
+
+		if (get_subtree_max_size(node->rb_left) >= length) {
+			node = node->rb_left;
+			continue;
+		}
+
+		if (is_within_this_va(va, size, align))
+			return va;
+
+		if (get_subtree_max_size(node->rb_right) >= length) {
+			node = node->rb_right;
+			continue;
+		}
+
+		break;
+	}
+
+	return NULL;
+}
+
+/*
+ * Carve [@start, @start + @size) out of the free block @va. Splitting a
+ * block in the middle takes the preallocated @spare.
+ */
+static void clip_free_vmap_area(struct vmap_area *va, unsigned long start,
+				unsigned long size, struct vmap_area **spare)
+{
+	unsigned long end = start + size;
+	struct vmap_area *lva;
+
+	if (va->va_start == start && va->va_end == end) {
+		erase_free_vmap_area(va);
+		kmem_cache_free(vmap_area_cachep, va);
+	} else if (va->va_start == start) {
+		va->va_start = end;
+		augment_tree_propagate(va);
+	} else if (va->va_end == end) {
+		va->va_end = start;
+		augment_tree_propagate(va);
+	} else {
+		lva = *spare;
+		*spare = NULL;
+		lva->va_start = va->va_start;
+		lva->va_end = start;
+		va->va_start = end;
+		augment_tree_propagate(va);
+		insert_free_vmap_area(lva);
+	}
+}
+
+static unsigned long lazy_max_pages(void)
+{
+	return (SZ_32M >> PAGE_SHIFT) * fls(num_online_cpus());
+}
+
+/*
+ * Flush the TLB for every area on the purge list at once, then give the
+ * areas back to the free tree. Returns false if there was nothing to do.
+ */
+static bool __purge_vmap_area_lazy(void)
+{
+	unsigned long start = ULONG_MAX, end = 0;
+	unsigned long nr = 0, nr_areas = 0;
+	struct vmap_area *va, *n;
+	LIST_HEAD(local);
+
+	spin_lock(&purge_vmap_area_lock);
+	list_splice_init(&purge_vmap_area_list, &local);
+	spin_unlock(&purge_vmap_area_lock);
+
+	if (list_empty(&local))
+		return false;
+
+	list_for_each_entry(va, &local, list) {
+		start = min(start, va->va_start);
+		end = max(end, va->va_end);
+		nr += va_size(va) >> PAGE_SHIFT;
+		nr_areas++;
+	}
+
+	/* Wide spans end up as a single flush_tlb_all(). */
+	flush_tlb_kernel_range(start, end);
+
+	spin_lock(&vmap_area_lock);
+	list_for_each_entry_safe(va, n, &local, list) {
+		list_del(&va->list);
+		merge_free_vmap_area(va);
+	}
+	spin_unlock(&vmap_area_lock);
+
+	atomic_long_sub(nr, &vmap_lazy_nr);
+
+	this_cpu_inc(vmalloc_stats.purges);
+	this_cpu_add(vmalloc_stats.purged_areas, nr_areas);
+
+	return true;
+}
+
+static bool purge_vmap_area_lazy(void)
+{
+	bool ret;
+
+	spin_lock(&vmap_purge_lock);
+	ret = __purge_vmap_area_lazy();
+	spin_unlock(&vmap_purge_lock);
+
+	return ret;
+}
+
+/*
+ * Free a busy area whose page tables are cleared already. The range is
+ * only reused once a purge flushed it from the TLBs.
+ */
+static void free_vmap_area_noflush(struct vmap_area *va)
+{
+	unsigned long nr = va_size(va) >> PAGE_SHIFT;
+
+	spin_lock(&vmap_area_lock);
+	rb_erase(&va->rb_node, &vmap_area_root);
+	spin_unlock(&vmap_area_lock);
+
+	va->vm = NULL;
+
+	spin_lock(&purge_vmap_area_lock);
+	list_add_tail(&va->list, &purge_vmap_area_list);
+	spin_unlock(&purge_vmap_area_lock);
+
+	if (atomic_long_add_return(nr, &vmap_lazy_nr) > lazy_max_pages())
+		purge_vmap_area_lazy();
+}
+
+/**
+ * vm_unmap_aliases - flush the lazily unmapped areas
+ *
+ * Once this returns, no TLB holds a translation for a range that was
+ * vfree()d or vunmap()ed before the call.
+ */
+void vm_unmap_aliases(void)
+{
+	purge_vmap_area_lazy();
+}
+
+/*
+ * Allocate a busy area of @size bytes at @align, followed by a guard
+ * page. Purges the lazily freed areas and retries if the window is full.
+ */
+static struct vmap_area *alloc_vmap_area(unsigned long size,
+					 unsigned long align)
+{
+	struct vmap_area *va, *spare, *free;
+	unsigned long addr;
+	bool purged = false;
+
+	va = kmem_cache_alloc(vmap_area_cachep, GFP_KERNEL);
+	if (unlikely(!va))
+		return NULL;
+
+	spare = kmem_cache_alloc(vmap_area_cachep, GFP_KERNEL);
+	if (unlikely(!spare))
+		goto out_free;
+
+	size += PAGE_SIZE;
+
+retry:
+	spin_lock(&vmap_area_lock);
+	free = find_vmap_lowest_match(size, align);
+	if (free) {
+		addr = ALIGN(free->va_start, align);
+		clip_free_vmap_area(free, addr, size, &spare);
+
+		va->va_start = addr;
+		va->va_end = addr + size;
+		va->vm = NULL;
+		insert_vmap_area(va);
+	}
+	spin_unlock(&vmap_area_lock);
+
+	if (unlikely(!free)) {
+		if (!purged) {
+			purged = purge_vmap_area_lazy();
+			if (purged)
+				goto retry;
+		}
+		pr_warn("no room for %lu bytes\n", size - PAGE_SIZE);
+		goto out_free;
+	}
+
+	if (spare)
+		kmem_cache_free(vmap_area_cachep, spare);
+
+	return va;
+
+out_free:
+	if (spare)
+		kmem_cache_free(vmap_area_cachep, spare);
+	kmem_cache_free(vmap_area_cachep, va);
+	return NULL;
+}
+
+/*
+ * Page table population. The callers own the range, no other CPU can
+ * touch these entries.
+ */
+static int vmap_pte_range(pmd_t *pmd, unsigned long addr, unsigned long end,
+			  pgprot_t prot, struct page **pages, int *nr)
+{
+	pte_t *pte;
+
+	pte = pte_alloc_kernel(pmd, addr);
+	if (!pte)
+		return -ENOMEM;
+
+	do {
+		struct page *page = pages[*nr];
+
+		if (WARN_ON(!pte_none(*pte)))
+			return -EBUSY;
+		if (WARN_ON(!page))
+			return -ENOMEM;
+		set_pte_at(&init_mm, addr, pte, mk_pte(page, prot));
+		(*nr)++;
+	} while (pte++, addr += PAGE_SIZE, addr != end);
+
+	return 0;
+}
+
+/*
+ * Map a whole PMD with a block entry if the pages behind it are one
+ * physically contiguous, PMD aligned run.
+ */
+static bool vmap_try_huge_pmd(pmd_t *pmd, unsigned long addr,
+			      unsigned long end, pgprot_t prot,
+			      struct page **pages)
+{
+	unsigned long pfn = page_to_pfn(pages[0]);
+	int i;
+
+	if (end - addr != PMD_SIZE || !IS_ALIGNED(addr, PMD_SIZE))
+		return false;
+
+	if (!IS_ALIGNED(PFN_PHYS(pfn), PMD_SIZE))
+		return false;
+
+	for (i = 1; i < PTRS_PER_PTE; i++)
+		if (page_to_pfn(pages[i]) != pfn + i)
+			return false;
+
+	/* Left behind by an earlier small page mapping of the range: */
+	if (!pmd_none(*pmd) && !pmd_free_pte_page(pmd, addr))
+		return false;
+
+	return pmd_set_huge(pmd, PFN_PHYS(pfn), prot);
+}
+
+static int vmap_pmd_range(pud_t *pud, unsigned long addr, unsigned long end,
+			  pgprot_t prot, struct page **pages, int *nr,
+			  unsigned int page_shift)
+{
+	pmd_t *pmd;
+	unsigned long next;
+
+	pmd = pmd_alloc(&init_mm, pud, addr);
+	if (!pmd)
+		return -ENOMEM;
+
+	do {
+		next = pmd_addr_end(addr, end);
+
+		if (page_shift >= PMD_SHIFT &&
+		    vmap_try_huge_pmd(pmd, addr, next, prot, pages + *nr)) {
+			*nr += PTRS_PER_PTE;
+			this_cpu_inc(vmalloc_stats.huge_maps);
+			continue;
+		}
+
+		if (vmap_pte_range(pmd, addr, next, prot, pages, nr))
+			return -ENOMEM;
+	} while (pmd++, addr = next, addr != end);
+
+	return 0;
+}
+
+static int vmap_pud_range(p4d_t *p4d, unsigned long addr, unsigned long end,
+			  pgprot_t prot, struct page **pages, int *nr,
+			  unsigned int page_shift)
+{
+	pud_t *pud;
+	unsigned long next;
+
+	pud = pud_alloc(&init_mm, p4d, addr);
+	if (!pud)
+		return -ENOMEM;
+
+	do {
+		next = pud_addr_end(addr, end);
+		if (vmap_pmd_range(pud, addr, next, prot, pages, nr, page_shift))
+			return -ENOMEM;
+	} while (pud++, addr = next, addr != end);
+
+	return 0;
+}
+
+static int vmap_p4d_range(pgd_t *pgd, unsigned long addr, unsigned long end,
+			  pgprot_t prot, struct page **pages, int *nr,
+			  unsigned int page_shift)
+{
+	p4d_t *p4d;
+	unsigned long next;
+
+	p4d = p4d_alloc(&init_mm, pgd, addr);
+	if (!p4d)
+		return -ENOMEM;
+
+	do {
+		next = p4d_addr_end(addr, end);
+		if (vmap_pud_range(p4d, addr, next, prot, pages, nr, page_shift))
+			return -ENOMEM;
+	} while (p4d++, addr = next, addr != end);
+
+	return 0;
+}
+
+/*
+ * Map @pages at [@addr, @end). With @page_shift >= PMD_SHIFT, PMD sized
+ * and aligned stretches of contiguous pages get a block entry.
+ */
+static int vmap_pages_range(unsigned long addr, unsigned long end,
+			    pgprot_t prot, struct page **pages,
+			    unsigned int page_shift)
+{
+	unsigned long start = addr;
+	unsigned long next;
+	pgd_t *pgd;
+	int nr = 0;
+	int err;
+
+	BUG_ON(addr >= end);
+	pgd = pgd_offset_k(addr);
+	do {
+		next = pgd_addr_end(addr, end);
+		err = vmap_p4d_range(pgd, addr, next, prot, pages, &nr,
+				     page_shift);
+		if (err) {
+			unmap_kernel_range_noflush(start, end - start);
+			return err;
+		}
+	} while (pgd++, addr = next, addr != end);
+
+	return 0;
+}
+
+static struct vm_struct *get_vm_area(unsigned long size, unsigned long align,
+				     unsigned long flags)
+{
+	struct vm_struct *area;
+	struct vmap_area *va;
+
+	area = kzalloc(sizeof(*area), GFP_KERNEL);
+	if (unlikely(!area))
+		return NULL;
+
+	va = alloc_vmap_area(size, align);
+	if (unlikely(!va)) {
+		kfree(area);
+		return NULL;
+	}
+
+	area->addr = (void *)va->va_start;
+	area->size = size;
+	area->flags = flags;
+
+	spin_lock(&vmap_area_lock);
+	va->vm = area;
+	spin_unlock(&vmap_area_lock);
+
+	return area;
+}
+
+/**
+ * find_vm_area - find a continuous kernel virtual area
+ * @addr: base address
+ *
+ * Returns the area mapped at @addr by vmalloc() or vmap(), or NULL.
+ */
+struct vm_struct *find_vm_area(const void *addr)
+{
+	struct vm_struct *vm = NULL;
+	struct vmap_area *va;
+
+	spin_lock(&vmap_area_lock);
+	va = __find_vmap_area((unsigned long)addr);
+	if (va)
+		vm = va->vm;
+	spin_unlock(&vmap_area_lock);
+
+	return vm;
+}
+
+/*
+ * Unmap the area at @addr and queue it for the lazy purge. Returns the
+ * area for the caller to free its pages.
+ */
+static struct vm_struct *remove_vm_area(const void *addr)
+{
+	struct vm_struct *vm;
+	struct vmap_area *va;
+
+	spin_lock(&vmap_area_lock);
+	va = __find_vmap_area((unsigned long)addr);
+	vm = va ? va->vm : NULL;
+	spin_unlock(&vmap_area_lock);
+
+	if (WARN(!vm || vm->addr != addr,
+		 "trying to free nonexistent vm area (%p)\n", addr))
+		return NULL;
+
+	unmap_kernel_range_noflush(va->va_start, vm->size);
+	free_vmap_area_noflush(va);
+
+	return vm;
+}
+
+/*
+ * Fill @pages with @nr_pages pages. PMD sized chunks come from one
+ * order-9 block each when the buddy allocator has one to spare, the
+ * rest is order-0.
+ */
+static unsigned int vm_alloc_pages(struct page **pages, unsigned int nr_pages,
+				   gfp_t gfp_mask, bool huge)
+{
+	unsigned int huge_order = PMD_SHIFT - PAGE_SHIFT;
+	unsigned int i = 0, j;
+	struct page *page;
+
+	while (huge && nr_pages - i >= (1U << huge_order)) {
+		page = alloc_pages(gfp_mask | __GFP_NOWARN, huge_order);
+		if (!page)
+			break;
+
+		split_page(page, huge_order);
+		for (j = 0; j < (1U << huge_order); j++)
+			pages[i++] = page + j;
+	}
+
+	for (; i < nr_pages; i++) {
+		page = alloc_page(gfp_mask);
+		if (unlikely(!page))
+			break;
+		pages[i] = page;
+	}
+
+	return i;
+}
+
+static void *__vmalloc(unsigned long size, gfp_t gfp_mask)
+{
+	unsigned int nr_pages, nr;
+	struct vm_struct *area;
+	unsigned long align = PAGE_SIZE;
+	bool huge = false;
+
+	size = PAGE_ALIGN(size);
+	if (!size || (size >> PAGE_SHIFT) > UINT_MAX)
+		return NULL;
+
+	if (size >= PMD_SIZE) {
+		align = PMD_SIZE;
+		huge = true;
+	}
+
+	area = get_vm_area(size, align, VM_ALLOC);
+	if (!area)
+		return NULL;
+
+	nr_pages = size >> PAGE_SHIFT;
+	area->pages = kmalloc(nr_pages * sizeof(struct page *), GFP_KERNEL);
+	if (!area->pages)
+		goto fail;
+
+	nr = vm_alloc_pages(area->pages, nr_pages, gfp_mask, huge);
+	area->nr_pages = nr;
+	if (nr != nr_pages)
+		goto fail;
+
+	if (vmap_pages_range((unsigned long)area->addr,
+			     (unsigned long)area->addr + size, PAGE_KERNEL,
+			     area->pages, huge ? PMD_SHIFT : PAGE_SHIFT))
+		goto fail;
+
+	if (huge)
+		area->flags |= VM_HUGE;
+
+	this_cpu_inc(vmalloc_stats.allocs);
+
+	return area->addr;
+
+fail:
+	pr_warn("allocation failure, allocated %lu of %lu bytes\n",
+		(unsigned long)area->nr_pages << PAGE_SHIFT, size);
+	vfree(area->addr);
+	return NULL;
+}
+
+/**
+ * vmalloc - allocate virtually contiguous memory
+ * @size: allocation size
+ *
+ * The pages behind the allocation need not be physically contiguous.
+ * Returns NULL on failure.
+ */
+void *vmalloc(unsigned long size)
+{
+	return __vmalloc(size, GFP_KERNEL);
+}
+
+/**
+ * vzalloc - allocate zeroed virtually contiguous memory
+ * @size: allocation size
+ */
+void *vzalloc(unsigned long size)
+{
+	return __vmalloc(size, GFP_KERNEL | __GFP_ZERO);
+}
+
+/**
+ * vfree - release memory allocated by vmalloc()
+ * @addr: memory base address
+ *
+ * The pages are freed right away, the address range only once the
+ * next lazy purge has flushed it from the TLBs.
+ */
+void vfree(const void *addr)
+{
+	struct vm_struct *area;
+	unsigned int i;
+
+	if (!addr)
+		return;
+
+	area = remove_vm_area(addr);
+	if (unlikely(!area))
+		return;
+
+	for (i = 0; i < area->nr_pages; i++)
+		__free_page(area->pages[i]);
+
+	kfree(area->pages);
+	kfree(area);
+
+	this_cpu_inc(vmalloc_stats.frees);
+}
+
+/**
+ * vmap - map an array of pages into virtually contiguous space
+ * @pages: array of page pointers
+ * @count: number of pages to map
+ * @prot: page protection for the mapping
+ *
+ * The pages stay owned by the caller.
+ */
+void *vmap(struct page **pages, unsigned int count, pgprot_t prot)
+{
+	unsigned long size = (unsigned long)count << PAGE_SHIFT;
+	struct vm_struct *area;
+
+	if (!count)
+		return NULL;
+
+	area = get_vm_area(size, PAGE_SIZE, VM_MAP);
+	if (!area)
+		return NULL;
+
+	if (vmap_pages_range((unsigned long)area->addr,
+			     (unsigned long)area->addr + size, prot, pages,
+			     PAGE_SHIFT)) {
+		vunmap(area->addr);
+		return NULL;
+	}
+
+	this_cpu_inc(vmalloc_stats.allocs);
+
+	return area->addr;
+}
+
+/**
+ * vunmap - release virtual mapping obtained by vmap()
+ * @addr: memory base address
+ */
+void vunmap(const void *addr)
+{
+	struct vm_struct *area;
+
+	if (!addr)
+		return;
+
+	area = remove_vm_area(addr);
+	if (unlikely(!area))
+		return;
+
+	kfree(area);
+
+	this_cpu_inc(vmalloc_stats.frees);
+}
+
+void __init vmalloc_init(void)
+{
+	struct vmap_area *va;
+
+	BUG_ON((unsigned long)_end > VMALLOC_START);
+
+	vmap_area_cachep = kmem_cache_create("vmap_area",
+			sizeof(struct vmap_area), 0, SLAB_PANIC, NULL);
+
+	va = kmem_cache_alloc(vmap_area_cachep, GFP_KERNEL);
+	va->va_start = VMALLOC_START;
+	va->va_end = VMALLOC_END;
+	insert_free_vmap_area(va);
+
+	pr_info("%lu MB at 0x%016lx\n",
+		(VMALLOC_END - VMALLOC_START) >> 20, VMALLOC_START);
+}
+
+void show_vmalloc_stats(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct vmalloc_stats *st = per_cpu_ptr(&vmalloc_stats, cpu);
+
+		pr_info("CPU%d: allocs %lu frees %lu huge %lu purges %lu/%lu areas\n",
+			cpu, st->allocs, st->frees, st->huge_maps,
+			st->purges, st->purged_areas);
+	}
+
+	pr_info("lazily freed %ld pages, purge at %lu\n",
+		atomic_long_read(&vmap_lazy_nr), lazy_max_pages());
+}
@@ -13,6 +13,13 @@
  */
 #define ARCH_DMA_MINALIGN	(128)
 
+/*
+ * memset() writes fills of at least this many bytes, which would only
+ * evict the working set, with non-temporal stores when DC ZVA can't be
+ * used for them. Must be a multiple of 4K.
+ */
+#define MEMSET_NT_THRESHOLD	(256 * 1024)
+
 #ifndef __ASSEMBLY__
 
 #define __read_mostly __attribute__((__section__(".data..read_mostly")))
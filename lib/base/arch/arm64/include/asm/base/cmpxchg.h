@@ -220,6 +220,47 @@ __CMPXCHG_GEN(_mb)
 	BUG_ON((u64 *)(ptr2) - (u64 *)(ptr1) != 1);	\
 })
 
+#ifdef __ARM_FEATURE_ATOMICS
+/*
+ * With LSE atomics a single CASP does the job. Its operands are pairs of
+ * consecutive registers starting at an even one, hence the fixed x0-x4.
+ */
+#define __CMPXCHG_DBL(name, mb, cl)					\
+static inline s64 __cmpxchg_double##name(u64 old1,		\
+				      u64 old2,		\
+				      u64 new1,		\
+				      u64 new2,		\
+				      volatile void *ptr)		\
+{									\
+	u64 oldval1 = old1;					\
+	u64 oldval2 = old2;					\
+	register u64 x0 asm ("x0") = old1;			\
+	register u64 x1 asm ("x1") = old2;			\
+	register u64 x2 asm ("x2") = new1;			\
+	register u64 x3 asm ("x3") = new2;			\
+	register u64 x4 asm ("x4") = (u64)ptr;			\
+									\
+	asm volatile("// __cmpxchg_double" #name "\n"			\
+	"	casp" #mb "\t%[old1], %[old2], %[new1], %[new2], %[v]\n"\
+	"	eor	%[old1], %[old1], %[oldval1]\n"			\
+	"	eor	%[old2], %[old2], %[oldval2]\n"			\
+	"	orr	%[old1], %[old1], %[old2]"			\
+	: [old1] "+&r" (x0), [old2] "+&r" (x1),				\
+	  [v] "+Q" (*(__uint128_t *)ptr)				\
+	: [new1] "r" (x2), [new2] "r" (x3), [ptr] "r" (x4),		\
+	  [oldval1] "r" (oldval1), [oldval2] "r" (oldval2)		\
+	: cl);								\
+									\
+	return x0;							\
+}
+
+__CMPXCHG_DBL(   ,   ,         )
+__CMPXCHG_DBL(_mb, al, "memory")
+
+#undef __CMPXCHG_DBL
+
+#else /* !__ARM_FEATURE_ATOMICS */
+
 #define __CMPXCHG_DBL(name, mb, rel, cl)				\
 static inline s64 __cmpxchg_double##name(u64 old1,		\
 				      u64 old2,		\
@@ -252,6 +293,8 @@ __CMPXCHG_DBL(_mb, dmb ish, l, "memory")
 
 #undef __CMPXCHG_DBL
 
+#endif /* __ARM_FEATURE_ATOMICS */
+
 #define cmpxchg_double(ptr1, ptr2, o1, o2, n1, n2) \
 ({\
 	int __ret;\
@@ -0,0 +1,204 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __BASE_RING_H_
+#define __BASE_RING_H_
+/*
+ * Lock-less ring of fixed size slots in shared memory
+ *
+ * The ring header and the slots live in memory mapped by the kernel
+ * and by every party of the channel, so all state is in the header and
+ * addressed by index. Indices are free running 32 bit counters; a slot
+ * is found by masking them with nr_slots - 1.
+ *
+ * There is a single consumer. With RING_F_MP set any number of producers
+ * may enqueue concurrently: a slot is reserved by advancing prod_head
+ * with cmpxchg, and committed slots are published in reservation order
+ * by advancing prod_tail. A lone producer skips the cmpxchg.
+ *
+ * Sleeping is opt-in and driven by the two waiting flags: a consumer
+ * that found the ring empty sets cons_waiting, re-checks the ring and
+ * only then asks the kernel to put it to sleep; ring_produce_commit()
+ * returns true when it has to be woken. Producers do the same with
+ * prod_waiting when the ring is full. A party that never sleeps never
+ * makes the other one enter the kernel.
+ *
+ * Usage, on the producer side:
+ *
+ *	slot = ring_produce_begin(r, &idx);
+ *	if (!slot)
+ *		... full, ring_prepare_wait_space() and sleep ...
+ *	fill in slot;
+ *	if (ring_produce_commit(r, idx))
+ *		... notify the consumer ...
+ */
+
+#include <base/types.h>
+#include <base/compiler.h>
+#include <base/cache.h>
+#include <base/atomic.h>
+
+#define RING_F_MP		0x1	/* multiple producers */
+
+struct ring_hdr {
+	u32			nr_slots;	/* power of 2 */
+	u32			slot_size;	/* bytes, multiple of 8 */
+	u32			flags;
+
+	/* Written by producers: */
+	atomic_t		prod_head ____cacheline_aligned;
+	atomic_t		prod_tail;
+	atomic_t		prod_waiting;
+
+	/* Written by the consumer: */
+	atomic_t		cons_tail ____cacheline_aligned;
+	atomic_t		cons_waiting;
+} ____cacheline_aligned;
+
+/* Bytes of shared memory for a ring with @nr slots of @size bytes. */
+#define RING_BYTES(nr, size)	(sizeof(struct ring_hdr) + (size_t)(nr) * (size))
+
+static inline void ring_init(struct ring_hdr *r, u32 nr_slots, u32 slot_size,
+			     u32 flags)
+{
+	r->nr_slots = nr_slots;
+	r->slot_size = slot_size;
+	r->flags = flags;
+	atomic_set(&r->prod_head, 0);
+	atomic_set(&r->prod_tail, 0);
+	atomic_set(&r->cons_waiting, 0);
+	atomic_set(&r->cons_tail, 0);
+	atomic_set(&r->prod_waiting, 0);
+}
+
+static inline void *ring_slot(struct ring_hdr *r, u32 idx)
+{
+	return (char *)(r + 1) + (size_t)(idx & (r->nr_slots - 1)) * r->slot_size;
+}
+
+/* Number of committed, not yet consumed slots. */
+static inline u32 ring_count(struct ring_hdr *r)
+{
+	return atomic_read_acquire(&r->prod_tail) - atomic_read(&r->cons_tail);
+}
+
+static inline bool ring_empty(struct ring_hdr *r)
+{
+	return atomic_read_acquire(&r->prod_tail) == atomic_read(&r->cons_tail);
+}
+
+static inline bool ring_full(struct ring_hdr *r)
+{
+	return (u32)(atomic_read(&r->prod_head) -
+		     atomic_read_acquire(&r->cons_tail)) >= r->nr_slots;
+}
+
+/**
+ * ring_produce_begin - reserve the next slot
+ * @r: the ring
+ * @idx: returns the ring index of the slot
+ *
+ * Returns the slot to fill in or NULL if the ring is full. The slot must
+ * be handed to ring_produce_commit() as soon as it is written, further
+ * producers wait for it before publishing their own.
+ */
+static inline void *ring_produce_begin(struct ring_hdr *r, u32 *idx)
+{
+	int head = atomic_read(&r->prod_head);
+
+	do {
+		/* Pairs with the release of cons_tail in ring_consume_release(). */
+		if ((u32)(head - atomic_read_acquire(&r->cons_tail)) >= r->nr_slots)
+			return NULL;
+		if (!(r->flags & RING_F_MP)) {
+			atomic_set(&r->prod_head, head + 1);
+			break;
+		}
+	} while (!atomic_try_cmpxchg_relaxed(&r->prod_head, &head, head + 1));
+
+	*idx = head;
+	return ring_slot(r, head);
+}
+
+/**
+ * ring_produce_commit - publish a slot reserved with ring_produce_begin()
+ * @r: the ring
+ * @idx: the index ring_produce_begin() returned for the slot
+ *
+ * Returns true if the consumer sleeps and must be notified.
+ */
+static inline bool ring_produce_commit(struct ring_hdr *r, u32 idx)
+{
+	/* Earlier reservations are published first. */
+	if (r->flags & RING_F_MP)
+		smp_cond_load_relaxed(&r->prod_tail.counter, VAL == (int)idx);
+
+	/* Pairs with the acquire of prod_tail in ring_consume_peek(). */
+	atomic_set_release(&r->prod_tail, idx + 1);
+
+	/* Pairs with the smp_mb() in ring_prepare_wait_data(). */
+	smp_mb();
+	return atomic_read(&r->cons_waiting);
+}
+
+/**
+ * ring_consume_peek - the oldest committed slot
+ * @r: the ring
+ *
+ * Returns NULL if the ring is empty. The slot stays owned by the consumer
+ * until it is given back with ring_consume_release().
+ */
+static inline void *ring_consume_peek(struct ring_hdr *r)
+{
+	int tail = atomic_read(&r->cons_tail);
+
+	if (tail == atomic_read_acquire(&r->prod_tail))
+		return NULL;
+
+	return ring_slot(r, tail);
+}
+
+/**
+ * ring_consume_release - give the oldest slot back to the producers
+ * @r: the ring
+ *
+ * Returns true if a producer sleeps on a full ring and must be notified.
+ */
+static inline bool ring_consume_release(struct ring_hdr *r)
+{
+	atomic_set_release(&r->cons_tail, atomic_read(&r->cons_tail) + 1);
+
+	/* Pairs with the smp_mb() in ring_prepare_wait_space(). */
+	smp_mb();
+	return atomic_read(&r->prod_waiting);
+}
+
+/*
+ * Announce that the consumer is about to sleep. Returns false, with the
+ * flag cleared again, if data showed up meanwhile and there is no need
+ * to. Otherwise the flag stays set until the consumer is notified.
+ */
+static inline bool ring_prepare_wait_data(struct ring_hdr *r)
+{
+	atomic_set(&r->cons_waiting, 1);
+	smp_mb();
+	if (!ring_empty(r)) {
+		atomic_set(&r->cons_waiting, 0);
+		return false;
+	}
+
+	return true;
+}
+
+/* Same as ring_prepare_wait_data(), for producers facing a full ring. */
+static inline bool ring_prepare_wait_space(struct ring_hdr *r)
+{
+	atomic_set(&r->prod_waiting, 1);
+	smp_mb();
+	if (!ring_full(r)) {
+		atomic_set(&r->prod_waiting, 0);
+		return false;
+	}
+
+	return true;
+}
+
+#endif /* !__BASE_RING_H_ */
@@ -1,7 +1,53 @@
 #include <base/common.h>
 #include <base/libfdt.h>
+#include <base/string.h>
+
+#include <channel.h>
+
+/*
+ * Clients write text into the console ring, one chunk per slot. There
+ * is no output device to hand it to from here yet, so it is kept in a
+ * scrollback buffer.
+ */
+#define CONSOLE_RING_SLOTS	256
+
+struct console_msg {
+	u32	len;
+	char	buf[124];
+};
+
+#define CONSOLE_SCROLLBACK	(64 * 1024)
+
+static char scrollback[CONSOLE_SCROLLBACK];
+static unsigned long scrollback_head;
+
+static void console_write(const char *buf, u32 len)
+{
+	while (len--) {
+		scrollback[scrollback_head % CONSOLE_SCROLLBACK] = *buf++;
+		scrollback_head++;
+	}
+}
 
 int main(void)
 {
+	struct console_msg *msg;
+	struct channel ch;
+	int id;
+
+	id = channel_create(CONSOLE_RING_SLOTS, sizeof(struct console_msg),
+			    CHANNEL_MP | CHANNEL_PUBLIC);
+	if (id < 0)
+		return id;
+	if (channel_attach(&ch, id))
+		return -1;
+
+	for (;;) {
+		/* Sleeps only when the ring runs dry. */
+		msg = channel_recv(&ch);
+		console_write(msg->buf, min_t(u32, msg->len, sizeof(msg->buf)));
+		channel_recv_done(&ch);
+	}
+
 	return 0;
 }
@@ -1,7 +1,108 @@
 #include <base/common.h>
 #include <base/libfdt.h>
+#include <base/errno.h>
+
+#include <channel.h>
+
+/*
+ * Requests come in on one multi-producer ring that any client may attach.
+ * Each client owns a reply ring, shared with the server and named in the
+ * request, which the server attaches the first time it sees it. File
+ * data is not copied into the reply: a read hands the client a grant of
+ * the pages holding it, see <grant.h>.
+ */
+#define VFS_RING_SLOTS		128
+#define VFS_MAX_CLIENTS		16
+
+#define VFS_OPEN		1
+#define VFS_CLOSE		2
+#define VFS_READ		3
+#define VFS_WRITE		4
+
+struct vfs_request {
+	u32	op;
+	s32	reply_channel;
+	u64	cookie;
+	u64	args[4];
+	char	path[64];
+};
+
+struct vfs_reply {
+	u64	cookie;
+	s64	result;
+	/* Grant id of the data for VFS_READ, -1 for none: */
+	s64	grant;
+};
+
+static struct channel clients[VFS_MAX_CLIENTS];
+static int nr_clients;
+
+static struct channel *vfs_reply_channel(int id)
+{
+	int i;
+
+	for (i = 0; i < nr_clients; i++) {
+		if (clients[i].id == id)
+			return &clients[i];
+	}
+
+	if (nr_clients == VFS_MAX_CLIENTS)
+		return NULL;
+	if (channel_attach(&clients[nr_clients], id))
+		return NULL;
+
+	return &clients[nr_clients++];
+}
+
+/* No filesystem is mounted yet, every lookup fails. */
+static s64 vfs_handle(struct vfs_request *req)
+{
+	switch (req->op) {
+	case VFS_OPEN:
+		return -ENOENT;
+	case VFS_CLOSE:
+	case VFS_READ:
+	case VFS_WRITE:
+		return -EBADF;
+	default:
+		return -ENOSYS;
+	}
+}
 
 int main(void)
 {
+	struct vfs_request *req;
+	struct vfs_reply *rep;
+	struct channel ch, *reply;
+	u64 cookie;
+	s64 result;
+	u32 idx;
+	int id;
+
+	id = channel_create(VFS_RING_SLOTS, sizeof(struct vfs_request),
+			    CHANNEL_MP | CHANNEL_PUBLIC);
+	if (id < 0)
+		return id;
+	if (channel_attach(&ch, id))
+		return -1;
+
+	for (;;) {
+		req = channel_recv(&ch);
+		result = vfs_handle(req);
+		cookie = req->cookie;
+		reply = vfs_reply_channel(req->reply_channel);
+		/* Free the request slot before we may block on the reply ring. */
+		channel_recv_done(&ch);
+
+		if (!reply)
+			continue;
+
+		rep = channel_send_begin(reply, &idx);
+		rep->cookie = cookie;
+		rep->result = result;
+		rep->grant = -1;
+		channel_send_commit(reply, idx);
+	}
+
 	return 0;
 }